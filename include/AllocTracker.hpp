@@ -0,0 +1,46 @@
+#ifndef ALLOC_TRACKER_HPP
+#define ALLOC_TRACKER_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Opt-in heap allocation tracking, only there when built with ISLANDS_ALLOC_TRACKING.
+// It replaces the global operator new and delete to count allocations per thread and per frame,
+// the profiler zones pick up the per thread counters so every zone knows what it allocated.
+// Recording the call stack of every allocation shows where they come from.
+// Without the option nothing is replaced and every counter stays at 0.
+namespace gm::alloc {
+    inline constexpr uint32_t CALL_SITE_DEPTH = 8;
+    // distinct call stacks kept, allocations from new ones past this are only counted
+    inline constexpr uint32_t CALL_SITE_CAPACITY = 4096;
+
+    struct Counters {
+        uint64_t allocations{}, bytes{}, frees{};
+    };
+    struct CallSite {
+        uint64_t allocations{}, bytes{};
+        // one symbolized frame per entry, innermost first
+        std::vector<std::string> frames{};
+    };
+
+    // false when built without ISLANDS_ALLOC_TRACKING
+    bool is_enabled();
+    // since the thread started, never reset, zones take the difference
+    Counters get_thread_counters();
+    // main thread only, once per frame like profiler::end_frame
+    void end_frame();
+    // all threads, between the last two end_frame calls
+    Counters get_last_frame();
+
+    // a backtrace per allocation is slow, so call sites are only recorded when asked for
+    void set_capture_call_sites(bool capture);
+    bool is_capturing_call_sites();
+    void reset_call_sites();
+    // the N call sites with the most allocations since the last reset
+    std::vector<CallSite> get_top_call_sites(size_t n);
+    // allocations whose call stack didn't fit into the table anymore
+    uint64_t get_untracked_allocations();
+}
+
+#endif
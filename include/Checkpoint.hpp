@@ -0,0 +1,78 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+#include "SceneFile.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Periodic checkpoints of a long run, scene files (see SceneFile.hpp) that the game and the headless
+// simulation can both resume from. Every checkpoint is written next to the last one as
+// base_<step>.bin and synced to the disk, only the newest keep of them are kept. Checkpoints carry
+// SCENE_FLAG_CHECKPOINT, so a resumed run only ever deletes files a CheckpointWriter wrote.
+namespace gm::scene {
+    class CheckpointWriter {
+    public:
+        inline static constexpr uint32_t DEFAULT_KEEP = 3;
+        enum class Mode {
+            // write copies the scene and a writer thread saves the copy
+            Thread,
+            // write forks and the child saves the scene from its copy on write view of the memory, POSIX only
+            Fork,
+        };
+    private:
+        std::filesystem::path m_base{};
+        uint32_t m_keep{};
+        Mode m_mode{};
+        // the checkpoints written so far and the ones an earlier run left behind, oldest first
+        std::deque<std::filesystem::path> m_written{};
+        std::atomic<uint64_t> m_written_count{}, m_skipped{};
+        std::string m_error{};
+
+        // thread mode
+        std::mutex m_mutex{};
+        std::condition_variable m_wake{};
+        std::optional<SceneData> m_pending{};
+        bool m_stop{};
+        std::thread m_writer{};
+
+        // fork mode, the child that is still writing
+        int m_child{ -1 };
+        std::filesystem::path m_child_path{};
+
+        void submit(SceneData&& scene);
+        void fork_and_write(const SceneData& scene);
+        void write_loop();
+        // deletes the checkpoints past m_keep once path made it to the disk
+        void retain(const std::filesystem::path& path);
+        void set_error(const std::string& error);
+        // waits for the child when block, true once there is none
+        bool reap(bool block);
+    public:
+        // throws for Mode::Fork where there is no fork
+        CheckpointWriter(const std::filesystem::path& base, uint32_t keep = DEFAULT_KEEP, Mode mode = Mode::Thread);
+        CheckpointWriter(const CheckpointWriter&) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+        // waits for the checkpoint that is being written
+        ~CheckpointWriter();
+
+        // copies the scene (or forks) and returns, the writing happens in the background. A checkpoint
+        // still waiting for the writer is replaced by the newer one, a fork while the last child
+        // is still writing is skipped
+        void write(const SceneData& scene);
+        // for a scene that was just built to be written, the writer thread takes it without a copy
+        void write(SceneData&& scene);
+
+        uint64_t get_written() const;
+        uint64_t get_skipped() const;
+        // why the last checkpoint failed, empty when none did
+        std::string get_error();
+    };
+}
+
+#endif
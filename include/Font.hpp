@@ -20,30 +20,35 @@
 #include <shaders.hpp>
 #endif
 namespace font{
-    struct Character {
-        uint32_t texture_id{};
-        glm::ivec2 size{};
-        glm::ivec2 bearing{};
-        uint32_t advance{};
-    };
     class FontBitmap {
-        uint32_t bitmap_id{};
-        uint32_t glyphs_x{}, glyphs_y{};
-        uint32_t glyph_count{};
-        uint32_t glyph_width{}, glyph_height{};
-        float total_x{}, total_y{};
-        char first_char{}, last_char{};
-
     public:
+        // where a glyph lives in the packed atlas and where it goes inside its cell, in pixels
+        struct PackedGlyph {
+            uint16_t x{}, y{};
+            uint16_t width{}, height{};
+            int16_t offset_x{}, offset_y{};
+        };
         struct GlyphTextureCoordinates {
             glm::vec2 top_left{};
             glm::vec2 top_right{};
             glm::vec2 bottom_left{};
             glm::vec2 bottom_right{};
+            // quad of the glyph relative to the top left corner of its cell, in font pixels
+            glm::vec2 offset{};
+            glm::vec2 size{};
         };
-        FontBitmap(uint32_t bitmap, uint32_t glyphs_x, uint32_t glyphs_y, uint32_t glyph_width, uint32_t glyph_height, char first, char last);
-        FontBitmap(const FontBitmap& other);
-        FontBitmap& operator=(const FontBitmap& other);
+    private:
+        uint32_t bitmap_id{};
+        uint32_t glyph_width{}, glyph_height{};
+        float total_x{}, total_y{};
+        char first_char{}, last_char{};
+        std::vector<PackedGlyph> glyphs{};
+
+    public:
+        FontBitmap(uint32_t bitmap, uint32_t atlas_width, uint32_t atlas_height, uint32_t glyph_width, uint32_t glyph_height,
+            char first, char last, std::vector<PackedGlyph> glyphs);
+        FontBitmap(const FontBitmap& other) = delete;
+        FontBitmap& operator=(const FontBitmap& other) = delete;
         FontBitmap(FontBitmap&& other);
         FontBitmap& operator=(FontBitmap&& other);
 
@@ -56,14 +61,20 @@ namespace font{
     };
     font::FontBitmap load_font(const std::string& file_path, int font_size);
 
-    struct GlyphVertex {
-        glm::vec2 pos;
-        glm::vec2 tex;
+    // one glyph quad of a batched string, every string drawn in a frame ends up in the same buffer
+    struct GlyphInstance {
+        // xyz = position of the text (world space for labels, screen space for the HUD), w = scale
+        glm::vec4 anchor{};
+        // x, y, width, height of the quad relative to the anchor, in font pixels
+        glm::vec4 rect{};
+        // top left and bottom right corner in the font bitmap
+        glm::vec4 uv{};
+        // rgb, a = 1 for camera facing world space text, 0 for screen space text
+        glm::vec4 color{};
     };
     class TextBase {
         protected:
             std::string m_str{};
-            Shader* m_text_shader{};
             FontBitmap* m_font_bitmap{};
 
             glm::vec3 m_pos{};
@@ -76,14 +87,15 @@ namespace font{
         public:
             virtual ~TextBase();
             TextBase();
-            TextBase(FontBitmap* font_bitmap, Shader* text_shader, std::string text = "");
+            TextBase(FontBitmap* font_bitmap, std::string text = "");
             TextBase(const TextBase& other) = delete;
             TextBase& operator=(const TextBase& other) = delete;
             TextBase(TextBase&& other);
             TextBase& operator=(TextBase&& other);
 
-            virtual void draw() const = 0;
-            virtual void debug_draw() const = 0;
+            // writes a quad for every character, see TextBatch
+            virtual void append_glyphs(std::vector<GlyphInstance>& out) const = 0;
+            FontBitmap* get_font_bitmap() const;
             virtual void set_text(std::string&& new_text);
             virtual const std::string& get_text() const;
             virtual void set_color(glm::vec3 new_col);
@@ -99,9 +111,8 @@ namespace font{
     };
     class Text2D : public TextBase {
     protected:
-        uint32_t m_vao{}, m_vbo{};
         float m_height{}, m_width{};
-        Text2D(FontBitmap* font, Shader* shader, std::string text);
+        Text2D(FontBitmap* font, std::string text);
     public:
         virtual ~Text2D();
         Text2D();
@@ -110,8 +121,7 @@ namespace font{
         Text2D& operator=(const Text2D& other) = delete;
         Text2D(Text2D&& other);
         Text2D& operator=(Text2D&& other);
-        virtual void draw() const override;
-        virtual void debug_draw() const override;
+        virtual void append_glyphs(std::vector<GlyphInstance>& out) const override;
         const glm::vec3& get_pos() const;
         void set_pos(glm::vec2&& new_pos);
         virtual void set_text(std::string&& new_text) override;
@@ -134,9 +144,35 @@ namespace font{
         Text3D(Text3D&& other);
         Text3D& operator=(Text3D&& other);
         virtual void set_text(std::string&& new_text) override;
-        virtual void draw() const override;
-        virtual void debug_draw() const override;
+        virtual void append_glyphs(std::vector<GlyphInstance>& out) const override;
         void set_pos(glm::vec3&& new_pos);
     };
+
+    // Collects the glyphs of every label and HUD string submitted during a frame
+    // and draws all of them with a single instanced draw call.
+    class TextBatch {
+        uint32_t m_vao{}, m_vbo{};
+        // in glyphs
+        std::size_t m_capacity{};
+        std::vector<GlyphInstance> m_glyphs{};
+        FontBitmap* m_font_bitmap{};
+        uint32_t m_draw_calls{}, m_last_draw_calls{};
+        std::size_t m_glyph_count{}, m_last_glyph_count{};
+
+        void draw();
+    public:
+        TextBatch();
+        TextBatch(const TextBatch&) = delete;
+        TextBatch& operator=(const TextBatch&) = delete;
+        TextBatch(TextBatch&& other);
+        TextBatch& operator=(TextBatch&& other);
+        ~TextBatch();
+
+        void add(const TextBase& text);
+        // draws everything added since the last flush
+        void flush();
+        std::size_t get_last_glyph_count() const;
+        uint32_t get_last_draw_calls() const;
+    };
 }
 #endif
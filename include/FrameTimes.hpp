@@ -0,0 +1,66 @@
+#ifndef FRAME_TIMES_HPP
+#define FRAME_TIMES_HPP
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace gm {
+
+    // Frame time histogram over a sliding window of the last frames.
+    // The buckets are log-linear like in HdrHistogram: every power of two of microseconds is split into
+    // SUB_BUCKETS / 2 linear buckets, so a percentile is never off by more than 1 / (SUB_BUCKETS / 2)
+    // of its value, from a microsecond up to over a minute, without storing a bucket per microsecond.
+    class FrameTimes {
+    public:
+        inline static constexpr uint32_t SUB_BUCKET_BITS = 6;
+        inline static constexpr uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        // frames up to 2^MAX_MAGNITUDE us (about 67 s) are bucketed, anything longer ends up in the last bucket
+        inline static constexpr uint32_t MAX_MAGNITUDE = 26;
+        inline static constexpr uint32_t BUCKET_COUNT = SUB_BUCKETS + (MAX_MAGNITUDE - SUB_BUCKET_BITS) * (SUB_BUCKETS / 2);
+        inline static constexpr uint32_t DEFAULT_WINDOW = 1000;
+
+        struct Summary {
+            uint32_t frames{};
+            double mean_ms{}, p50_ms{}, p95_ms{}, p99_ms{}, max_ms{};
+        };
+    private:
+        uint32_t m_counts[BUCKET_COUNT]{};
+        // the frames in the window, so the oldest can be taken out of the histogram again
+        std::vector<float> m_window{};
+        // oldest frame once the window is full
+        uint32_t m_window_offset{};
+        uint32_t m_window_size{ DEFAULT_WINDOW };
+        double m_window_sum_ms{};
+    public:
+        static uint32_t bucket_for(double ms);
+        // every frame in the bucket took at most this long
+        static double bucket_upper_ms(uint32_t bucket);
+
+        void add(double ms);
+        // drops the frames recorded so far
+        void set_window(uint32_t frames);
+        uint32_t get_window() const;
+        uint32_t get_frames() const;
+        // the upper bound of the bucket the percentile falls in, p between 0 and 1
+        double percentile(double p) const;
+        Summary summary() const;
+        uint32_t get_count(uint32_t bucket) const;
+        // frames in the window in ms, the oldest one is at get_samples_offset()
+        const std::vector<float>& get_samples() const;
+        uint32_t get_samples_offset() const;
+    };
+
+    // one CSV row per frame, for looking at the whole run later instead of a window
+    class FrameTimesCsv {
+        std::ofstream m_out{};
+        uint64_t m_frame{};
+    public:
+        FrameTimesCsv();
+        explicit FrameTimesCsv(const std::filesystem::path& path);
+        bool is_open() const;
+        void write(double time_s, double frame_ms, uint32_t sim_steps, uint32_t draw_calls);
+    };
+}
+
+#endif
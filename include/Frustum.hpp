@@ -0,0 +1,118 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// bounding spheres stored as separate arrays so the culling can test four of them at once
+struct SphereBatch {
+    std::vector<float> x{}, y{}, z{}, r{};
+
+    inline void clear()
+    {
+        x.clear();
+        y.clear();
+        z.clear();
+        r.clear();
+    }
+    inline void push(const glm::vec3& center, float radius)
+    {
+        x.push_back(center.x);
+        y.push_back(center.y);
+        z.push_back(center.z);
+        r.push_back(radius);
+    }
+    inline std::size_t size() const
+    {
+        return x.size();
+    }
+};
+
+// A view frustum stored as six inward facing planes (xyz = normal, w = distance)
+struct Frustum {
+    enum Plane : int {
+        Left = 0,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        __end
+    };
+    glm::vec4 planes[Plane::__end] {};
+
+    // extracts the planes from a combined projection * view matrix (Gribb & Hartmann)
+    inline static Frustum from_matrix(const glm::mat4& m)
+    {
+        auto row = [&m](int i) {
+            return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        };
+        Frustum f {};
+        f.planes[Left] = row(3) + row(0);
+        f.planes[Right] = row(3) - row(0);
+        f.planes[Bottom] = row(3) + row(1);
+        f.planes[Top] = row(3) - row(1);
+        f.planes[Near] = row(3) + row(2);
+        f.planes[Far] = row(3) - row(2);
+        for (auto& p : f.planes) {
+            p /= glm::length(glm::vec3(p));
+        }
+        return f;
+    }
+    // conservative test, returns false only if the sphere is fully outside of the frustum
+    inline bool intersects_sphere(const glm::vec3& center, float radius) const
+    {
+        for (const auto& p : planes) {
+            if (glm::dot(glm::vec3(p), center) + p.w < -radius)
+                return false;
+        }
+        return true;
+    }
+    // appends the indices of all spheres in the batch that intersect the frustum to visible
+    inline void cull_spheres(const SphereBatch& spheres, std::vector<uint32_t>& visible) const
+    {
+        const std::size_t n = spheres.size();
+        std::size_t i = 0;
+#ifdef FRUSTUM_USE_SSE
+        __m128 px[__end], py[__end], pz[__end], pw[__end];
+        for (int p = 0; p < __end; p++) {
+            px[p] = _mm_set1_ps(planes[p].x);
+            py[p] = _mm_set1_ps(planes[p].y);
+            pz[p] = _mm_set1_ps(planes[p].z);
+            pw[p] = _mm_set1_ps(planes[p].w);
+        }
+        for (; i + 4 <= n; i += 4) {
+            __m128 x = _mm_loadu_ps(&spheres.x[i]);
+            __m128 y = _mm_loadu_ps(&spheres.y[i]);
+            __m128 z = _mm_loadu_ps(&spheres.z[i]);
+            __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.r[i]));
+            __m128 outside = _mm_setzero_ps();
+            for (int p = 0; p < __end; p++) {
+                __m128 d = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+                    _mm_add_ps(_mm_mul_ps(pz[p], z), pw[p]));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(d, neg_r));
+            }
+            int mask = _mm_movemask_ps(outside);
+            for (int lane = 0; lane < 4; lane++) {
+                if (!(mask & (1 << lane)))
+                    visible.push_back(i + lane);
+            }
+        }
+#endif
+        for (; i < n; i++) {
+            if (intersects_sphere({ spheres.x[i], spheres.y[i], spheres.z[i] }, spheres.r[i]))
+                visible.push_back(i);
+        }
+    }
+};
+
+#endif
@@ -7,9 +7,17 @@
 #include <stack>
 #include <string>
 #include <vector>
+#include "Checkpoint.hpp"
+#include "FrameTimes.hpp"
+#include "GpuTimer.hpp"
+#include "Gravity.hpp"
 #include "Grid.hpp"
 #include "Gui.hpp"
+#include "Headless.hpp"
+#include "Lighting.hpp"
 #include "Object.hpp"
+#include "Recording.hpp"
+#include "RenderGraph.hpp"
 #include <Camera.hpp>
 #include <Font.hpp>
 #include <cstddef>
@@ -23,25 +31,6 @@
 
 namespace gm{
 
-    struct Gbuffer {
-    private:
-        int32_t width{}, height{};
-        uint32_t quad_vbo{}, quad_ebo{};
-    public:
-        uint32_t g_position{}, g_normal{}, g_color_spec{}, fbo{}, rbo{};
-        uint32_t quad_vao{};
-        Gbuffer();
-        Gbuffer(int32_t width, int32_t height);
-        Gbuffer(const Gbuffer& other);
-        Gbuffer& operator=(const Gbuffer& other);
-        Gbuffer(Gbuffer&& other);
-        Gbuffer& operator=(Gbuffer&& other);
-        ~Gbuffer();
-
-        void bind() const;
-        void unbind(uint32_t fbo = 0) const;
-    };
-
     struct UBO {
         uint32_t id{};
         uint32_t mount_point{};
@@ -77,21 +66,6 @@ namespace gm{
         LightSourcesSSBO(uint32_t id, uint32_t mp) : SSBO(id, mp){}
     };
 
-    struct LightSource {
-        union{
-            glm::vec3 position;
-            glm::vec4 __pos_pad;
-        };
-        union{
-            glm::vec3 color;
-            glm::vec4 __color_pad;
-        };
-        float att_linear{0.014};
-        float att_quadratic{0.0007};
-        float radius{0};
-        float __att_pad{};
-        uint32_t shadow_map_id{};
-    };
     struct SSBuffers {
         LightSourcesSSBO light_sources { 0, 2 };
     };
@@ -151,6 +125,11 @@ namespace gm {
             Minimize,
             DoNothing
         };
+        // only set without a window, first so every GL object is gone before the context
+        std::unique_ptr<HeadlessContext> m_headless{};
+        HeadlessOptions m_headless_options{};
+        HeadlessScript m_script{};
+        OffscreenTarget m_offscreen{};
         int32_t m_width;
         int32_t m_height;
         double m_delta_t {};
@@ -165,7 +144,13 @@ namespace gm {
         bool m_paused { false };
         MaximizeState m_maximize { MaximizeState::DoNothing };
         size_t m_lightsources_cap {1};
-        Gbuffer m_gbuffer{};
+        RenderGraph m_render_graph{};
+        ShadowMapArray m_shadow_maps{};
+        LightClusters m_light_clusters{};
+        // lighting pass GPU time, one timer per shadow quality tier so they can be compared
+        GpuTimer m_light_pass_timers[static_cast<int>(ShadowQuality::__end)]{};
+        // labels and HUD text, flushed once per frame in render_2d
+        font::TextBatch m_text_batch{};
         GLFWwindow* m_window_ptr { nullptr };
         Camera m_camera;
 
@@ -173,6 +158,13 @@ namespace gm {
         SSBuffers m_ssbos{};
         std::vector<std::shared_ptr<obj::CelestialBody>> m_bodies {};
         std::vector<LightSource> m_light_data{};
+        // bounding spheres of everything the camera culling looks at, rebuilt every frame
+        SphereBatch m_cull_spheres{};
+        // indices into m_bodies of the bodies, trails and labels that survived the camera culling
+        std::vector<uint32_t> m_visible_bodies{}, m_visible_trails{}, m_visible_labels{};
+        // visible bodies too small on screen for a mesh, drawn as ray traced point sprites
+        std::vector<obj::ImpostorData> m_impostor_planets{}, m_impostor_stars{};
+        uint32_t m_lod_counts[obj::UnitSphereVAO::LOD_LEVELS]{};
         gui::GameUI m_gui {};
         KeybindHandler m_keybinds {};
 
@@ -185,6 +177,29 @@ namespace gm {
         bool m_typing = false;
 
         std::deque<double> m_delta_t_record{};
+        // what the HUD counter and the debug menu percentiles are computed from
+        FrameTimes m_frame_times{};
+        FrameTimesCsv m_frame_times_csv{};
+        // simulation steps since the last frame was recorded, 0 while paused
+        uint32_t m_sim_steps{};
+        // measured every update_bodies, reset whenever bodies are added or removed
+        gravity::DriftMonitor m_drift_monitor{};
+        // symbolizing is slow, so the debug menu only refreshes the list on request
+        std::vector<alloc::CallSite> m_alloc_call_sites{};
+        // simulation steps and simulated time since the game started, what recordings are stamped with
+        uint64_t m_step{};
+        double m_sim_time{};
+        // bumped by on_bodies_changed, see record::Frame::layout
+        uint64_t m_body_layout{};
+        std::unique_ptr<record::Recorder> m_recorder{};
+        // while set the bodies come from the recording and the simulation doesn't run
+        std::unique_ptr<record::Replay> m_replay{};
+        double m_replay_time{};
+        // the record the bodies show and the keyframe it was decoded from
+        size_t m_replay_record{};
+        uint64_t m_replay_layout{};
+        std::unique_ptr<scene::CheckpointWriter> m_checkpoints{};
+        uint64_t m_checkpoint_every{};
     public:
         struct WindowRect {
             float x, y, w, h;
@@ -208,15 +223,26 @@ namespace gm {
 
     private:
         void initialize();
+        void initialize_headless();
+        void initialize_hud();
         void initialize_uniforms();
         void initialize_key_bindings();
         void initialize_singletons();
         void update();
         void update_bodies();
         void update_buffers();
+        // fixed time step, camera from the script, no GUI, writes the timings report at the end
+        void run_headless();
         void render();
+        void cull_scene();
+        void select_lods(bool allow_impostors);
+        void render_impostors(Shader* shader, const std::vector<obj::ImpostorData>& impostors);
+        void render_shadow_maps();
         void render_gbuffer();
-        void render_light_volumes();
+        void render_lighting(uint32_t g_depth, uint32_t g_normal, uint32_t g_albedo_spec);
+        void render_forward(bool normals_draw, bool wireframe_draw);
+        // declares this frame's passes, the graph decides the order and owns the gbuffer targets
+        void build_render_graph(bool normals_draw, bool wireframe_draw);
         void remove_body(obj::CelestialBody* body);
         void continuos_key_input();
         void framebuffer_size_handler(GLFWwindow* window, int width, int height);
@@ -243,6 +269,8 @@ namespace gm {
             int mods);
 
         void add_planet(obj::Planet new_planet);
+        // inserts them all at once, the light sources only get collected once at the end
+        void add_bodies(const std::vector<gravity::Gravdata>& bodies, const std::string& name_prefix);
         void remove_planet(obj::Planet* planet);
         void add_star(obj::Star&& new_start);
         void remove_star(obj::Star* star);
@@ -252,12 +280,46 @@ namespace gm {
         void on_body_selected(std::shared_ptr<obj::CelestialBody> body);
         void load_custom_textures_paths();
         void load_texture_from_path(const std::filesystem::path&);
+        // loaded already or loaded now, nullptr if there's no such file
+        std::shared_ptr<obj::Texture> find_texture(const std::string& path);
+        void remove_all_bodies();
+        // after bodies were added or removed, the drift baseline and the recording layout start over
+        void on_bodies_changed();
+        // hands the current state to the recorder, the encoding happens on its thread
+        void record_frame();
+        // the bodies as a scene file sees them, what saving and checkpoints write
+        scene::SceneData capture_scene() const;
+        // advances the replay clock and shows the record it lands on
+        void update_replay();
+        // rebuilds the bodies only when the frame has other bodies than the ones shown
+        void apply_replay_frame(const record::Frame& frame);
     public:
         ~Game();
         Game();
+        // renders the script offscreen instead of opening a window
+        explicit Game(const HeadlessOptions& options);
         Game(const Game&) = delete;
         Game& operator=(const Game&) = delete;
         void run();
+        // writes a row per frame to a CSV file from now on, throws if it can't be opened
+        void stream_frame_times(const std::filesystem::path& path);
+        // one of gm::scene::SCENE_NAMES, throws for an unknown name
+        void generate_scene(const std::string& name, size_t bodies, uint32_t seed, bool replace);
+        // binary scene files, see SceneFile.hpp, both throw when the file can't be read or written
+        void save_scene(const std::filesystem::path& path);
+        void load_scene(const std::filesystem::path& path, bool replace);
+        // records every interval simulation steps from now on, see Recording.hpp, throws if the file can't be created
+        void start_recording(const std::filesystem::path& path, uint32_t interval);
+        // finishes writing the recording, does nothing when not recording
+        void stop_recording();
+        // replaces the bodies with the recording and plays it instead of simulating, throws if it can't be read
+        void start_replay(const std::filesystem::path& path);
+        // the bodies stay where the replay was, moving on with the speed they had in it
+        void stop_replay();
+        // a checkpoint every N simulation steps from now on, written on a thread, see Checkpoint.hpp
+        void start_checkpoints(const std::filesystem::path& base, uint64_t every, uint32_t keep);
+        // waits for the checkpoint being written, does nothing without checkpoints
+        void stop_checkpoints();
     };
 }
 #endif
@@ -0,0 +1,53 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+#include <cstdint>
+#include <glad/glad.h>
+
+// Thin cache in front of the GL state the renderer keeps flipping. Every call checks the
+// cached value first, so redundant state changes never reach the driver.
+// Anything that changes this state has to go through here, otherwise the cache lies.
+namespace gm::gl_state {
+    struct Stats {
+        // calls forwarded to GL
+        uint32_t calls{};
+        // calls dropped because the state was already set
+        uint32_t skipped{};
+        uint32_t program_binds{};
+        uint32_t framebuffer_binds{};
+        uint32_t draw_calls{};
+    };
+
+    void enable(GLenum cap);
+    void disable(GLenum cap);
+    void set_enabled(GLenum cap, bool enabled);
+    void blend_func(GLenum src, GLenum dst);
+    void cull_face(GLenum mode);
+    void depth_func(GLenum func);
+    // always GL_FRONT_AND_BACK, core profile doesn't allow anything else
+    void polygon_mode(GLenum mode);
+    void use_program(uint32_t program);
+    // GL_FRAMEBUFFER binds both the read and the draw target
+    void bind_framebuffer(GLenum target, uint32_t fbo);
+    void viewport(int32_t x, int32_t y, int32_t width, int32_t height);
+    void pixel_store(GLenum pname, int32_t value);
+
+    // draws only go through here so they can be counted
+    void draw_arrays(GLenum mode, int32_t first, int32_t count);
+    void draw_arrays_instanced(GLenum mode, int32_t first, int32_t count, int32_t instances);
+    void draw_elements(GLenum mode, int32_t count, GLenum type, const void* offset);
+    void draw_elements_instanced(GLenum mode, int32_t count, GLenum type, const void* offset, int32_t instances);
+
+    // a deleted name can be handed out again, so it must not stay cached as bound
+    void forget_program(uint32_t program);
+    void forget_framebuffer(uint32_t fbo);
+    // forget everything, for when GL was touched behind our back
+    void invalidate();
+
+    // stores the counters of the finished frame and starts counting again
+    void end_frame();
+    const Stats& get_last_frame_stats();
+    // counters of the frame that is still being recorded
+    const Stats& get_frame_stats();
+}
+
+#endif
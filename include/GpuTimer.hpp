@@ -0,0 +1,58 @@
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+#include <cstdint>
+
+namespace gm {
+
+    // Measures how long the GPU spends on the commands between begin() and end().
+    // Results are read back a few frames later so the CPU never waits on the GPU,
+    // if every query is still in flight the frame simply isn't measured.
+    // Timers use a pair of GL_TIMESTAMP queries, so unlike GL_TIME_ELAPSED they can nest.
+    class GpuTimer {
+    public:
+        inline static constexpr uint32_t QUERY_COUNT = 4;
+        inline static constexpr uint32_t HISTORY_SIZE = 120;
+    private:
+        // begin and end timestamp of every measurement in flight
+        uint32_t m_queries[QUERY_COUNT][2]{};
+        // query used by the next begin()
+        uint32_t m_next{};
+        uint32_t m_pending{};
+        bool m_running{};
+        float m_last_ms{}, m_average_ms{};
+        bool m_has_result{};
+        // shows up in the profiler trace when set, has to outlive the timer
+        const char* m_name{};
+        float m_history[HISTORY_SIZE]{};
+        uint32_t m_history_offset{};
+
+        void collect();
+        void release();
+    public:
+        GpuTimer();
+        explicit GpuTimer(const char* name);
+        GpuTimer(const GpuTimer&) = delete;
+        GpuTimer& operator=(const GpuTimer&) = delete;
+        GpuTimer(GpuTimer&&);
+        GpuTimer& operator=(GpuTimer&&);
+        ~GpuTimer();
+
+        // false when the driver has no timestamp queries, the timers then never get a result
+        static bool is_supported();
+        // lines the GL clock up with the profiler clock, once per frame
+        static void sync_clock();
+
+        void begin();
+        void end();
+        // false until the first result made it back from the GPU
+        bool has_result() const;
+        float get_last_ms() const;
+        // exponential moving average, steadier to look at than the last value
+        float get_average_ms() const;
+        // ring of the last HISTORY_SIZE results, the oldest one is at get_history_offset()
+        const float* get_history() const;
+        uint32_t get_history_offset() const;
+    };
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef GRAVITY_HPP
+#define GRAVITY_HPP
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// N-body kernels that don't need a window or GL, shared by the game, the trajectory predictor
+// and the benchmark
+namespace gm::gravity {
+    inline constexpr float GRAV_CONST = 6.674e-11f;
+    // one unit of mass in the simulation is equal to 10 kg
+    inline constexpr float MASS_BOOST_FACTOR = 1e4f;
+    // gravitational constant in simulation mass units, the game kernel applies it to the boosted masses
+    inline constexpr float SIM_GRAV_CONST = GRAV_CONST * MASS_BOOST_FACTOR * MASS_BOOST_FACTOR;
+
+    struct Gravdata {
+        float mass {};
+        glm::vec3 pos {};
+        glm::vec3 vel {};
+        glm::vec3 acc {};
+        float radius {};
+        bool is_star {};
+    };
+
+    // Fixed set of threads for splitting a loop over bodies. The calling thread works as well,
+    // so a pool of one thread never leaves it.
+    class WorkerPool {
+        std::vector<std::thread> m_workers{};
+        std::mutex m_mutex{};
+        std::condition_variable m_start{}, m_done{};
+        const std::function<void(uint32_t, uint32_t)>* m_job{};
+        uint64_t m_generation{};
+        uint32_t m_busy{};
+        bool m_stop{};
+
+        void work(uint32_t index);
+    public:
+        explicit WorkerPool(uint32_t threads);
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+        ~WorkerPool();
+
+        uint32_t size() const;
+        // calls job(index, size()) once on every thread and waits for all of them
+        void run(const std::function<void(uint32_t, uint32_t)>& job);
+        // [begin, end) of the items thread index should handle
+        static std::pair<size_t, size_t> split(size_t items, uint32_t index, uint32_t count);
+    };
+
+    // The kernel from Game::update_bodies: every pair once, the force gets added straight
+    // to the velocity of both bodies. Colliding bodies lose their mass to the heavier one.
+    // A step over many bodies takes long, so cancelled is asked once per body and the step stops
+    // as soon as it says so. The bodies are left half stepped then and false is returned.
+    bool step_pairwise(std::vector<Gravdata>& bodies, double delta_t, bool do_collision, const std::function<bool()>& cancelled = {});
+    // Drift-kick-drift leapfrog with proper accelerations and softening, symplectic so the energy
+    // error stays bounded. Every body sums all others, which splits cleanly over the pool.
+    void step_leapfrog(std::vector<Gravdata>& bodies, double delta_t, WorkerPool& pool, float softening);
+    // kinetic plus potential energy with SIM_GRAV_CONST, O(N^2)
+    double total_energy(const std::vector<Gravdata>& bodies, WorkerPool& pool, float softening);
+
+    // Quantities a closed system keeps, in simulation units with SIM_GRAV_CONST.
+    // Momenta are about the origin, the *_norm sums give the drift a scale when the totals are close to 0.
+    struct Invariants {
+        double kinetic{}, potential{};
+        glm::dvec3 momentum{}, angular_momentum{};
+        // sum of |m v| and |r x m v| over the bodies
+        double momentum_norm{}, angular_momentum_norm{};
+        size_t bodies{};
+
+        double energy() const;
+        // 2K / |W|, 1 in virial equilibrium, 0 when there is no potential
+        double virial_ratio() const;
+        // adds the kinetic and momentum terms of one body, the potential is up to the caller
+        void add_body(float mass, glm::vec3 pos, glm::vec3 vel);
+    };
+    // every term, the potential is O(N^2) split over the pool
+    Invariants measure(const std::vector<Gravdata>& bodies, WorkerPool& pool, float softening);
+    // The game kernel adds the force straight to the velocity, without dividing by the mass or
+    // multiplying by dt. That is Newtonian motion of bodies with unit inertia in a potential scaled
+    // by 1 / dt, so the invariants it keeps are sum v, sum r x v and
+    // sum |v|^2 / 2 - SIM_GRAV_CONST sum m_i m_j / (r_ij dt), unsoftened like the kernel.
+    // measure() of a pairwise run mostly measures how far those are from the Newtonian ones.
+    Invariants measure_pairwise(const std::vector<Gravdata>& bodies, WorkerPool& pool, double delta_t);
+
+    // Keeps the drift of the invariants relative to a baseline, the first sample after a reset.
+    // Feeding it is O(1), the O(N) and O(N^2) parts are whoever measures the samples.
+    class DriftMonitor {
+    public:
+        inline static constexpr uint32_t HISTORY_SIZE = 600;
+        enum Series : uint32_t {
+            // (E - E0) / |E0|
+            Energy = 0,
+            // |P - P0| / sum |m v|, the larger sum of the baseline and the sample so a scene starting
+            // at rest still gets a scale, absolute when both are 0
+            Momentum,
+            // |L - L0| / sum |r x m v|, scaled like the momentum
+            AngularMomentum,
+            VirialRatio,
+            __end
+        };
+        inline static constexpr const char* SERIES_NAMES[] = { "Energy", "Momentum", "Angular momentum", "Virial ratio" };
+    private:
+        std::optional<Invariants> m_baseline{};
+        Invariants m_last{};
+        float m_history[Series::__end][HISTORY_SIZE]{};
+        uint32_t m_history_offset{};
+        uint32_t m_samples{};
+    public:
+        void reset();
+        void add(const Invariants& sample);
+        // 0 before the first sample
+        float get_last(Series series) const;
+        const Invariants& get_last_invariants() const;
+        // ring of the last HISTORY_SIZE values, the oldest one is at get_history_offset()
+        const float* get_history(Series series) const;
+        uint32_t get_history_offset() const;
+        // samples since the last reset
+        uint32_t get_samples() const;
+    };
+}
+
+#endif
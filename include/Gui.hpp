@@ -52,6 +52,14 @@ struct SpawnMenu {
     glm::vec3 color { glm::vec3(0.5, 0.5, 0.5) };
     bool is_star { false };
     char name[256] = "";
+    // index into gm::scene::SCENE_NAMES
+    int scene { 1 };
+    int scene_bodies { 1000 };
+    int scene_seed { 1 };
+    bool scene_replace { true };
+    char scene_file[512] = "scene.bin";
+    // result of the last save or load
+    std::string scene_file_status {};
 };
 struct GameOptionsMenu {
     bool draw_selection_marker {true};
@@ -64,6 +72,21 @@ struct GameOptionsMenu {
     bool draw_trails { true };
     float grid_scale { 30.0 };
     glm::vec4 grid_color { 1.0, 1.0, 1.0, 0.025 };
+    // index into gm::ShadowQuality
+    int shadow_quality { 3 };
+    char record_file[512] = "recording.islrec";
+    int record_interval { 10 };
+    // why the last recording couldn't start
+    std::string record_error {};
+    char replay_file[512] = "recording.islrec";
+    // simulated seconds per real second
+    float replay_speed { 1.0 };
+    bool replay_loop { true };
+    std::string replay_error {};
+    char checkpoint_file[512] = "checkpoint.bin";
+    int checkpoint_every { 3600 };
+    int checkpoint_keep { 3 };
+    std::string checkpoint_error {};
     struct Resolution {
         int32_t width {}, height {};
         std::string str {};
@@ -0,0 +1,117 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+#include "AllocTracker.hpp"
+#include "GlState.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gm {
+
+    // A scripted run without a window, read from a plain text file:
+    //   size 1280 720
+    //   frames 600
+    //   warmup 10                                frames run before measuring, not in the report
+    //   delta_t 0.016
+    //   shadow_quality 3
+    //   scene plummer 200 1                      generated scene: name, bodies, seed
+    //   star 0 0 0  0 0 0  26.6  0.78 0.52 0.06  position, velocity, mass, color
+    //   planet 15 0 0  -3.5 0 9.3  100  1 0.1 0.1
+    //   camera 0  0 20 60  0 0 0                 frame, position, target
+    // Camera keys are interpolated linearly, # starts a comment.
+    struct HeadlessScript {
+        struct Body {
+            bool is_star{};
+            glm::vec3 pos{}, vel{};
+            float mass{};
+            glm::vec3 color{ 0.5f };
+        };
+        struct CameraKey {
+            uint32_t frame{};
+            glm::vec3 pos{}, target{};
+        };
+        int32_t width{ 1280 }, height{ 720 };
+        uint32_t frames{ 300 };
+        uint32_t warmup{ 10 };
+        double delta_t{ 1.0 / 60.0 };
+        int shadow_quality{ 3 };
+        std::string scene{};
+        size_t scene_bodies{};
+        uint32_t scene_seed{ 1 };
+        std::vector<Body> bodies{};
+        std::vector<CameraKey> camera{};
+
+        static HeadlessScript load(const std::filesystem::path& path);
+        // position and target of the camera at the given frame
+        std::pair<glm::vec3, glm::vec3> camera_at(uint32_t frame) const;
+    };
+
+    struct HeadlessOptions {
+        std::filesystem::path script{};
+        // timings JSON, stdout when empty
+        std::filesystem::path output{};
+        // overrides the frame count of the script when not 0
+        uint32_t frames{};
+        // CPU and GPU zones of the whole run as a Chrome trace, not written when empty
+        std::filesystem::path trace{};
+    };
+
+    // sums up the measured frames of a headless run
+    class HeadlessReport {
+        struct PassStats {
+            std::string name{};
+            double cpu_ms{}, gpu_ms{};
+            uint64_t draw_calls{};
+            uint32_t frames{}, gpu_frames{};
+        };
+        std::vector<double> m_frame_ms{};
+        // in the order they first ran
+        std::vector<PassStats> m_passes{};
+        uint64_t m_draw_calls{}, m_gl_calls{}, m_skipped_gl_calls{}, m_program_binds{}, m_framebuffer_binds{};
+        uint64_t m_allocations{}, m_allocated_bytes{}, m_max_frame_allocations{};
+
+        PassStats& pass(const std::string& name);
+    public:
+        void add_frame(double cpu_ms, const gl_state::Stats& stats, const alloc::Counters& allocs);
+        void add_pass(const std::string& name, float cpu_ms, uint32_t draw_calls);
+        // GPU results come back a few frames late, so they are counted on their own
+        void add_gpu_pass(const std::string& name, double gpu_ms);
+        void write_json(std::ostream& os, const HeadlessScript& script, const std::string& renderer) const;
+    };
+
+    // GL 4.6 core context without a window or a display server. Uses EGL on the surfaceless
+    // platform, which Mesa's llvmpipe provides on machines without a GPU.
+    // Only available when built with ISLANDS_HEADLESS, otherwise creating one throws.
+    class HeadlessContext {
+        void* m_display{};
+        void* m_context{};
+    public:
+        HeadlessContext();
+        HeadlessContext(const HeadlessContext&) = delete;
+        HeadlessContext& operator=(const HeadlessContext&) = delete;
+        ~HeadlessContext();
+        // loads the GL functions through glad, the context has to be current
+        void load_gl() const;
+    };
+
+    // color and depth target standing in for the default framebuffer
+    class OffscreenTarget {
+        uint32_t m_fbo{}, m_color{}, m_depth{};
+        void release();
+    public:
+        OffscreenTarget();
+        OffscreenTarget(int32_t width, int32_t height);
+        OffscreenTarget(const OffscreenTarget&) = delete;
+        OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+        OffscreenTarget(OffscreenTarget&&);
+        OffscreenTarget& operator=(OffscreenTarget&&);
+        ~OffscreenTarget();
+        uint32_t get_framebuffer() const;
+    };
+}
+
+#endif
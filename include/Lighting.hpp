@@ -0,0 +1,123 @@
+#ifndef LIGHTING_HPP
+#define LIGHTING_HPP
+#include "shader/Shader.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace gm {
+
+    // mirrors the std430 LightSource struct in light_pass.frag
+    struct LightSource {
+        union{
+            glm::vec3 position;
+            glm::vec4 __pos_pad;
+        };
+        union{
+            glm::vec3 color;
+            glm::vec4 __color_pad;
+        };
+        float att_linear{0.014};
+        float att_quadratic{0.0007};
+        float radius{0};
+        float __att_pad{};
+        // layer of the star's shadow cube map in the ShadowMapArray, -1 if the light casts no shadows
+        int32_t shadow_layer{-1};
+        float __layer_pad[3]{};
+    };
+    static_assert(sizeof(LightSource) == 64, "LightSource has to match the std430 layout used in the shaders");
+
+    // PCF kernel size used by the lighting pass, every tier is its own shader permutation
+    enum class ShadowQuality : int {
+        Hard = 0,
+        Low,
+        Medium,
+        High,
+        __end
+    };
+    inline static constexpr uint32_t SHADOW_QUALITY_TAPS[] = { 1, 4, 8, 20 };
+    inline static constexpr const char* SHADOW_QUALITY_NAMES[] = { "Hard (1 tap)", "Low (4 taps)", "Medium (8 taps)", "High (20 taps)" };
+
+    // Every star renders its shadow cube map into a layer of a single cube map array,
+    // this way the lighting pass can look up the shadow of any light with one sampler.
+    class ShadowMapArray {
+    public:
+        // every layer costs 6 * width * height depth texels so the amount of shadow casting lights is capped
+        inline static constexpr uint32_t MAX_SHADOW_CASTING_LIGHTS = 16;
+    private:
+        uint32_t m_texture{}, m_fbo{};
+        uint32_t m_capacity{};
+        uint32_t m_width{}, m_height{};
+
+        void release();
+    public:
+        ShadowMapArray();
+        ShadowMapArray(const ShadowMapArray&) = delete;
+        ShadowMapArray& operator=(const ShadowMapArray&) = delete;
+        ShadowMapArray(ShadowMapArray&&);
+        ShadowMapArray& operator=(ShadowMapArray&&);
+        ~ShadowMapArray();
+
+        // makes sure there is room for the given amount of lights (up to MAX_SHADOW_CASTING_LIGHTS)
+        void reserve(uint32_t lights);
+        uint32_t get_capacity() const;
+        uint32_t get_texture() const;
+        // layered framebuffer with the whole array attached, the shadow geometry shader picks the layer
+        uint32_t get_framebuffer() const;
+        uint32_t get_width() const;
+        uint32_t get_height() const;
+    };
+
+    // CPU side light culling, lights get binned into view space clusters (froxels)
+    // so the lighting pass only has to evaluate the lights that can reach a given pixel.
+    class LightClusters {
+    public:
+        inline static constexpr uint32_t CLUSTERS_X = 16;
+        inline static constexpr uint32_t CLUSTERS_Y = 9;
+        inline static constexpr uint32_t CLUSTERS_Z = 24;
+        inline static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+        inline static constexpr uint32_t CLUSTERS_MOUNT_POINT = 3;
+        inline static constexpr uint32_t LIGHT_INDICES_MOUNT_POINT = 4;
+
+        struct Cluster {
+            uint32_t offset{};
+            uint32_t count{};
+        };
+        struct Stats {
+            uint32_t lights_binned{};
+            uint32_t light_references{};
+            uint32_t max_lights_per_cluster{};
+        };
+    private:
+        struct ClusterRange {
+            uint32_t light{};
+            uint32_t x0{}, x1{}, y0{}, y1{}, z0{}, z1{};
+        };
+        uint32_t m_clusters_ssbo{}, m_indices_ssbo{};
+        float m_near{}, m_far{};
+        std::vector<Cluster> m_clusters{};
+        std::vector<uint32_t> m_indices{};
+        std::vector<ClusterRange> m_ranges{};
+        Stats m_stats{};
+
+        uint32_t slice_for_depth(float depth) const;
+        void release();
+    public:
+        LightClusters();
+        LightClusters(const LightClusters&) = delete;
+        LightClusters& operator=(const LightClusters&) = delete;
+        LightClusters(LightClusters&&);
+        LightClusters& operator=(LightClusters&&);
+        ~LightClusters();
+
+        void build(const std::vector<LightSource>& lights, const glm::mat4& view, const glm::mat4& projection, float near, float far);
+        // uploads the cluster grid and the light index list and binds them to their mount points
+        void upload();
+        void set_uniforms(Shader* shader) const;
+        const Stats& get_stats() const;
+    };
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+#include <cstddef>
+#include <filesystem>
+
+namespace gm {
+    // A whole file mapped read only, what scene files and recordings are read through.
+    class MappedFile {
+        const std::byte* m_data{};
+        size_t m_size{};
+#ifdef _WIN32
+        void* m_file{};
+        void* m_mapping{};
+#endif
+        void unmap();
+    public:
+        MappedFile() = default;
+        // throws if the file can't be opened or mapped, an empty file maps to nothing
+        explicit MappedFile(const std::filesystem::path& path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) noexcept;
+        MappedFile& operator=(MappedFile&&) noexcept;
+        ~MappedFile();
+
+        const std::byte* data() const;
+        size_t size() const;
+    };
+}
+
+#endif
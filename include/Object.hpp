@@ -1,6 +1,10 @@
 #ifndef OBJECT_HPP
 #define OBJECT_HPP
 #include "Font.hpp"
+#include "Frustum.hpp"
+#include "GlState.hpp"
+#include "GpuTimer.hpp"
+#include "Gravity.hpp"
 #include "VertexArrayObject.hpp"
 #include "shader/Shader.hpp"
 #include "Util.hpp"
@@ -51,7 +55,7 @@ public:
 public:
     inline void draw() const {
         glBindVertexArray(m_vao);
-        glDrawArrays(GL_POINTS, 0, 1);
+        gm::gl_state::draw_arrays(GL_POINTS, 0, 1);
         glBindVertexArray(0);
     }
 };
@@ -79,12 +83,54 @@ public:
     void forward_render(const glm::vec3& camera_pos, glm::vec3 pos, float radius) const;
 };
 
+// One storage buffer shared by every trail. Each trail owns a range of it and uses the range
+// as a ring, so pushing a point only uploads that single point.
+class TrailPool : public VertexArrrayObject {
+    struct Range {
+        uint32_t offset{};
+        uint32_t size{};
+    };
+    // sizes are in points
+    uint32_t m_capacity{};
+    uint32_t m_used{};
+    std::vector<Range> m_free{};
+
+    void grow(uint32_t min_capacity);
+public:
+    inline static constexpr uint32_t MOUNT_POINT = 5;
+    inline static constexpr uint32_t INITIAL_CAPACITY = 4096;
+    TrailPool();
+    TrailPool(const TrailPool&) = delete;
+    TrailPool& operator=(const TrailPool&) = delete;
+    TrailPool(TrailPool&&);
+    TrailPool& operator=(TrailPool&&);
+    virtual ~TrailPool();
+
+    // nullptr once the buffer instances have been unloaded
+    static TrailPool* instance();
+    // trails are only created and changed while the buffer instances are loaded, throws otherwise.
+    // Only releasing a trail has to cope with a missing pool, trails can outlive unload_all
+    static TrailPool& get();
+    uint32_t allocate(uint32_t points);
+    void release(uint32_t offset, uint32_t points);
+    void write(uint32_t offset, const glm::vec3* points, uint32_t count);
+    virtual void bind() const override;
+};
+
 class Trail final {
-    uint32_t m_vao{}, m_vbo{}, m_ebo{};
+    // where this trail's ring starts in the TrailPool
+    uint32_t m_offset{};
+    // ring slot holding the oldest point, the next push overwrites it
+    uint32_t m_head{};
     std::size_t m_size{};
+    // CPU copy of the ring, only needed for the bounds
     std::vector<glm::vec3> m_data{};
     glm::vec4 m_color{1.0};
+    // axis aligned bounds of m_data, kept up to date as points are pushed
+    glm::vec3 m_bounds_min{}, m_bounds_max{};
 
+    void recalculate_bounds();
+    void release();
 public:
     Trail();
     Trail(uint32_t points);
@@ -100,6 +146,8 @@ public:
     void copy_from_vector(const std::vector<glm::vec3>&);
 
     std::size_t size() const;
+    // center and radius of a sphere enclosing every point of the trail
+    std::tuple<glm::vec3, float> get_bounding_sphere() const;
 
     glm::vec4 get_color() const;
     void set_color(glm::vec4);
@@ -136,9 +184,19 @@ private:
         std::vector<VertexData> vertices;
         std::vector<int32_t> indices;
     };
-    size_t m_num_indices {}, m_num_verticies {};
+public:
+    // icosphere subdivision levels, from 20 triangles up to 20 * 4^(LOD_LEVELS - 1)
+    inline static constexpr uint32_t LOD_LEVELS = 5;
+private:
+    struct LodRange {
+        size_t first_index{};
+        size_t num_indices{};
+    };
+    LodRange m_lods[LOD_LEVELS] {};
+    size_t m_num_verticies {};
     uint32_t make_unit_sphere_vbo(const UnitSphereCreationData& data);
     uint32_t make_unit_sphere_ebo(const UnitSphereCreationData& data);
+    // every lod level is stored back to back in the same vertex and index buffer
     UnitSphereCreationData make_unit_sphere();
 
 public:
@@ -148,7 +206,27 @@ public:
     UnitSphereVAO(UnitSphereVAO&& other);
     UnitSphereVAO& operator=(UnitSphereVAO&& other);
     virtual ~UnitSphereVAO();
-    void draw() const;
+    void draw(uint32_t lod = LOD_LEVELS - 1) const;
+    // picks the mesh detail for a sphere covering radius_px pixels on screen
+    static uint32_t lod_for_screen_radius(float radius_px);
+    static uint32_t triangle_count(uint32_t lod);
+};
+
+// a sphere that is too small on screen to be worth a mesh, it gets ray traced in a point sprite instead
+struct ImpostorData {
+    glm::vec3 center{};
+    float radius{};
+    glm::vec3 color{};
+};
+class ImpostorBatchVAO : public VertexArrrayObject {
+public:
+    ImpostorBatchVAO();
+    ImpostorBatchVAO(const ImpostorBatchVAO&) = delete;
+    ImpostorBatchVAO& operator=(const ImpostorBatchVAO&) = delete;
+    ImpostorBatchVAO(ImpostorBatchVAO&& other);
+    ImpostorBatchVAO& operator=(ImpostorBatchVAO&& other);
+    virtual ~ImpostorBatchVAO();
+    void draw(const std::vector<ImpostorData>& impostors) const;
 };
 
 class CelestialBody {
@@ -170,11 +248,12 @@ protected:
     float m_axial_tilt{0.0};
     float m_rotation_speed{0.0};
     float m_rotation{0};
+    // mesh detail used by the camera passes, picked every frame from the size on screen
+    uint32_t m_lod{UnitSphereVAO::LOD_LEVELS - 1};
     inline static constexpr uint32_t DEFAULT_TRAIL_POINT_N = 36;
 protected:
 public:
-    // one unit of mass in the simulation is equal to 10 kg
-    inline static const float MASS_BOOST_FACTOR = 1e4;
+    inline static const float MASS_BOOST_FACTOR = gm::gravity::MASS_BOOST_FACTOR;
     CelestialBody();
     CelestialBody(UnitSphereVAO* sphere = nullptr,
         glm::vec3 pos = glm::vec3(0),
@@ -190,9 +269,12 @@ public:
     virtual void fixed_update();
     virtual void forward_render(bool render_normals = false, bool render_wireframe = false, bool render_trails = true);
     virtual void deferred_render() = 0;
-    virtual void shadow_render();
+    // face_mask selects which of the 6 shadow cube map faces the body gets rendered into
+    virtual void shadow_render(uint32_t face_mask = 0x3F, uint32_t lod = UnitSphereVAO::LOD_LEVELS - 1);
     virtual glm::vec3 get_pos() const;
     virtual void set_pos(glm::vec3 pos);
+    // unlike set_pos the trail follows, for bodies moved by a replay instead of the simulation
+    void move_to(glm::vec3 pos);
     virtual float get_mass() const;
     virtual void set_mass(float m);
     virtual float get_radius() const;
@@ -203,12 +285,15 @@ public:
     virtual void set_name(std::string&& name);
     virtual const std::string& get_name() const;
     virtual const font::Text3D& label();
+    virtual Trail& trail();
     virtual void set_texture(std::shared_ptr<Texture> texture);
     virtual std::shared_ptr<Texture> get_texture() const;
     virtual float get_axial_tilt() const;
     virtual void set_axial_tilt(float tilt);
     virtual float get_rotation_speed() const;
     virtual void set_rotation_speed(float rot_speed);
+    uint32_t get_lod() const;
+    void set_lod(uint32_t lod);
 };
 
 class Planet : public CelestialBody {
@@ -238,6 +323,14 @@ public:
 class Star : public CelestialBody {
 public:
     inline static const float s_shadow_far_plane = 100.0f;
+    struct ShadowCullStats {
+        // bodies that could cast a shadow
+        uint32_t casters{};
+        // bodies that were actually submitted to the shadow pass
+        uint32_t submitted{};
+        // cube map faces that were skipped across all submitted bodies
+        uint32_t faces_culled{};
+    };
 private:
     inline static float calculate_radius(float mass) {
         //get radius of a sphere from density equation,
@@ -251,7 +344,8 @@ private:
     float m_attenuation_quadratic{};
     float m_light_source_radius{};
 
-    uint32_t m_shadow_cube_map_id{};
+    // layer of this star's cube map in the shared shadow map array, -1 if it casts no shadows
+    int32_t m_shadow_layer{-1};
 
     inline static constexpr uint32_t SHADOW_MAP_W = 1024;
     inline static constexpr uint32_t SHADOW_MAP_H = 1024;
@@ -269,7 +363,9 @@ private:
         {1},
         {1}
     };
-    uint32_t m_shadow_map_fbo{};
+    Frustum m_shadow_frusta[6] = {};
+    ShadowCullStats m_shadow_cull_stats{};
+    gm::GpuTimer m_shadow_timer{ "shadow map star" };
 
 public:
     Star(Shader* shader = nullptr,
@@ -290,10 +386,20 @@ public:
     float get_attenuation_linear() const;
     float get_attenuation_quadratic() const;
     float get_light_source_radius() const;
-    uint32_t get_shadow_map_id() const;
+    int32_t get_shadow_layer() const;
+    void set_shadow_layer(int32_t layer);
     virtual void set_color(glm::vec3 color) override;
     const glm::mat4* get_shadow_transforms_ptr() const;
     void load_shadow_transforms_uniform();
+    // bitmask of the shadow cube map faces a sphere is visible from, 0 if it can't cast a shadow at all
+    uint32_t shadow_face_mask(const glm::vec3& center, float radius) const;
+    // mesh detail for a caster, based on how many shadow map texels it covers
+    uint32_t shadow_lod(const glm::vec3& center, float radius) const;
+    void reset_shadow_cull_stats();
+    void record_shadow_caster(uint32_t face_mask);
+    const ShadowCullStats& get_shadow_cull_stats() const;
+    // GPU time of this star's part of the shadow pass
+    gm::GpuTimer& get_shadow_timer();
 
     inline static void set_shadow_map_size(uint32_t width, uint32_t height){
         s_shadow_map_width = width;
@@ -307,7 +413,6 @@ public:
     inline static std::tuple<uint32_t, uint32_t> get_shadow_map_size(){
         return {s_shadow_map_width, s_shadow_map_height};
     }
-    uint32_t get_shadow_map_fbo() const;
 private:
     static float calc_attenuation_linear(float);
     static float calc_attenuation_quadratic(float);
@@ -0,0 +1,73 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#define PROFILER_CONCAT_IMPL(A, B) A##B
+#define PROFILER_CONCAT(A, B) PROFILER_CONCAT_IMPL(A, B)
+// times the rest of the enclosing scope, NAME has to outlive the profiler (a string literal)
+#define PROFILE_ZONE(NAME) gm::profiler::Zone PROFILER_CONCAT(__profile_zone_, __LINE__) { NAME }
+
+// CPU frame profiler. Zones are pushed into a ring buffer owned by the thread that recorded them,
+// the main thread drains all rings once per frame, so recording never takes a lock.
+// Full rings drop zones instead of blocking the producer.
+namespace gm::profiler {
+    inline constexpr uint32_t RING_SIZE = 4096;
+    // zones kept for the trace export, the oldest ones are dropped after that
+    inline constexpr size_t CAPTURE_LIMIT = 1 << 20;
+    // lane of the zones measured by GpuTimer
+    inline constexpr uint32_t GPU_THREAD = UINT32_MAX;
+
+    struct ZoneEvent {
+        const char* name{};
+        // nanoseconds since the profiler started
+        uint64_t start{}, end{};
+        uint32_t depth{};
+        uint32_t thread{};
+        // heap allocations inside the zone, children included, only counted with ISLANDS_ALLOC_TRACKING
+        uint32_t allocations{};
+        uint64_t bytes{};
+    };
+    struct ThreadInfo {
+        uint32_t id{};
+        const char* name{};
+    };
+
+    class Zone {
+        const char* m_name{};
+        uint64_t m_start{};
+        uint64_t m_allocations{}, m_bytes{};
+        bool m_recording{};
+    public:
+        explicit Zone(const char* name);
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+        ~Zone();
+    };
+
+    uint64_t now();
+    void set_enabled(bool enabled);
+    bool is_enabled();
+    // shows up as the lane name, NAME has to outlive the profiler as well
+    void set_thread_name(const char* name);
+
+    // main thread only, collects the zones every thread finished since the last call
+    void end_frame();
+    uint64_t get_last_frame_start();
+    uint64_t get_last_frame_end();
+    // zones that ended during the last frame plus the GPU zones read back in it, sorted by thread, then start
+    const std::vector<ZoneEvent>& get_last_frame();
+    std::vector<ThreadInfo> get_threads();
+    // main thread only, times already converted to profiler time, shows up in the next frame
+    void add_gpu_zone(const char* name, uint64_t start, uint64_t end);
+    // zones lost because a ring was full
+    uint64_t get_dropped();
+
+    void start_capture();
+    bool is_capturing();
+    // writes everything recorded since start_capture as Chrome trace_event JSON (chrome://tracing, Perfetto)
+    void stop_capture(const std::filesystem::path& path);
+}
+
+#endif
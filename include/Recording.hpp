@@ -0,0 +1,188 @@
+#ifndef RECORDING_HPP
+#define RECORDING_HPP
+#include "MappedFile.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <thread>
+#include <vector>
+
+// Recordings of a running simulation, appended to while it runs.
+// A header, then one chunk per recorded step, then an index of every chunk and a trailer pointing at it.
+// Positions are quantized to a grid of ChunkHeader::scale: keyframes store them as int32 together with
+// everything else the renderer needs, delta chunks only the difference to the previous chunk as
+// zigzag varints, which for bodies that barely moved is a byte or two per axis.
+// Quantizing the differences of already quantized positions is exact, so errors never pile up.
+// A recording whose trailer is missing (the game crashed) can still be read chunk by chunk.
+namespace gm::record {
+    inline constexpr char FILE_MAGIC[8] = { 'I', 'S', 'L', 'R', 'E', 'C', 'O', 'R' };
+    inline constexpr uint32_t FILE_VERSION = 1;
+    // a keyframe grid covers 2^QUANT_BITS cells across the scene, the rest of the int32 range is
+    // headroom for bodies flying outwards before a new keyframe has to pick a coarser grid
+    inline constexpr uint32_t QUANT_BITS = 23;
+    inline constexpr uint32_t FLAG_STAR = 1 << 0;
+
+    struct FileHeader {
+        char magic[8]{};
+        uint32_t version{};
+        uint32_t header_size{};
+        // record every interval simulation steps, a keyframe every keyframe_interval records
+        uint32_t interval{};
+        uint32_t keyframe_interval{};
+    };
+    enum ChunkKind : uint32_t {
+        Keyframe = 1,
+        Delta = 2,
+        Index = 3,
+    };
+    // Keyframe payload, columns like in scene files:
+    //   pos n * 3 int32, mass n * float, radius n * float, color n * 3 float, flags n * uint32
+    // Delta payload: 3 zigzag varints per body, same bodies in the same order as the chunk before
+    // Index payload: IndexEntry per recorded chunk
+    struct ChunkHeader {
+        uint32_t kind{};
+        uint32_t bodies{};
+        uint64_t step{};
+        double time{};
+        double scale{};
+        uint64_t payload_size{};
+    };
+    struct IndexEntry {
+        uint64_t step{};
+        double time{};
+        // file offsets of the chunk's header and of the keyframe it builds on (itself for keyframes)
+        uint64_t offset{}, keyframe_offset{};
+    };
+    struct Trailer {
+        uint64_t index_offset{};
+        char magic[8]{};
+    };
+
+    // What the simulation hands over every recorded step. The recorder owns a few of these and
+    // passes them back and forth, so a steady recording doesn't allocate.
+    struct Frame {
+        uint64_t step{};
+        double time{};
+        // changes whenever bodies were added, removed or reordered, deltas need the same bodies as before
+        uint64_t layout{};
+        std::vector<glm::vec3> pos{};
+        std::vector<float> mass{}, radius{};
+        std::vector<glm::vec3> color{};
+        std::vector<uint32_t> flags{};
+
+        void resize(size_t n);
+    };
+
+    // Single producer, single consumer ring, the producer and the consumer each own one index.
+    template<typename T, uint32_t N>
+    class SpscQueue {
+        static_assert((N & (N - 1)) == 0, "N has to be a power of two");
+        std::array<T, N> m_items{};
+        alignas(64) std::atomic<uint32_t> m_head{};
+        alignas(64) std::atomic<uint32_t> m_tail{};
+    public:
+        bool push(T item){
+            auto tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_head.load(std::memory_order_acquire) == N)
+                return false;
+            m_items[tail % N] = item;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+        bool pop(T& item){
+            auto head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire))
+                return false;
+            item = m_items[head % N];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+    };
+
+    // Appends frames to a recording on a writer thread. The simulation thread only copies the state
+    // into a free frame, the encoding and the disk writes happen on the writer. When the writer falls
+    // behind there's no free frame and the step is dropped instead of waiting for the disk.
+    class Recorder {
+    public:
+        inline static constexpr uint32_t QUEUE_DEPTH = 8;
+        inline static constexpr uint32_t DEFAULT_INTERVAL = 10;
+        inline static constexpr uint32_t DEFAULT_KEYFRAME_INTERVAL = 32;
+    private:
+        std::ofstream m_out{};
+        uint32_t m_interval{}, m_keyframe_interval{};
+        std::array<Frame, QUEUE_DEPTH> m_frames{};
+        SpscQueue<Frame*, QUEUE_DEPTH> m_free{}, m_pending{};
+        std::atomic<bool> m_stop{};
+        std::thread m_writer{};
+        std::atomic<uint64_t> m_recorded{}, m_dropped{}, m_bytes{};
+
+        // writer thread only
+        std::vector<IndexEntry> m_index{};
+        std::vector<glm::ivec3> m_last_quantized{};
+        std::vector<uint8_t> m_payload{};
+        uint64_t m_last_layout{};
+        uint64_t m_keyframe_offset{};
+        uint32_t m_since_keyframe{};
+        double m_scale{};
+
+        void write_loop();
+        void write_frame(const Frame& frame);
+        void write_chunk(const ChunkHeader& header);
+    public:
+        // throws if the file can't be created, interval and keyframe_interval are at least 1
+        Recorder(const std::filesystem::path& path, uint32_t interval = DEFAULT_INTERVAL, uint32_t keyframe_interval = DEFAULT_KEYFRAME_INTERVAL);
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+        // writes what is still queued, then the index
+        ~Recorder();
+
+        bool wants(uint64_t step) const;
+        // a frame to fill in, nullptr when the writer is behind, then the step has to be skipped.
+        // Batch runs that would rather wait for the disk than lose steps pass wait
+        Frame* begin_frame(bool wait = false);
+        void submit(Frame* frame);
+
+        uint32_t get_interval() const;
+        uint64_t get_recorded() const;
+        uint64_t get_dropped() const;
+        uint64_t get_bytes_written() const;
+    };
+
+    // A recording mapped into memory for playback. Every record is found through the index, seeking
+    // decodes the keyframe the record builds on and at most keyframe_interval deltas after it, playing
+    // forwards only decodes the deltas since the record shown before.
+    class Replay {
+        MappedFile m_file{};
+        const FileHeader* m_header{};
+        std::vector<IndexEntry> m_index{};
+        Frame m_frame{};
+        std::vector<glm::ivec3> m_quantized{};
+        // the record m_frame holds, SIZE_MAX before the first decode
+        size_t m_current{ SIZE_MAX };
+
+        // throws when the chunk isn't inside the file
+        ChunkHeader chunk(uint64_t offset, const uint8_t** payload = nullptr) const;
+        bool read_index();
+        void scan_chunks();
+        void decode_keyframe(uint64_t offset);
+        void decode_delta(uint64_t offset);
+    public:
+        // throws when the file isn't a recording or has no records, one without an index (the game
+        // crashed while recording) is scanned chunk by chunk up to where it was cut off
+        explicit Replay(const std::filesystem::path& path);
+
+        size_t size() const;
+        uint32_t get_interval() const;
+        const IndexEntry& get_entry(size_t i) const;
+        // the last record at or before time, the first one for times before it
+        size_t find(double time) const;
+        // the frame stays valid until the next decode, its layout is the offset of the keyframe it
+        // builds on, so only positions change between frames with the same layout
+        const Frame& decode(size_t i);
+    };
+}
+
+#endif
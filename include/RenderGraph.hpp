@@ -0,0 +1,128 @@
+#ifndef RENDER_GRAPH_HPP
+#define RENDER_GRAPH_HPP
+#include <cstdint>
+#include "GpuTimer.hpp"
+#include <functional>
+#include <glad/glad.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gm {
+
+    // Declarative description of a frame. Passes say which resources they read and write,
+    // the graph then orders them, drops the ones nobody consumes, keeps passes that draw into
+    // the same framebuffer next to each other and owns the transient render targets.
+    // The graph is rebuilt every frame, the GL objects behind it are kept around.
+    class RenderGraph {
+    public:
+        using Resource = uint32_t;
+        // the default framebuffer, always available
+        inline static constexpr Resource BACKBUFFER = 0;
+
+        // transient textures are always as big as the backbuffer
+        struct TextureDesc {
+            GLenum internal_format{};
+            GLenum format{};
+            GLenum type{};
+            // attached as GL_DEPTH_STENCIL_ATTACHMENT instead of a color attachment
+            bool depth{};
+            inline bool operator==(const TextureDesc& other) const
+            {
+                return internal_format == other.internal_format && format == other.format
+                    && type == other.type && depth == other.depth;
+            }
+        };
+        struct Pass {
+            std::string name{};
+            std::vector<Resource> reads{};
+            // either transient textures (they become the framebuffer attachments, colors in the
+            // order given) or a single imported target / the backbuffer
+            std::vector<Resource> writes{};
+            std::function<void(const RenderGraph&)> execute{};
+        };
+        struct Stats {
+            uint32_t passes{};
+            uint32_t culled_passes{};
+            uint32_t framebuffer_switches{};
+            uint32_t transient_textures{};
+            uint32_t framebuffers{};
+        };
+    private:
+        struct ResourceNode {
+            std::string name{};
+            bool transient{};
+            TextureDesc desc{};
+            // imported targets
+            uint32_t fbo{};
+            int32_t width{}, height{};
+            // index into m_pool of the texture backing a transient for this frame
+            int32_t pool_slot{ -1 };
+        };
+        struct PooledTexture {
+            TextureDesc desc{};
+            uint32_t texture{};
+            // position in the schedule after which the texture is free again this frame
+            int32_t busy_until{ -1 };
+        };
+        std::vector<ResourceNode> m_resources{};
+        std::vector<Pass> m_passes{};
+        // indices into m_passes in execution order, culled passes are not in here
+        std::vector<uint32_t> m_schedule{};
+        std::vector<uint32_t> m_targets{};
+        std::vector<PooledTexture> m_pool{};
+        std::map<std::vector<uint32_t>, uint32_t> m_framebuffers{};
+        // kept across frames by pass name, the name doubles as the timer name in the trace
+        std::map<std::string, GpuTimer> m_pass_timers{};
+        // draws issued by every scheduled pass last execute, same order as m_schedule
+        std::vector<uint32_t> m_pass_draw_calls{};
+        // CPU time spent recording every scheduled pass, same order as m_schedule
+        std::vector<float> m_pass_cpu_ms{};
+        // what BACKBUFFER stands for, an offscreen target when there is no window
+        uint32_t m_backbuffer{};
+        int32_t m_width{}, m_height{};
+        uint32_t m_empty_vao{};
+        Stats m_stats{};
+
+        void release();
+        uint32_t framebuffer_for(const std::vector<uint32_t>& textures, const std::vector<bool>& depth);
+        // pool slot for every scheduled transient, a slot is reused once its last user ran
+        void assign_transients();
+        // GL textures for the pool slots assign_transients added
+        void create_transients();
+    public:
+        RenderGraph();
+        RenderGraph(const RenderGraph&) = delete;
+        RenderGraph& operator=(const RenderGraph&) = delete;
+        RenderGraph(RenderGraph&&);
+        RenderGraph& operator=(RenderGraph&&);
+        ~RenderGraph();
+
+        // framebuffer that BACKBUFFER resolves to from the next begin_frame on, 0 is the window
+        void set_backbuffer(uint32_t fbo);
+        // drops last frame's passes, a different size throws away the pooled targets
+        void begin_frame(int32_t width, int32_t height);
+        Resource create_texture(const std::string& name, const TextureDesc& desc);
+        // a framebuffer owned by someone else, e.g. the shadow map array
+        Resource import_target(const std::string& name, uint32_t fbo, int32_t width, int32_t height);
+        void add_pass(Pass pass);
+        // culls, schedules and allocates, has to be called before execute
+        void compile();
+        // the part of compile that doesn't touch GL: culls, schedules and assigns the transients to pool slots
+        void plan();
+        void execute();
+
+        // GL texture behind a transient, only valid while the graph executes
+        uint32_t get_texture(Resource resource) const;
+        // draws a triangle covering the whole viewport, for the vertex shaders that build it from gl_VertexID
+        void draw_fullscreen_triangle() const;
+        const std::vector<uint32_t>& get_schedule() const;
+        const Pass& get_pass(uint32_t index) const;
+        const Stats& get_stats() const;
+        const std::map<std::string, GpuTimer>& get_pass_timers() const;
+        const std::vector<uint32_t>& get_pass_draw_calls() const;
+        const std::vector<float>& get_pass_cpu_ms() const;
+    };
+}
+
+#endif
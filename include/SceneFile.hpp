@@ -0,0 +1,109 @@
+#ifndef SCENE_FILE_HPP
+#define SCENE_FILE_HPP
+#include "Gravity.hpp"
+#include "MappedFile.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary scene files: saved from the game, written by the headless simulation as snapshots.
+// A fixed header, then one tightly packed column per field and a string table, all little endian.
+// The header has the offset of every column, each one starts COLUMN_ALIGNMENT aligned, so a mapped
+// file can be read in place without parsing anything:
+//   pos      n * 3 float
+//   vel      n * 3 float
+//   mass     n * float
+//   radius   n * float
+//   color    n * 3 float
+//   flags    n * uint32   FLAG_STAR
+//   name     n * uint32   offset into the string table, NO_STRING for none
+//   texture  n * uint32   same, the path the texture was loaded from
+//   strings  null terminated UTF-8
+namespace gm::scene {
+    inline constexpr char FILE_MAGIC[8] = { 'I', 'S', 'L', 'S', 'C', 'E', 'N', 'E' };
+    inline constexpr uint32_t FILE_VERSION = 3;
+    inline constexpr uint32_t OLDEST_FILE_VERSION = 2;
+    inline constexpr uint32_t FLAG_STAR = 1 << 0;
+    // header flags: written by a CheckpointWriter, which only ever rotates out files carrying this
+    inline constexpr uint64_t SCENE_FLAG_CHECKPOINT = 1 << 0;
+    inline constexpr uint32_t NO_STRING = UINT32_MAX;
+    inline constexpr size_t COLUMN_ALIGNMENT = 64;
+
+    enum Column : uint32_t {
+        Pos,
+        Vel,
+        Mass,
+        Radius,
+        Color,
+        Flags,
+        Name,
+        Texture,
+        COLUMN_COUNT,
+    };
+    struct FileHeader {
+        char magic[8]{};
+        uint32_t version{};
+        uint32_t header_size{};
+        uint64_t bodies{};
+        // where the simulation was when the scene was written, 0 for a fresh scene
+        uint64_t step{};
+        double time{};
+        // byte offsets from the start of the file
+        uint64_t columns[COLUMN_COUNT]{};
+        uint64_t strings{}, strings_size{};
+        // SCENE_FLAG_*, new in version 3, a version 2 header ends before it and still loads
+        uint64_t flags{};
+    };
+
+    struct SceneData {
+        std::vector<gravity::Gravdata> bodies{};
+        // either empty or one per body
+        std::vector<glm::vec3> colors{};
+        std::vector<std::string> names{}, textures{};
+        uint64_t step{};
+        double time{};
+    };
+
+    // A scene file mapped into memory. Opening only checks the header and that the columns are
+    // inside the file, the columns point straight into the mapping and stay valid as long as this does.
+    class MappedScene {
+        MappedFile m_file{};
+        const FileHeader* m_header{};
+
+        template<typename T>
+        const T* column(Column c) const;
+        std::string_view string(Column c, size_t i) const;
+    public:
+        explicit MappedScene(const std::filesystem::path& path);
+
+        size_t size() const;
+        uint64_t get_step() const;
+        // SCENE_FLAG_*, 0 for version 2 files
+        uint64_t get_flags() const;
+        double get_time() const;
+        const glm::vec3* positions() const;
+        const glm::vec3* velocities() const;
+        const float* masses() const;
+        const float* radii() const;
+        const glm::vec3* colors() const;
+        const uint32_t* flags() const;
+        // empty when the body has none
+        std::string_view name(size_t i) const;
+        std::string_view texture(size_t i) const;
+    };
+
+    // run.bin -> run_000100.bin, sorts by step in a directory listing
+    std::filesystem::path step_path(const std::filesystem::path& path, uint64_t step);
+    // writes to a temporary file next to PATH first, so a crash never leaves half a scene behind.
+    // With sync the scene is on the disk when this returns, so it also survives losing power
+    void save(const std::filesystem::path& path, const SceneData& scene, bool sync = false, uint64_t flags = 0);
+    // throws when the file is not a scene, has another version or is cut short
+    SceneData load(const std::filesystem::path& path);
+    // drops the bodies the game kernel left without mass, along with their colors and names
+    void remove_eaten(SceneData& scene);
+}
+
+#endif
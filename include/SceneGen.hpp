@@ -0,0 +1,31 @@
+#ifndef SCENE_GEN_HPP
+#define SCENE_GEN_HPP
+#include "Gravity.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reproducible test scenes, velocities are set up for SIM_GRAV_CONST.
+// Every generator returns exactly n bodies and the same bodies for the same seed.
+namespace gm::scene {
+    // uniform sphere at rest, collapses on itself
+    std::vector<gravity::Gravdata> random_cloud(size_t n, uint32_t seed);
+    // Plummer model in virial equilibrium, sampled after Aarseth, Henon & Wielen (1974)
+    std::vector<gravity::Gravdata> plummer_sphere(size_t n, uint32_t seed);
+    // one heavy star with light planets on circular orbits around it
+    std::vector<gravity::Gravdata> disk_with_star(size_t n, uint32_t seed);
+    // binaries orbiting binaries, every level up to ten times wider than the one below
+    std::vector<gravity::Gravdata> hierarchical_binaries(size_t n, uint32_t seed);
+    // a central star in a thin disk whose surface density falls off exponentially with the radius
+    std::vector<gravity::Gravdata> exponential_disk(size_t n, uint32_t seed);
+    // a heavy planet in a narrow, flat ring of light particles, with a distant star to light it
+    std::vector<gravity::Gravdata> planetary_ring(size_t n, uint32_t seed);
+    // two exponential disks with a star in the middle of each, falling into each other
+    std::vector<gravity::Gravdata> colliding_galaxies(size_t n, uint32_t seed);
+
+    inline constexpr const char* SCENE_NAMES[] = { "cloud", "plummer", "disk", "binaries", "exp_disk", "ring", "galaxies" };
+    // by name from SCENE_NAMES, throws for anything else
+    std::vector<gravity::Gravdata> generate(const std::string& name, size_t n, uint32_t seed);
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+#include "Checkpoint.hpp"
+#include "Gravity.hpp"
+#include "Recording.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs only the gravity, without GLFW, GL or ImGui, so it works on servers without a display:
+//   islands --headless --scene in.bin --steps N --dt X --out out.bin
+// The result is a scene file (see SceneFile.hpp), with --snapshot-every N also one every N steps.
+// --checkpoint keeps a few scene files to resume from, written in the background, see Checkpoint.hpp.
+namespace gm::sim {
+    struct Options {
+        // scene file, or the name of a generated scene from scene::SCENE_NAMES
+        std::string scene{};
+        // only for generated scenes
+        size_t bodies{ 1000 };
+        uint32_t seed{ 1 };
+        uint64_t steps{ 1000 };
+        double delta_t{ 1.0 / 60.0 };
+        // pairwise is the game's kernel, so the result looks the same in the viewer, leapfrog is the accurate one
+        std::string solver{ "pairwise" };
+        // pairwise only, like the game option
+        bool collisions{ true };
+        uint32_t threads{ std::max(1u, std::thread::hardware_concurrency()) };
+        float softening{ 0.5f };
+        std::filesystem::path output{};
+        // 0 writes only the final scene
+        uint64_t snapshot_every{};
+        // recording of the whole run, see Recording.hpp, empty for none
+        std::filesystem::path record{};
+        uint32_t record_every{ record::Recorder::DEFAULT_INTERVAL };
+        // checkpoints to resume from, written in the background unlike the snapshots, empty for none
+        std::filesystem::path checkpoint{};
+        uint64_t checkpoint_every{ 1000 };
+        uint32_t checkpoint_keep{ scene::CheckpointWriter::DEFAULT_KEEP };
+        bool checkpoint_fork{};
+    };
+
+    // runs the whole thing, progress goes to stderr
+    void run(const Options& options);
+}
+
+#endif
@@ -7,7 +7,7 @@ namespace gm{
     namespace singl {
         namespace shader_instances {
             enum class ShaderInstance : int {
-                Text3D = 0,
+                TextBatch = 0,
                 Star,
                 ShadowMap,
                 Selected,
@@ -16,16 +16,19 @@ namespace gm{
                 PlanetForward,
                 Trail,
                 Marker,
-                Text,
                 Grid,
                 Skybox,
+                // followed by the other shadow quality permutations, use light_pass_instance()
                 LightPass,
-                LightPassSphere,
+                __light_pass_end = LightPass + static_cast<int>(ShadowQuality::__end) - 1,
+                ImpostorDeferred,
+                ImpostorForward,
                 __end
             };
             void load_all();
             void unload_all();
             Shader* get_instance(ShaderInstance ins);
+            Shader* light_pass_instance(ShadowQuality quality);
 
         }
         namespace font_instances {
@@ -38,6 +41,8 @@ namespace gm{
                 SelectedMarker,
                 UnitSphere,
                 MoveVector,
+                Impostors,
+                TrailPool,
                 __end
             };
             inline VertexArrrayObject* BUFFERS[static_cast<int>(BufferInstance::__end)] = { };
@@ -20,8 +20,10 @@ public:
     Shader(Shader&& other);
     Shader& operator=(Shader&& other);
     ~Shader();
-    Shader(const std::string& vert_path, const std::string& frag_path, const std::string* geom = nullptr);
-    Shader(const char* vert, const char* frag, const char* geom = nullptr);
+    // defines (e.g. "#define FOO 1\n") get inserted right after the #version line of every stage,
+    // that's how shader permutations are compiled from a single source
+    Shader(const std::string& vert_path, const std::string& frag_path, const std::string* geom = nullptr, const std::string& defines = "");
+    Shader(const char* vert, const char* frag, const char* geom = nullptr, const std::string& defines = "");
     static Shader from_shader_dir(const std::string& name);
     void use_shader() const;
     void set_vec2(const char* uniform_name, const glm::vec2& v);
@@ -30,6 +32,7 @@ public:
     void set_mat4(const char* uniform_name, glm::mat4 m);
     void set_mat3(const char* uniform_name, glm::mat3 m);
     void set_int(const char* uniform_name, int i);
+    void set_uint(const char* uniform_name, uint32_t u);
     void set_float(const char* uniform_name, float f);
     uint32_t get_uniform_block_index(const char* block_name);
     void set_uniform_block_binding(const char* block_name, uint32_t binding);
@@ -0,0 +1,113 @@
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+
+parser = argparse.ArgumentParser(
+    description="Runs islands_bench and compares it against a stored baseline, "
+    "fails when a run got slower than the tolerance allows")
+
+parser.add_argument("--baseline", action="store", type=str, required=True)
+parser.add_argument("--tolerance", action="store", type=float, default=0.25,
+                    help="allowed slowdown, 0.25 = 25%% more ns per body step")
+parser.add_argument("--update", action="store_true",
+                    help="store this run as the new baseline instead of comparing")
+parser.add_argument("--skip-code", action="store", type=int, default=77,
+                    help="exit code when there is no baseline to compare against yet or it comes from another build "
+                    "or machine, ctest's SKIP_RETURN_CODE")
+parser.add_argument("command", nargs=argparse.REMAINDER,
+                    help="-- islands_bench and its options, without --output")
+
+args = parser.parse_args()
+
+command = args.command[1:] if args.command[:1] == ["--"] else args.command
+if not command:
+    parser.error("missing the benchmark command")
+
+
+# timings from different builds or machines can't be compared, a Debug build is several times slower
+# than a Release one, so a regression would hide in the difference
+SETUP = ("build_type", "compiler", "cpu", "hardware_threads")
+OPTIMIZED = ("Release", "RelWithDebInfo", "MinSizeRel")
+
+
+def key(result):
+    return (result["scene"], result["solver"], result["bodies"], result["threads"])
+
+
+def setup(report):
+    return ", ".join(f"{field} {report.get(field, 'unknown')}" for field in SETUP)
+
+
+def run():
+    fd, path = tempfile.mkstemp(suffix=".json")
+    os.close(fd)
+    try:
+        subprocess.run(command + ["--output", path], check=True)
+        with open(path) as f:
+            return json.load(f)
+    finally:
+        os.remove(path)
+
+
+current = run()
+
+if current.get("build_type") not in OPTIMIZED:
+    print(f"islands_bench is a {current.get('build_type', 'unknown')} build, "
+          f"perf baselines are only stored and compared for {', '.join(OPTIMIZED)}")
+    sys.exit(1 if args.update else args.skip_code)
+
+def store():
+    os.makedirs(os.path.dirname(os.path.abspath(args.baseline)), exist_ok=True)
+    with open(args.baseline, "w") as f:
+        json.dump(current, f, indent=2)
+        f.write("\n")
+
+
+if args.update:
+    store()
+    print(f"updated {args.baseline}")
+    sys.exit(0)
+
+# the repository ships no numbers, they only mean something on the machine that runs the gates,
+# so the first run there becomes the baseline and the following ones are compared against it
+if not os.path.exists(args.baseline):
+    store()
+    print(f"skipped, no baseline yet, stored this run as {args.baseline} ({setup(current)})")
+    sys.exit(args.skip_code)
+
+with open(args.baseline) as f:
+    stored = json.load(f)
+
+mismatched = [field for field in SETUP if stored.get(field) != current.get(field)]
+if mismatched:
+    print(f"skipped, the baseline comes from another setup ({', '.join(mismatched)} differ)")
+    print(f"  baseline: {setup(stored)}")
+    print(f"  this run: {setup(current)}")
+    print("refresh it with the update_perf_baselines target to gate this setup")
+    sys.exit(args.skip_code)
+
+baseline = {key(r): r for r in stored["results"] if not r.get("skipped")}
+
+failed = False
+for result in current["results"]:
+    if result.get("skipped"):
+        continue
+    name = "{} {} N={} threads={}".format(*key(result))
+    base = baseline.get(key(result))
+    if base is None:
+        print(f"{name}: not in the baseline")
+        failed = True
+        continue
+    now_ns = result["ns_per_body_step"]
+    base_ns = base["ns_per_body_step"]
+    delta = now_ns / base_ns - 1.0
+    regressed = delta > args.tolerance
+    failed |= regressed
+    print(f"{name}: {now_ns:.1f} ns/body-step, baseline {base_ns:.1f}, {delta:+.1%}"
+          + (f"  REGRESSION (tolerance {args.tolerance:.0%})" if regressed else ""))
+
+sys.exit(1 if failed else 0)
@@ -0,0 +1,262 @@
+#include "AllocTracker.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#if __has_include(<execinfo.h>) && __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#include <execinfo.h>
+#define ALLOC_TRACKER_BACKTRACE
+#endif
+// return address of the operator new that is running, i.e. the call site that allocates
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ALLOC_TRACKER_CALLER _ReturnAddress()
+#else
+#define ALLOC_TRACKER_CALLER __builtin_return_address(0)
+#endif
+
+namespace gm::alloc {
+    namespace {
+        // plain data, so it is safe to touch from operator new before and after the thread's constructors
+        struct ThreadCounters {
+            uint64_t allocations, bytes, frees;
+        };
+        thread_local ThreadCounters THREAD{};
+        // set while the tracker itself allocates, so that doesn't get recorded
+        thread_local bool IN_TRACKER{};
+        std::atomic<uint64_t> TOTAL_ALLOCATIONS{}, TOTAL_BYTES{}, TOTAL_FREES{};
+        // only touched by the main thread
+        Counters FRAME_START{}, LAST_FRAME{};
+
+        std::atomic<bool> CAPTURE{};
+        struct CallSiteSlot {
+            void* frames[CALL_SITE_DEPTH];
+            uint32_t depth;
+            uint64_t hash;
+            uint64_t allocations, bytes;
+        };
+        // fixed size open addressing, recording must not allocate
+        std::mutex CALL_SITES_MUTEX{};
+        CallSiteSlot CALL_SITES[CALL_SITE_CAPACITY]{};
+        uint64_t UNTRACKED{};
+        constexpr uint32_t MAX_PROBES = 64;
+
+#ifdef ALLOC_TRACKER_BACKTRACE
+#ifdef ISLANDS_ALLOC_TRACKING
+        // room for the tracker's own frames on top of the call site, however many the compiler left
+        constexpr int TRACKER_FRAMES = 8;
+
+        void record_call_site(size_t size, void* caller){
+            void* frames[CALL_SITE_DEPTH + TRACKER_FRAMES];
+            int captured = ::backtrace(frames, CALL_SITE_DEPTH + TRACKER_FRAMES);
+            // the stack starts at the frame operator new returns to, inlining and tail calls
+            // change how many tracker frames are above it
+            int first = 0;
+            while (first < captured && frames[first] != caller)
+                first++;
+            uint32_t depth = (uint32_t)std::min(captured - first, (int)CALL_SITE_DEPTH);
+            // an unwinder that doesn't see the caller's frame still gets the call site itself
+            void** stack = frames + first;
+            if (depth == 0) {
+                stack = &caller;
+                depth = 1;
+            }
+            // FNV-1a over the return addresses
+            uint64_t hash = 14695981039346656037ull;
+            for (uint32_t i = 0; i < depth; i++)
+                hash = (hash ^ (uint64_t)(uintptr_t)stack[i]) * 1099511628211ull;
+
+            std::lock_guard lock(CALL_SITES_MUTEX);
+            for (uint32_t probe = 0; probe < MAX_PROBES; probe++) {
+                auto& slot = CALL_SITES[(hash + probe) % CALL_SITE_CAPACITY];
+                if (slot.allocations == 0) {
+                    slot.hash = hash;
+                    slot.depth = depth;
+                    std::copy(stack, stack + depth, slot.frames);
+                } else if (slot.hash != hash || slot.depth != depth || !std::equal(slot.frames, slot.frames + depth, stack)) {
+                    continue;
+                }
+                slot.allocations++;
+                slot.bytes += size;
+                return;
+            }
+            UNTRACKED++;
+        }
+#endif
+        std::string symbolize(void* frame){
+            std::string out{};
+            char** symbols = ::backtrace_symbols(&frame, 1);
+            if (!symbols)
+                return out;
+            out = symbols[0];
+            std::free(symbols);
+            // binary(mangled+offset) [address], the mangled name only shows up for exported symbols (-rdynamic)
+            auto open = out.find('('), plus = out.find('+', open), close = out.find(')', plus);
+            if (open == std::string::npos || plus == std::string::npos || close == std::string::npos || plus == open + 1)
+                return out;
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(out.substr(open + 1, plus - open - 1).c_str(), nullptr, nullptr, &status);
+            if (status == 0 && demangled)
+                out = demangled + out.substr(plus, close - plus);
+            std::free(demangled);
+            return out;
+        }
+#endif
+    }
+
+#ifdef ISLANDS_ALLOC_TRACKING
+    namespace {
+        void on_allocate(size_t size, void* caller){
+            THREAD.allocations++;
+            THREAD.bytes += size;
+            TOTAL_ALLOCATIONS.fetch_add(1, std::memory_order_relaxed);
+            TOTAL_BYTES.fetch_add(size, std::memory_order_relaxed);
+#ifdef ALLOC_TRACKER_BACKTRACE
+            if (CAPTURE.load(std::memory_order_relaxed) && !IN_TRACKER) {
+                IN_TRACKER = true;
+                record_call_site(size, caller);
+                IN_TRACKER = false;
+            }
+#else
+            (void)caller;
+#endif
+        }
+        void on_free(){
+            THREAD.frees++;
+            TOTAL_FREES.fetch_add(1, std::memory_order_relaxed);
+        }
+        void* allocate(size_t size, void* caller){
+            on_allocate(size, caller);
+            if (size == 0)
+                size = 1;
+            while (true) {
+                if (void* ptr = std::malloc(size))
+                    return ptr;
+                auto handler = std::get_new_handler();
+                if (!handler)
+                    throw std::bad_alloc();
+                handler();
+            }
+        }
+        void* allocate_nothrow(size_t size, void* caller) noexcept {
+            try {
+                return allocate(size, caller);
+            } catch (...) {
+                return nullptr;
+            }
+        }
+        void deallocate(void* ptr) noexcept {
+            if (!ptr)
+                return;
+            on_free();
+            std::free(ptr);
+        }
+    }
+    bool is_enabled(){
+        return true;
+    }
+#else
+    bool is_enabled(){
+        return false;
+    }
+#endif
+
+    Counters get_thread_counters(){
+        return { THREAD.allocations, THREAD.bytes, THREAD.frees };
+    }
+    void end_frame(){
+        Counters now {
+            TOTAL_ALLOCATIONS.load(std::memory_order_relaxed),
+            TOTAL_BYTES.load(std::memory_order_relaxed),
+            TOTAL_FREES.load(std::memory_order_relaxed),
+        };
+        LAST_FRAME = {
+            now.allocations - FRAME_START.allocations,
+            now.bytes - FRAME_START.bytes,
+            now.frees - FRAME_START.frees,
+        };
+        FRAME_START = now;
+    }
+    Counters get_last_frame(){
+        return LAST_FRAME;
+    }
+
+    void set_capture_call_sites(bool capture){
+        CAPTURE.store(capture, std::memory_order_relaxed);
+    }
+    bool is_capturing_call_sites(){
+        return CAPTURE.load(std::memory_order_relaxed);
+    }
+    void reset_call_sites(){
+        std::lock_guard lock(CALL_SITES_MUTEX);
+        std::fill(std::begin(CALL_SITES), std::end(CALL_SITES), CallSiteSlot{});
+        UNTRACKED = 0;
+    }
+    std::vector<CallSite> get_top_call_sites(size_t n){
+        std::vector<CallSite> out{};
+#ifdef ALLOC_TRACKER_BACKTRACE
+        // the report allocates too, the copy would even try to record itself under the lock
+        IN_TRACKER = true;
+        std::vector<CallSiteSlot> slots{};
+        {
+            std::lock_guard lock(CALL_SITES_MUTEX);
+            for (auto& slot : CALL_SITES)
+                if (slot.allocations)
+                    slots.push_back(slot);
+        }
+        n = std::min(n, slots.size());
+        std::partial_sort(slots.begin(), slots.begin() + n, slots.end(), [](const CallSiteSlot& a, const CallSiteSlot& b) {
+            return a.allocations > b.allocations;
+        });
+        for (size_t i = 0; i < n; i++) {
+            auto& site = out.emplace_back(CallSite { .allocations = slots[i].allocations, .bytes = slots[i].bytes });
+            for (uint32_t f = 0; f < slots[i].depth; f++)
+                site.frames.push_back(symbolize(slots[i].frames[f]));
+        }
+        IN_TRACKER = false;
+#else
+        (void)n;
+#endif
+        return out;
+    }
+    uint64_t get_untracked_allocations(){
+        std::lock_guard lock(CALL_SITES_MUTEX);
+        return UNTRACKED;
+    }
+}
+
+#ifdef ISLANDS_ALLOC_TRACKING
+// the aligned overloads are left alone, the default ones never come through these
+void* operator new(std::size_t size){
+    return gm::alloc::allocate(size, ALLOC_TRACKER_CALLER);
+}
+void* operator new[](std::size_t size){
+    return gm::alloc::allocate(size, ALLOC_TRACKER_CALLER);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return gm::alloc::allocate_nothrow(size, ALLOC_TRACKER_CALLER);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return gm::alloc::allocate_nothrow(size, ALLOC_TRACKER_CALLER);
+}
+void operator delete(void* ptr) noexcept {
+    gm::alloc::deallocate(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    gm::alloc::deallocate(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept {
+    gm::alloc::deallocate(ptr);
+}
+void operator delete[](void* ptr, std::size_t) noexcept {
+    gm::alloc::deallocate(ptr);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    gm::alloc::deallocate(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    gm::alloc::deallocate(ptr);
+}
+#endif
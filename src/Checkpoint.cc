@@ -0,0 +1,203 @@
+#include "Checkpoint.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace gm::scene {
+    namespace {
+        // the checkpoints an earlier run left next to base, oldest step first. Snapshots and anything
+        // else can be named the same way, so only files with the checkpoint flag for the step in their
+        // name count, everything else is never deleted
+        std::deque<std::filesystem::path> find_checkpoints(const std::filesystem::path& base){
+            auto prefix = base.stem().string() + "_";
+            auto extension = base.extension().string();
+            std::vector<std::pair<uint64_t, std::filesystem::path>> found{};
+            std::error_code ec{};
+            auto dir = base.has_parent_path() ? base.parent_path() : std::filesystem::path(".");
+            for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+                auto name = it->path().filename().string();
+                if (name.size() <= prefix.size() + extension.size() || name.rfind(prefix, 0) != 0
+                    || name.compare(name.size() - extension.size(), extension.size(), extension) != 0)
+                    continue;
+                auto digits = name.substr(prefix.size(), name.size() - prefix.size() - extension.size());
+                if (digits.size() > 19 || !std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }))
+                    continue;
+                // spelled like step_path spells it, so a rewrite of the same step is recognized
+                auto path = base;
+                path.replace_filename(name);
+                auto step = std::stoull(digits);
+                try {
+                    MappedScene scene(path);
+                    if (!(scene.get_flags() & SCENE_FLAG_CHECKPOINT) || scene.get_step() != step)
+                        continue;
+                } catch (const std::runtime_error&) {
+                    continue;
+                }
+                found.emplace_back(step, std::move(path));
+            }
+            std::sort(found.begin(), found.end());
+            std::deque<std::filesystem::path> paths{};
+            for (auto& [step, path] : found)
+                paths.push_back(std::move(path));
+            return paths;
+        }
+    }
+
+    CheckpointWriter::CheckpointWriter(const std::filesystem::path& base, uint32_t keep, Mode mode):
+        m_base(base),
+        m_keep(std::max(keep, 1u)),
+        m_mode(mode),
+        // a resumed run rotates out the checkpoints it resumed from as well
+        m_written(find_checkpoints(base))
+    {
+#ifdef _WIN32
+        if (m_mode == Mode::Fork)
+            throw std::runtime_error("Forked checkpoints need fork(), use the writer thread instead");
+#endif
+        if (m_mode == Mode::Thread)
+            m_writer = std::thread(&CheckpointWriter::write_loop, this);
+    }
+    CheckpointWriter::~CheckpointWriter(){
+        if (m_mode == Mode::Fork) {
+            reap(true);
+            return;
+        }
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_writer.join();
+    }
+
+    void CheckpointWriter::write(const SceneData& scene){
+        PROFILE_ZONE("checkpoint");
+        // the copy is all the caller pays for
+        if (m_mode == Mode::Fork)
+            fork_and_write(scene);
+        else
+            submit(SceneData(scene));
+    }
+    void CheckpointWriter::write(SceneData&& scene){
+        PROFILE_ZONE("checkpoint");
+        if (m_mode == Mode::Fork)
+            fork_and_write(scene);
+        else
+            submit(std::move(scene));
+    }
+    void CheckpointWriter::submit(SceneData&& scene){
+        std::optional<SceneData> replaced(std::move(scene));
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_pending)
+                m_skipped++;
+            std::swap(m_pending, replaced);
+        }
+        m_wake.notify_one();
+        // a replaced checkpoint gets freed out here, not while the writer waits for the lock
+    }
+    void CheckpointWriter::fork_and_write(const SceneData& scene){
+#ifndef _WIN32
+        if (!reap(false)) {
+            m_skipped++;
+            return;
+        }
+        auto path = step_path(m_base, scene.step);
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            set_error("fork failed");
+            m_skipped++;
+            return;
+        }
+        if (pid == 0) {
+            // only this thread exists in the child, the scene is a frozen copy of the parent's
+            try {
+                save(path, scene, true, SCENE_FLAG_CHECKPOINT);
+                ::_exit(0);
+            } catch (...) {
+                ::_exit(1);
+            }
+        }
+        m_child = pid;
+        m_child_path = std::move(path);
+#else
+        (void)scene;
+#endif
+    }
+    bool CheckpointWriter::reap(bool block){
+#ifndef _WIN32
+        if (m_child < 0)
+            return true;
+        int status = 0;
+        pid_t done = ::waitpid(m_child, &status, block ? 0 : WNOHANG);
+        if (done == 0)
+            return false;
+        m_child = -1;
+        if (done > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            m_written_count++;
+            retain(m_child_path);
+        } else {
+            set_error("Failed to write " + m_child_path.string());
+        }
+#else
+        (void)block;
+#endif
+        return true;
+    }
+
+    void CheckpointWriter::write_loop(){
+        profiler::set_thread_name("checkpoints");
+        while (true) {
+            std::optional<SceneData> scene{};
+            {
+                std::unique_lock lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_stop || m_pending; });
+                // the last checkpoint still goes out when stopping
+                if (!m_pending)
+                    return;
+                std::swap(scene, m_pending);
+            }
+            auto path = step_path(m_base, scene->step);
+            try {
+                PROFILE_ZONE("write checkpoint");
+                save(path, *scene, true, SCENE_FLAG_CHECKPOINT);
+                m_written_count++;
+                retain(path);
+            } catch (const std::runtime_error& e) {
+                set_error(e.what());
+            }
+        }
+    }
+    void CheckpointWriter::retain(const std::filesystem::path& path){
+        // the same step twice overwrote the file, it counts as the newest now
+        m_written.erase(std::remove(m_written.begin(), m_written.end(), path), m_written.end());
+        m_written.push_back(path);
+        while (m_written.size() > m_keep) {
+            std::error_code ec{};
+            std::filesystem::remove(m_written.front(), ec);
+            m_written.pop_front();
+        }
+    }
+    void CheckpointWriter::set_error(const std::string& error){
+        std::lock_guard lock(m_mutex);
+        m_error = error;
+    }
+
+    uint64_t CheckpointWriter::get_written() const {
+        return m_written_count.load();
+    }
+    uint64_t CheckpointWriter::get_skipped() const {
+        return m_skipped.load();
+    }
+    std::string CheckpointWriter::get_error(){
+        std::lock_guard lock(m_mutex);
+        return m_error;
+    }
+}
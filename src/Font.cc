@@ -1,9 +1,11 @@
 #include "Font.hpp"
+#include "GlState.hpp"
 #include <shaders.hpp>
 #include <cstdio>
 #include <glm/ext/matrix_transform.hpp>
 #include <stb_image/stb_image.h>
 #include "shader/Shader.hpp"
+#include "Singletons.hpp"
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
@@ -11,226 +13,282 @@
 #include <glm/gtx/string_cast.hpp>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#define STB_RECT_PACK_IMPLEMENTATION
+#define STBRP_STATIC
+#include <imstb_rectpack.h>
 
 namespace {
-    /// This is the actual implementation of the load_font function.
-    /// It iterates through all the characters and renders them onto a texture in a separate framebuffer object.
-    /// It then returns a font::FontBitmap object that contains a pointer to that texture and handles access to it.
-    font::FontBitmap gen_font_bitmap(const std::vector<font::Character>& chars, const uint32_t& max_glyph_width, const uint32_t& max_glyph_height, char first, char last){
-        auto glyphs_x = static_cast<uint32_t>(std::sqrt(chars.size()));
-        uint32_t glyphs_y = glyphs_x + 1;
-        uint32_t font_bitmap;
-        uint32_t bitmap_width{}, bitmap_height{};
-
-        bitmap_width = glyphs_x * max_glyph_width;
-        bitmap_height = glyphs_y * max_glyph_height;
-
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glGenTextures(1, &font_bitmap);
-        glBindTexture(GL_TEXTURE_2D, font_bitmap);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_R8,
-            bitmap_width,
-            bitmap_height,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            NULL
-        );
-        // set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        uint32_t fbo;
-        glGenFramebuffers(1, &fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-        glDrawBuffer(GL_COLOR_ATTACHMENT0);
-        glReadBuffer(GL_COLOR_ATTACHMENT0);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, font_bitmap, 0);
-
-        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
-            throw std::runtime_error("Failed to complete the framebuffer");
-        }
-
-        GLint gl_viewport[4];
-        glGetIntegerv(GL_VIEWPORT, gl_viewport);
-        glViewport(0, 0, bitmap_width, bitmap_height);
-
-        glClearColor(0.0, 0.0, 0.0, 0.0);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glDisable(GL_CULL_FACE);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        uint32_t glyph_vbo = 0;
-        uint32_t glyph_vao = 0;
-        uint32_t glyph_ebo = 0;
-
-        glGenBuffers(1, &glyph_vbo);
-        glGenVertexArrays(1, &glyph_vao);
-
-        glBindVertexArray(glyph_vao);
-        glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo);
-        glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(glm::vec2), NULL, GL_DYNAMIC_DRAW);
-
-        //position
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
-            (void*)0);
-        //texture coords
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-
-        glGenBuffers(1, &glyph_ebo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glyph_ebo);
-        uint32_t ebo[] = {
-            0, 1, 3,
-            3, 2, 0
-        };
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(ebo), ebo, GL_STATIC_DRAW);
-
-        glm::vec2 glyph_data[] = {
-            {0, 0}, {0, 1}, // top-left
-            {0, 0}, {0, 0}, // bottom-left
-            {0, 0}, {1, 1}, // top-right
-            {0, 0}, {1, 0}, // bottom-right
+    // bump this whenever the layout of the cache file changes
+    constexpr uint32_t ATLAS_CACHE_VERSION = 1;
+    constexpr char ATLAS_CACHE_MAGIC[4] = { 'I', 'S', 'F', 'A' };
+    // empty texels around every glyph so linear filtering doesn't bleed the neighbours in
+    constexpr uint32_t GLYPH_PADDING = 1;
+    constexpr uint32_t MAX_ATLAS_SIZE = 8192;
+
+    struct FontAtlas {
+        uint32_t width{}, height{};
+        uint32_t glyph_width{}, glyph_height{};
+        char first{}, last{};
+        std::vector<font::FontBitmap::PackedGlyph> glyphs{};
+        // one byte per texel, rows from top to bottom
+        std::vector<unsigned char> pixels{};
+    };
+    struct AtlasCacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t width, height;
+        uint32_t glyph_width, glyph_height;
+        int32_t first, last;
+        uint32_t glyph_count;
+    };
+
+    /// Returns where the cached atlas of the font would live, or an empty path if the font file can't be stat'ed.
+    /// The file size and modification time are part of the key so editing the font invalidates the cache.
+    std::filesystem::path atlas_cache_path(const std::string& file_path, int font_size){
+        std::error_code ec;
+        auto file_size = std::filesystem::file_size(file_path, ec);
+        if (ec)
+            return {};
+        auto mtime = std::filesystem::last_write_time(file_path, ec);
+        if (ec)
+            return {};
+        auto dir = std::filesystem::temp_directory_path(ec);
+        if (ec)
+            return {};
+        std::stringstream key;
+        key << std::filesystem::absolute(file_path, ec).generic_string() << '|' << font_size << '|'
+            << file_size << '|' << mtime.time_since_epoch().count() << '|' << ATLAS_CACHE_VERSION;
+        std::stringstream name;
+        name << std::filesystem::path(file_path).stem().generic_string() << '_' << font_size << '_'
+            << std::hex << std::hash<std::string>{}(key.str()) << ".atlas";
+        return dir / "islands_cache" / name.str();
+    }
+    bool read_atlas_cache(const std::filesystem::path& path, FontAtlas& atlas){
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        AtlasCacheHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return false;
+        if (!std::equal(std::begin(ATLAS_CACHE_MAGIC), std::end(ATLAS_CACHE_MAGIC), header.magic)
+            || header.version != ATLAS_CACHE_VERSION
+            || header.width == 0 || header.width > MAX_ATLAS_SIZE
+            || header.height == 0 || header.height > MAX_ATLAS_SIZE
+            || header.glyph_width == 0 || header.glyph_width > MAX_ATLAS_SIZE
+            || header.glyph_height == 0 || header.glyph_height > MAX_ATLAS_SIZE
+            || header.last < header.first
+            || header.glyph_count != (uint32_t)(header.last - header.first + 1))
+            return false;
+        atlas.width = header.width;
+        atlas.height = header.height;
+        atlas.glyph_width = header.glyph_width;
+        atlas.glyph_height = header.glyph_height;
+        atlas.first = (char)header.first;
+        atlas.last = (char)header.last;
+        atlas.glyphs.resize(header.glyph_count);
+        atlas.pixels.resize((size_t)atlas.width * atlas.height);
+        file.read(reinterpret_cast<char*>(atlas.glyphs.data()), atlas.glyphs.size() * sizeof(font::FontBitmap::PackedGlyph));
+        file.read(reinterpret_cast<char*>(atlas.pixels.data()), atlas.pixels.size());
+        if (!file)
+            return false;
+        // a stale or corrupt cache would put the UVs outside of the atlas, better to pack it again
+        return std::all_of(atlas.glyphs.begin(), atlas.glyphs.end(), [&](const font::FontBitmap::PackedGlyph& g) {
+            return (uint32_t)g.x + g.width <= atlas.width && (uint32_t)g.y + g.height <= atlas.height
+                && g.width <= atlas.glyph_width && g.height <= atlas.glyph_height;
+        });
+    }
+    /// The cache is only an optimization, failing to write it is not an error.
+    void write_atlas_cache(const std::filesystem::path& path, const FontAtlas& atlas){
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        if (ec)
+            return;
+        AtlasCacheHeader header{
+            .magic = {},
+            .version = ATLAS_CACHE_VERSION,
+            .width = atlas.width,
+            .height = atlas.height,
+            .glyph_width = atlas.glyph_width,
+            .glyph_height = atlas.glyph_height,
+            .first = atlas.first,
+            .last = atlas.last,
+            .glyph_count = (uint32_t)atlas.glyphs.size(),
         };
-        auto projection = glm::ortho(0.0f, static_cast<float>(bitmap_width), static_cast<float>(bitmap_height),
-                0.0f);
-
-        glBindVertexArray(glyph_vao);
-        auto glyph_shader = Shader(shaders::FONT_BITMAP_VERT, shaders::FONT_BITMAP_FRAG);
-        glyph_shader.use_shader();
-        glyph_shader.set_mat4("projection", projection);
-
-
-        for(size_t i = 0; i < chars.size(); i++){
-            size_t x = i % glyphs_x;
-            size_t y = static_cast<size_t>(i / glyphs_x);
-
-            auto& glyph = chars[i];
-
-            auto glyph_w_off = (max_glyph_width - glyph.size.x) / 2.;
-            auto glyph_h_off = (max_glyph_height - glyph.size.y) / 2.;
-
-            // glyph_h_off = 0;
-            // glyph_w_off = 0;
-
-
-            //fill in the position data of the glyph in the buffer
-            glyph_data[0] = { x * max_glyph_width + glyph_w_off, y * max_glyph_height };
-            glyph_data[2] = { x * max_glyph_width + glyph_w_off, (y + 1) * max_glyph_height - glyph_h_off * 2 };
-            glyph_data[4] = { ((x + 1) * max_glyph_width) - glyph_w_off, y * max_glyph_height };
-            glyph_data[6] = { ((x + 1) * max_glyph_width) - glyph_w_off, (y + 1) * max_glyph_height - glyph_h_off * 2};
-
-            glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glyph_data), glyph_data);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, glyph.texture_id);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-            glDeleteTextures(1, &glyph.texture_id);
+        std::copy(std::begin(ATLAS_CACHE_MAGIC), std::end(ATLAS_CACHE_MAGIC), header.magic);
+        // write next to the real file and rename, so a crash never leaves a half written cache behind
+        auto tmp_path = path;
+        tmp_path += ".tmp";
+        {
+            std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(atlas.glyphs.data()), atlas.glyphs.size() * sizeof(font::FontBitmap::PackedGlyph));
+            file.write(reinterpret_cast<const char*>(atlas.pixels.data()), atlas.pixels.size());
+            if (!file) {
+                file.close();
+                std::filesystem::remove(tmp_path, ec);
+                return;
+            }
         }
-        // glReadBuffer(GL_COLOR_ATTACHMENT0);
-        // std::vector<unsigned char> pixels(3 * bitmap_width * bitmap_height);
-        // glPixelStorei(GL_PACK_ALIGNMENT, 1);
-        // glReadPixels(0, 0, bitmap_width, bitmap_height, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
-        //
-        // bool any_data = std::any_of(pixels.begin(), pixels.end(), [](unsigned char v){return v != 0;});
-        // if(!any_data) throw std::runtime_error("framebuffer empty");
-
-        // post rendering cleanup
-        glDeleteFramebuffers(1, &fbo);
-        glDeleteVertexArrays(1, &glyph_vao);
-        glDeleteBuffers(1, &glyph_vbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        // set the viewport to the previous value
-        glViewport(0, 0, gl_viewport[2], gl_viewport[3]);
-        glEnable(GL_CULL_FACE);
-        glEnable(GL_BLEND);
-        glPixelStorei(GL_PACK_ALIGNMENT, 4);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-        return font::FontBitmap(font_bitmap, glyphs_x, glyphs_y, max_glyph_width, max_glyph_height, first, last);
+        std::filesystem::rename(tmp_path, path, ec);
+        if (ec)
+            std::filesystem::remove(tmp_path, ec);
     }
-}
-namespace font{
-    /// This function loads a .ttf font file under the file_path and returns a FontBitmap wrapper object.
-    font::FontBitmap load_font(const std::string& file_path, int font_size){
+
+    /// Rasterizes all the glyphs with freetype and packs them tightly into a single CPU side bitmap.
+    FontAtlas rasterize_atlas(const std::string& file_path, int font_size, char first, char last){
         FT_Library ft;
         if(FT_Init_FreeType(&ft)){
             throw std::runtime_error("Failed to initialize freetype");
         }
-
         FT_Face face;
         if(FT_New_Face(ft, file_path.c_str(), 0, &face)){
+            FT_Done_FreeType(ft);
             std::stringstream ss;
             ss << "Failed to load font file: '";
             ss << file_path << '\'';
             throw std::runtime_error(ss.str());
         }
         if(FT_Set_Pixel_Sizes(face, 0, font_size)){
+            FT_Done_Face(face);
+            FT_Done_FreeType(ft);
             throw std::runtime_error("Failed to set pixel size for font");
         }
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        uint32_t max_glyph_width{}, max_glyph_height{};
-        std::vector<Character> characters{};
-        auto start_char = ' ', last_char = 'z';
-        for(int ascii_code = start_char; ascii_code <= (int)last_char; ascii_code++){
+        struct RasterizedGlyph {
+            glm::ivec2 size{};
+            glm::ivec2 bearing{};
+            std::vector<unsigned char> pixels{};
+        };
+        std::vector<RasterizedGlyph> rasterized{};
+        for(int ascii_code = first; ascii_code <= (int)last; ascii_code++){
             if(FT_Load_Char(face, (char)ascii_code, FT_LOAD_RENDER)){
+                FT_Done_Face(face);
+                FT_Done_FreeType(ft);
                 std::stringstream ss;
                 ss << "Failed to load font glyph: '";
                 ss << (char)ascii_code << '\'';
                 ss << "for font: " << '\'' << file_path << '\'';
                 throw std::runtime_error(ss.str());
             }
-            max_glyph_width = std::max(face->glyph->bitmap.width, max_glyph_width);
-            max_glyph_height = std::max(face->glyph->bitmap.rows, max_glyph_height);
-
-            // generate texture
-            uint32_t texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_R8,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-            // set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            font::Character ch{
-                .texture_id = texture,
-                .size = glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
+            auto& bitmap = face->glyph->bitmap;
+            RasterizedGlyph glyph{
+                .size = glm::ivec2(bitmap.width, bitmap.rows),
                 .bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                .advance = (uint32_t)face->glyph->advance.x,
+                .pixels = std::vector<unsigned char>((size_t)bitmap.width * bitmap.rows),
             };
-            characters.emplace_back(std::move(ch));
+            for (uint32_t row = 0; row < bitmap.rows; row++) {
+                std::copy_n(bitmap.buffer + row * bitmap.pitch, bitmap.width, glyph.pixels.data() + row * bitmap.width);
+            }
+            rasterized.emplace_back(std::move(glyph));
         }
-        glBindTexture(GL_TEXTURE_2D, 0);
-        auto const margin = 1.1;
-        // max_glyph_height *= margin;
-        max_glyph_width *= margin;
-        auto bitmap = gen_font_bitmap(characters, max_glyph_width, max_glyph_height, start_char, last_char);
         FT_Done_Face(face);
         FT_Done_FreeType(ft);
 
-        return bitmap;
+        // every character still gets a cell of the same size (the text layout is monospace),
+        // the glyphs sit on a common baseline and are centered horizontally inside of it
+        int32_t max_width{}, ascent{}, descent{};
+        for (auto& g : rasterized) {
+            max_width = std::max(max_width, g.size.x);
+            ascent = std::max(ascent, g.bearing.y);
+            descent = std::max(descent, g.size.y - g.bearing.y);
+        }
+        FontAtlas atlas{
+            .glyph_width = (uint32_t)(max_width * 1.1),
+            .glyph_height = (uint32_t)(ascent + descent),
+            .first = first,
+            .last = last,
+        };
+
+        std::vector<stbrp_rect> rects(rasterized.size());
+        for (size_t i = 0; i < rects.size(); i++) {
+            rects[i] = {};
+            rects[i].id = (int)i;
+            rects[i].w = rasterized[i].size.x + GLYPH_PADDING;
+            rects[i].h = rasterized[i].size.y + GLYPH_PADDING;
+        }
+        // start small and keep doubling the shorter side until everything fits
+        uint32_t width = 64, height = 64;
+        for (;;) {
+            std::vector<stbrp_node> nodes(width);
+            stbrp_context ctx;
+            stbrp_init_target(&ctx, width, height, nodes.data(), nodes.size());
+            if (stbrp_pack_rects(&ctx, rects.data(), rects.size()))
+                break;
+            if (width <= height)
+                width *= 2;
+            else
+                height *= 2;
+            if (width > MAX_ATLAS_SIZE || height > MAX_ATLAS_SIZE)
+                throw std::runtime_error("Font atlas doesn't fit into the maximum texture size for font: '" + file_path + "'");
+        }
+        atlas.width = width;
+        atlas.height = height;
+        atlas.pixels.assign((size_t)width * height, 0);
+        atlas.glyphs.resize(rasterized.size());
+        for (auto& r : rects) {
+            auto& g = rasterized[r.id];
+            for (int32_t row = 0; row < g.size.y; row++) {
+                std::copy_n(g.pixels.data() + row * g.size.x, g.size.x,
+                    atlas.pixels.data() + (size_t)(r.y + row) * width + r.x);
+            }
+            atlas.glyphs[r.id] = font::FontBitmap::PackedGlyph{
+                .x = (uint16_t)r.x,
+                .y = (uint16_t)r.y,
+                .width = (uint16_t)g.size.x,
+                .height = (uint16_t)g.size.y,
+                .offset_x = (int16_t)(((int32_t)atlas.glyph_width - g.size.x) / 2),
+                .offset_y = (int16_t)(ascent - g.bearing.y),
+            };
+        }
+        return atlas;
+    }
+    /// Uploads the whole atlas in one go.
+    font::FontBitmap upload_atlas(FontAtlas&& atlas){
+        uint32_t font_bitmap;
+        gm::gl_state::pixel_store(GL_UNPACK_ALIGNMENT, 1);
+        glGenTextures(1, &font_bitmap);
+        glBindTexture(GL_TEXTURE_2D, font_bitmap);
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            0,
+            GL_R8,
+            atlas.width,
+            atlas.height,
+            0,
+            GL_RED,
+            GL_UNSIGNED_BYTE,
+            atlas.pixels.data()
+        );
+        // set texture options
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        gm::gl_state::pixel_store(GL_UNPACK_ALIGNMENT, 4);
+        return font::FontBitmap(font_bitmap, atlas.width, atlas.height, atlas.glyph_width, atlas.glyph_height,
+            atlas.first, atlas.last, std::move(atlas.glyphs));
+    }
+}
+namespace font{
+    /// This function loads a .ttf font file under the file_path and returns a FontBitmap wrapper object.
+    /// The packed atlas is cached on disk, so only the first start with a given font has to go through freetype.
+    font::FontBitmap load_font(const std::string& file_path, int font_size){
+        auto const first_char = ' ', last_char = 'z';
+        auto cache_path = atlas_cache_path(file_path, font_size);
+        FontAtlas atlas{};
+        if (!cache_path.empty() && read_atlas_cache(cache_path, atlas) && atlas.first == first_char && atlas.last == last_char)
+            return upload_atlas(std::move(atlas));
+
+        atlas = rasterize_atlas(file_path, font_size, first_char, last_char);
+        if (!cache_path.empty())
+            write_atlas_cache(cache_path, atlas);
+        return upload_atlas(std::move(atlas));
     }
 
     FontBitmap::GlyphTextureCoordinates FontBitmap::texture_coords_for(char ch) const{
@@ -242,21 +300,17 @@ namespace font{
         if(idx < 0)
             throw std::runtime_error("tried to access a character that is outside the texture bitmap");
 
-        auto x = idx % glyphs_x;
-        auto y = idx / (glyphs_y - 1);
-        // this is a shitty hack becuase the bitmap is flipped or whatever and im too sick of this bullshit to fix it at the source
-        y = glyphs_y - y - 1;
-
-
-        auto w_prc = (float)glyph_width / (float)total_x;
-        auto h_prc = (float)glyph_height / (float)total_y;
+        auto& g = glyphs[idx];
+        float left = g.x / total_x, right = (g.x + g.width) / total_x;
+        float top = g.y / total_y, bottom = (g.y + g.height) / total_y;
         return GlyphTextureCoordinates {
-            .top_left = { x * w_prc, y * h_prc },
-            .top_right = { (x + 1) * w_prc, y * h_prc },
-            .bottom_left = { x * w_prc, (y + 1) * h_prc },
-            .bottom_right { (x + 1) * w_prc, (y + 1) * h_prc }
+            .top_left = { left, top },
+            .top_right = { right, top },
+            .bottom_left = { left, bottom },
+            .bottom_right = { right, bottom },
+            .offset = { g.offset_x, g.offset_y },
+            .size = { g.width, g.height },
         };
-
     }
     void FontBitmap::bind_bitmap() const {
         glActiveTexture(GL_TEXTURE0);
@@ -305,114 +359,28 @@ namespace font{
     }
     void Text2D::update() {
         if (m_str.length() == 0) return;
-
-        std::vector<GlyphVertex> vertices = {
-            { { 0, 0 }, { 0, 0 } }, // top-left
-            { { 0, 0 }, { 0, 0 } }, // bottom-left
-            { { 0, 0 }, { 0, 0 } }, // bottom-right
-            { { 0, 0 }, { 0, 0 } }, // bottom-right
-            { { 0, 0 }, { 0, 0 } }, // top-right
-            { { 0, 0 }, { 0, 0 } }, // top-left
-        };
         auto gw = m_font_bitmap->get_glyph_width();
         auto gh = m_font_bitmap->get_glyph_height();
-
-        ::glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        ::glBufferData(GL_ARRAY_BUFFER, m_str.length() * vertices.size() * sizeof(GlyphVertex), NULL, GL_STATIC_DRAW);
-
-        size_t i{};
-        for(auto str_iter = m_str.begin(); str_iter != m_str.end(); ++str_iter){
-            char c = *str_iter;
-            auto tex = m_font_bitmap->texture_coords_for(c);
-
-            vertices[0] = {{ i * gw, 0 }, { tex.top_left }};
-            vertices[1] = {{ i * gw, gh }, { tex.bottom_left }};
-            vertices[2] = {{ (i + 1) * gw, gh }, { tex.bottom_right }};
-            vertices[3] = {{ (i + 1) * gw, gh }, { tex.bottom_right }};
-            vertices[4] = {{ (i + 1) * gw, 0 }, { tex.top_right }};
-            vertices[5] = {{ i * gw, 0 }, { tex.top_left }};
-
-            ::glBufferSubData(GL_ARRAY_BUFFER,
-                    i * sizeof(GlyphVertex) * vertices.size(), sizeof(GlyphVertex) * vertices.size(), vertices.data());
-            i++;
-        }
-        m_width = i * gw * m_scale;
+        m_width = m_str.length() * gw * m_scale;
         m_height = gh * m_scale;
-        ::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
     }
-    void Text2D::draw() const {
-        if (m_str.length() == 0) assert (false);
-
-        ::glDisable(GL_DEPTH_TEST);
-        ::glPixelStorei(GL_PACK_ALIGNMENT, 1);
-        ::glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        ::glBindVertexArray(m_vao);
-
-        m_font_bitmap->bind_bitmap();
-        m_text_shader->use_shader();
-
-        m_text_shader->set_mat4("model", m_model);
-        m_text_shader->set_vec3("color", m_color);
-
-        ::glEnable(GL_BLEND);
-        ::glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        ::glDrawArrays(GL_TRIANGLES, 0, 6 * m_str.length());
-
-        m_font_bitmap->unbind_bitmap();
-        ::glBindVertexArray(0);
-        ::glEnable(GL_DEPTH_TEST);
-        ::glPixelStorei(GL_PACK_ALIGNMENT, 4);
-        ::glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    void Text2D::append_glyphs(std::vector<GlyphInstance>& out) const {
+        auto gw = (float)m_font_bitmap->get_glyph_width();
+        for(size_t i = 0; i < m_str.length(); i++){
+            auto tex = m_font_bitmap->texture_coords_for(m_str[i]);
+            // nothing to draw for blanks
+            if (tex.size.x == 0 || tex.size.y == 0)
+                continue;
+            out.push_back({
+                .anchor = glm::vec4(m_pos, m_scale),
+                .rect = glm::vec4(i * gw + tex.offset.x, tex.offset.y, tex.size.x, tex.size.y),
+                .uv = glm::vec4(tex.top_left.x, tex.top_left.y, tex.bottom_right.x, tex.bottom_right.y),
+                .color = glm::vec4(m_color, 0.0f),
+            });
+        }
     }
-    void Text2D::debug_draw() const {
-
-        glDisable(GL_DEPTH_TEST);
-        float data[] = {
-            0.0, 0.0, 0.0, 0.0,
-            0.0, 300.0, 0.0, 1.0,
-            600.0, 300.0, 1.0, 1.0,
-            600.0, 300.0, 1.0, 1.0,
-            600.0, 0.0, 1.0, 0.0,
-            0.0, 0.0, 0.0, 0.0,
-        };
-
-        glPixelStorei(GL_PACK_ALIGNMENT, 1);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-        uint32_t vbo{}, vao{};
-        glGenBuffers(1, &vbo);
-        glGenVertexArrays(1, &vao);
-        glBindVertexArray(vao);
-
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(data), data, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
-            (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        glBindVertexArray(vao);
-        m_font_bitmap->bind_bitmap();
-        m_text_shader->use_shader();
-
-        m_text_shader->set_mat4("model", glm::mat4(1.0f));
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        m_font_bitmap->unbind_bitmap();
-        glDeleteVertexArrays(1, &vao);
-        glDeleteBuffers(1, &vbo);
-        glEnable(GL_DEPTH_TEST);
-        glPixelStorei(GL_PACK_ALIGNMENT, 4);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-
+    FontBitmap* TextBase::get_font_bitmap() const{
+        return m_font_bitmap;
     }
     void TextBase::set_text(std::string&& new_text){
         m_str = new_text;
@@ -449,41 +417,21 @@ namespace font{
         m_width /= m_scale;
         m_height /= m_scale;
     }
-    void Text3D::draw() const{
-        if (m_str.length() == 0) return;
-
-        // ::glDisable(GL_CULL_FACE);
-        ::glPixelStorei(GL_PACK_ALIGNMENT, 1);
-        ::glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        ::glBindVertexArray(m_vao);
-
-        m_font_bitmap->bind_bitmap();
-        m_text_shader->use_shader();
-
-        auto scale = glm::scale(glm::mat4(1.0), glm::vec3(m_scale, -m_scale, 1.0));
-        auto scaling = glm::mat3(scale[0], scale[1], scale[2]);
-
-        // auto model = glm::scale(m_model, glm::vec3(m_scale, m_scale, 1.0));
-
-        m_text_shader->set_mat3("scaling", scaling);
-        m_text_shader->set_mat4("model", m_model);
-        m_text_shader->set_vec3("color", m_color);
-        m_text_shader->set_float("width", m_width);
-
-        // ::glEnable(GL_BLEND);
-        // ::glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        // ::glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        ::glDrawArrays(GL_TRIANGLES, 0, 6 * m_str.length());
-
-        m_font_bitmap->unbind_bitmap();
-        ::glBindVertexArray(0);
-        // ::glEnable(GL_CULL_FACE);
-        ::glPixelStorei(GL_PACK_ALIGNMENT, 4);
-        ::glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-    }
-    void Text3D::debug_draw() const{
-
+    void Text3D::append_glyphs(std::vector<GlyphInstance>& out) const {
+        auto gw = (float)m_font_bitmap->get_glyph_width();
+        for(size_t i = 0; i < m_str.length(); i++){
+            auto tex = m_font_bitmap->texture_coords_for(m_str[i]);
+            // nothing to draw for blanks
+            if (tex.size.x == 0 || tex.size.y == 0)
+                continue;
+            // labels are centered above their anchor
+            out.push_back({
+                .anchor = glm::vec4(m_pos, m_scale),
+                .rect = glm::vec4(i * gw - m_width / 2.0f + tex.offset.x, tex.offset.y, tex.size.x, tex.size.y),
+                .uv = glm::vec4(tex.top_left.x, tex.top_left.y, tex.bottom_right.x, tex.bottom_right.y),
+                .color = glm::vec4(m_color, 1.0f),
+            });
+        }
     }
     void Text3D::set_pos(glm::vec3&& new_pos){
         m_pos = new_pos;
@@ -494,4 +442,65 @@ namespace font{
         // m = glm::scale(m, { m_scale, m_scale, 1.0 });
         m_model = m;
     }
+
+    void TextBatch::add(const TextBase& text){
+        if (text.get_text().empty() || !text.get_font_bitmap())
+            return;
+        // every font has its own bitmap, draw what we have so far before switching
+        if (text.get_font_bitmap() != m_font_bitmap && !m_glyphs.empty())
+            draw();
+        m_font_bitmap = text.get_font_bitmap();
+        text.append_glyphs(m_glyphs);
+    }
+    void TextBatch::draw(){
+        if (m_glyphs.empty())
+            return;
+        if (!m_vao) {
+            ::glGenVertexArrays(1, &m_vao);
+            ::glGenBuffers(1, &m_vbo);
+            ::glBindVertexArray(m_vao);
+            ::glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+            for (uint32_t i = 0; i < 4; i++) {
+                ::glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)(i * sizeof(glm::vec4)));
+                ::glEnableVertexAttribArray(i);
+                ::glVertexAttribDivisor(i, 1);
+            }
+        }
+        ::glBindVertexArray(m_vao);
+        ::glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        if (m_glyphs.size() > m_capacity) {
+            m_capacity = std::max(m_glyphs.size(), m_capacity * 2);
+        }
+        // orphan the old storage so we don't wait for the previous frame to finish reading it
+        ::glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(GlyphInstance), NULL, GL_STREAM_DRAW);
+        ::glBufferSubData(GL_ARRAY_BUFFER, 0, m_glyphs.size() * sizeof(GlyphInstance), m_glyphs.data());
+
+        using namespace gm::singl;
+        auto shader = shader_instances::get_instance(shader_instances::ShaderInstance::TextBatch);
+        shader->use_shader();
+        shader->set_int("font_bitmap", 0);
+        m_font_bitmap->bind_bitmap();
+
+        gm::gl_state::draw_arrays_instanced(GL_TRIANGLES, 0, 6, m_glyphs.size());
+
+        m_font_bitmap->unbind_bitmap();
+        ::glBindBuffer(GL_ARRAY_BUFFER, 0);
+        ::glBindVertexArray(0);
+        m_glyph_count += m_glyphs.size();
+        m_draw_calls++;
+        m_glyphs.clear();
+    }
+    void TextBatch::flush(){
+        draw();
+        m_last_glyph_count = m_glyph_count;
+        m_last_draw_calls = m_draw_calls;
+        m_glyph_count = 0;
+        m_draw_calls = 0;
+    }
+    std::size_t TextBatch::get_last_glyph_count() const{
+        return m_last_glyph_count;
+    }
+    uint32_t TextBatch::get_last_draw_calls() const{
+        return m_last_draw_calls;
+    }
 }
@@ -5,58 +5,29 @@
 using namespace gm::singl;
 
 namespace font {
-FontBitmap::FontBitmap(uint32_t bitmap, uint32_t glyphs_x, uint32_t glyphs_y,
-    uint32_t glyph_width, uint32_t glyph_height, char first, char last)
+FontBitmap::FontBitmap(uint32_t bitmap, uint32_t atlas_width, uint32_t atlas_height,
+    uint32_t glyph_width, uint32_t glyph_height, char first, char last, std::vector<PackedGlyph> glyphs)
     : bitmap_id(bitmap)
-    , glyphs_x(glyphs_x)
-    , glyphs_y(glyphs_y)
     , glyph_width(glyph_width)
     , glyph_height(glyph_height)
+    , total_x(atlas_width)
+    , total_y(atlas_height)
     , first_char(first)
     , last_char(last)
+    , glyphs(std::move(glyphs))
 {
-    total_x = glyphs_x * glyph_width;
-    total_y = glyphs_y * glyph_height;
-}
-FontBitmap::FontBitmap(const FontBitmap& other)
-    : bitmap_id(other.bitmap_id)
-    , glyphs_x(other.glyphs_x)
-    , glyphs_y(other.glyphs_y)
-    , glyph_width(other.glyph_width)
-    , glyph_height(other.glyph_height)
-    , total_x(other.total_x)
-    , total_y(other.total_y)
-    , first_char(other.first_char)
-    , last_char(other.last_char)
-{
-}
-FontBitmap& FontBitmap::operator=(const FontBitmap& other)
-{
-    bitmap_id = other.bitmap_id;
-    glyphs_x = other.glyphs_x;
-    glyphs_y = other.glyphs_y;
-    glyph_width = other.glyph_width;
-    glyph_height = other.glyph_height;
-    total_x = other.total_x;
-    total_y = other.total_y;
-    first_char = other.first_char;
-    last_char = other.last_char;
-    return *this;
 }
 FontBitmap::FontBitmap(FontBitmap&& other)
     : bitmap_id(other.bitmap_id)
-    , glyphs_x(other.glyphs_x)
-    , glyphs_y(other.glyphs_y)
     , glyph_width(other.glyph_width)
     , glyph_height(other.glyph_height)
     , total_x(other.total_x)
     , total_y(other.total_y)
     , first_char(other.first_char)
     , last_char(other.last_char)
+    , glyphs(std::move(other.glyphs))
 {
     other.bitmap_id = 0;
-    other.glyphs_x = 0;
-    other.glyphs_y = 0;
     other.glyph_width = 0;
     other.glyph_height = 0;
     other.total_x = 0;
@@ -64,18 +35,17 @@ FontBitmap::FontBitmap(FontBitmap&& other)
 }
 FontBitmap& FontBitmap::operator=(FontBitmap&& other)
 {
+    if (bitmap_id)
+        glDeleteTextures(1, &bitmap_id);
     bitmap_id = other.bitmap_id;
-    glyphs_x = other.glyphs_x;
-    glyphs_y = other.glyphs_y;
     glyph_width = other.glyph_width;
     glyph_height = other.glyph_height;
     total_x = other.total_x;
     total_y = other.total_y;
     first_char = other.first_char;
     last_char = other.last_char;
+    glyphs = std::move(other.glyphs);
     other.bitmap_id = 0;
-    other.glyphs_x = 0;
-    other.glyphs_y = 0;
     other.glyph_width = 0;
     other.glyph_height = 0;
     other.total_x = 0;
@@ -92,19 +62,16 @@ FontBitmap::~FontBitmap()
 
 TextBase::TextBase()
     : m_str {}
-    , m_text_shader { nullptr }
     , m_font_bitmap { nullptr }
 {
 }
-TextBase::TextBase(FontBitmap* font_bitmap, Shader* text_shader, std::string text)
+TextBase::TextBase(FontBitmap* font_bitmap, std::string text)
     : m_str { text }
-    , m_text_shader { text_shader }
     , m_font_bitmap { font_bitmap }
 {
 }
 TextBase::TextBase(TextBase&& other)
     : m_str { std::move(other.m_str) }
-    , m_text_shader { other.m_text_shader }
     , m_font_bitmap { other.m_font_bitmap }
     , m_pos { other.m_pos }
     , m_model { other.m_model }
@@ -112,13 +79,11 @@ TextBase::TextBase(TextBase&& other)
     , m_scale { other.m_scale }
     , m_color { other.m_color }
 {
-    other.m_text_shader = nullptr;
     other.m_font_bitmap = nullptr;
 }
 TextBase& TextBase::operator=(TextBase&& other)
 {
     m_str = std::move(other.m_str);
-    m_text_shader = other.m_text_shader;
     m_font_bitmap = other.m_font_bitmap;
     m_pos = other.m_pos;
     m_model = other.m_model;
@@ -126,7 +91,6 @@ TextBase& TextBase::operator=(TextBase&& other)
     m_scale = other.m_scale;
     m_color = other.m_color;
 
-    other.m_text_shader = nullptr;
     other.m_font_bitmap = nullptr;
 
     return *this;
@@ -137,68 +101,30 @@ Text2D::Text2D()
     : TextBase()
 {
 }
-Text2D::Text2D(FontBitmap* font, Shader* shader, std::string text)
-    : Text2D(text)
+Text2D::Text2D(FontBitmap* font, std::string text)
+    : TextBase(font, text)
 {
-    m_font_bitmap = font;
-    m_text_shader = shader;
+    update();
+    update_position();
 }
 Text2D::Text2D(std::string text)
-    : TextBase(font_instances::get_default_font_instance(),
-          shader_instances::get_instance(shader_instances::ShaderInstance::Text), text)
+    : Text2D(font_instances::get_default_font_instance(), text)
 {
-    ::glGenVertexArrays(1, &m_vao);
-    ::glGenBuffers(1, &m_vbo);
-    ::glBindVertexArray(m_vao);
-    ::glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-
-    ::glBufferData(GL_ARRAY_BUFFER, m_str.length() * 6 * sizeof(GlyphVertex), NULL, GL_STATIC_DRAW);
-
-    ::glEnableVertexAttribArray(0);
-    ::glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-
-    ::glEnableVertexAttribArray(1);
-    ::glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-
-    ::glBindBuffer(GL_ARRAY_BUFFER, 0);
-    ::glBindVertexArray(0);
-
-    update();
-    update_position();
 }
 Text2D::Text2D(Text2D&& other)
     : TextBase(std::move(other))
-    , m_vao { other.m_vao }
-    , m_vbo { other.m_vbo }
     , m_height(other.m_height)
     , m_width(other.m_width)
-
 {
-    other.m_vao = 0;
-    other.m_vbo = 0;
 }
 Text2D& Text2D::operator=(Text2D&& other)
 {
     TextBase::operator=(std::move(other));
-    m_vao = other.m_vao;
-    m_vbo = other.m_vbo;
     m_width = other.m_width;
     m_height = other.m_height;
-    other.m_vao = 0;
-    other.m_vbo = 0;
     return *this;
 }
-Text2D::~Text2D()
-{
-    if (m_vao) {
-        ::glDeleteVertexArrays(1, &m_vao);
-        m_vao = 0;
-    }
-    if (m_vbo) {
-        ::glDeleteBuffers(1, &m_vbo);
-        m_vbo = 0;
-    }
-}
+Text2D::~Text2D() { }
 Text3D::Text3D()
     : Text2D()
 {
@@ -206,8 +132,6 @@ Text3D::Text3D()
 Text3D::Text3D(std::string text)
     : Text2D(text)
 {
-    m_font_bitmap = font_instances::get_default_font_instance();
-    m_text_shader = shader_instances::get_instance(shader_instances::ShaderInstance::Text3D);
 }
 Text3D::Text3D(Text3D&& other)
     : Text2D(std::move(other))
@@ -219,4 +143,43 @@ Text3D& Text3D::operator=(Text3D&& other)
     return *this;
 }
 Text3D::~Text3D() { }
+TextBatch::TextBatch() { }
+TextBatch::TextBatch(TextBatch&& other)
+    : m_vao { other.m_vao }
+    , m_vbo { other.m_vbo }
+    , m_capacity { other.m_capacity }
+    , m_glyphs { std::move(other.m_glyphs) }
+    , m_font_bitmap { other.m_font_bitmap }
+{
+    other.m_vao = 0;
+    other.m_vbo = 0;
+    other.m_capacity = 0;
+}
+TextBatch& TextBatch::operator=(TextBatch&& other)
+{
+    if (m_vao)
+        ::glDeleteVertexArrays(1, &m_vao);
+    if (m_vbo)
+        ::glDeleteBuffers(1, &m_vbo);
+    m_vao = other.m_vao;
+    m_vbo = other.m_vbo;
+    m_capacity = other.m_capacity;
+    m_glyphs = std::move(other.m_glyphs);
+    m_font_bitmap = other.m_font_bitmap;
+    other.m_vao = 0;
+    other.m_vbo = 0;
+    other.m_capacity = 0;
+    return *this;
+}
+TextBatch::~TextBatch()
+{
+    if (m_vao) {
+        ::glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
+    if (m_vbo) {
+        ::glDeleteBuffers(1, &m_vbo);
+        m_vbo = 0;
+    }
+}
 }
@@ -0,0 +1,110 @@
+#include "FrameTimes.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace gm {
+
+    uint32_t FrameTimes::bucket_for(double ms){
+        auto us = (uint64_t)std::max(ms * 1000.0, 0.0);
+        if (us < SUB_BUCKETS)
+            return (uint32_t)us;
+        uint32_t msb = SUB_BUCKET_BITS;
+        while (us >> (msb + 1))
+            msb++;
+        if (msb >= MAX_MAGNITUDE)
+            return BUCKET_COUNT - 1;
+        uint32_t shift = msb - SUB_BUCKET_BITS + 1;
+        auto sub = (uint32_t)(us >> shift);
+        return SUB_BUCKETS + (shift - 1) * (SUB_BUCKETS / 2) + (sub - SUB_BUCKETS / 2);
+    }
+    double FrameTimes::bucket_upper_ms(uint32_t bucket){
+        if (bucket < SUB_BUCKETS)
+            return (bucket + 1) / 1000.0;
+        uint32_t k = bucket - SUB_BUCKETS;
+        uint32_t shift = k / (SUB_BUCKETS / 2) + 1;
+        uint64_t sub = k % (SUB_BUCKETS / 2) + SUB_BUCKETS / 2;
+        return (double)((sub + 1) << shift) / 1000.0;
+    }
+
+    void FrameTimes::add(double ms){
+        // bucketed as stored, so the frame leaves the same bucket it went into
+        auto sample = (float)ms;
+        if (m_window.size() < m_window_size) {
+            m_window.push_back(sample);
+        } else {
+            auto& oldest = m_window[m_window_offset];
+            m_counts[bucket_for(oldest)]--;
+            m_window_sum_ms -= oldest;
+            oldest = sample;
+            m_window_offset = (m_window_offset + 1) % m_window_size;
+        }
+        m_counts[bucket_for(sample)]++;
+        m_window_sum_ms += sample;
+    }
+    void FrameTimes::set_window(uint32_t frames){
+        if (frames == 0)
+            throw std::runtime_error("The frame time window needs at least one frame");
+        m_window_size = frames;
+        m_window.clear();
+        m_window.reserve(frames);
+        m_window_offset = 0;
+        m_window_sum_ms = 0.0;
+        std::fill(std::begin(m_counts), std::end(m_counts), 0);
+    }
+    uint32_t FrameTimes::get_window() const {
+        return m_window_size;
+    }
+    uint32_t FrameTimes::get_frames() const {
+        return (uint32_t)m_window.size();
+    }
+    double FrameTimes::percentile(double p) const {
+        if (m_window.empty())
+            return 0.0;
+        // nearest rank, the frame at that rank is somewhere in the bucket
+        auto rank = std::clamp<uint64_t>((uint64_t)std::ceil(p * m_window.size()), 1, m_window.size());
+        uint64_t seen = 0;
+        for (uint32_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+            seen += m_counts[bucket];
+            if (seen >= rank)
+                return bucket_upper_ms(bucket);
+        }
+        return bucket_upper_ms(BUCKET_COUNT - 1);
+    }
+    FrameTimes::Summary FrameTimes::summary() const {
+        Summary s{ .frames = get_frames() };
+        if (m_window.empty())
+            return s;
+        s.mean_ms = m_window_sum_ms / m_window.size();
+        s.p50_ms = percentile(0.50);
+        s.p95_ms = percentile(0.95);
+        s.p99_ms = percentile(0.99);
+        // exact, the bucket bound would overstate the worst frame by up to 3%
+        s.max_ms = *std::max_element(m_window.begin(), m_window.end());
+        return s;
+    }
+    uint32_t FrameTimes::get_count(uint32_t bucket) const {
+        return m_counts[bucket];
+    }
+    const std::vector<float>& FrameTimes::get_samples() const {
+        return m_window;
+    }
+    uint32_t FrameTimes::get_samples_offset() const {
+        return m_window_offset;
+    }
+
+    FrameTimesCsv::FrameTimesCsv(){}
+    FrameTimesCsv::FrameTimesCsv(const std::filesystem::path& path):
+        m_out(path)
+    {
+        if (!m_out)
+            throw std::runtime_error("Failed to open " + path.string());
+        m_out << "frame,time_s,frame_ms,sim_steps,draw_calls\n";
+    }
+    bool FrameTimesCsv::is_open() const {
+        return m_out.is_open();
+    }
+    void FrameTimesCsv::write(double time_s, double frame_ms, uint32_t sim_steps, uint32_t draw_calls){
+        m_out << m_frame++ << ',' << time_s << ',' << frame_ms << ',' << sim_steps << ',' << draw_calls << '\n';
+    }
+}
@@ -1,5 +1,12 @@
+#include "AllocTracker.hpp"
 #include "Font.hpp"
+#include "GlState.hpp"
+#include "Gravity.hpp"
 #include "Object.hpp"
+#include "Profiler.hpp"
+#include "Recording.hpp"
+#include "SceneFile.hpp"
+#include "SceneGen.hpp"
 #include "Singletons.hpp"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -9,12 +16,14 @@
 #include <algorithm>
 #include <array>
 #include <cctype>
+#include <cfloat>
 #include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <files.hpp>
 #include <filesystem>
+#include <fstream>
 #include <functional>
 #include <glm/common.hpp>
 #include <glm/ext/matrix_float4x4.hpp>
@@ -22,6 +31,7 @@
 #include <glm/ext/vector_float4.hpp>
 #include <glm/geometric.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <iostream>
 #include <limits>
 #include <numeric>
 #include <optional>
@@ -36,65 +46,20 @@
 namespace gm{
 
     namespace {
-    const float GRAV_CONST = 6.674e-11;
+    const float PROJECTION_NEAR_PLANE = 0.1f;
     const float PROJECTION_FAR_PLANE = 500.0f;
+    // bodies with a smaller radius on screen (in pixels) get drawn as impostors
+    const float IMPOSTOR_SCREEN_RADIUS = 3.0f;
+    const glm::vec3 GENERATED_STAR_COLOR = { 0.78, 0.52, 0.06 };
+    const glm::vec3 GENERATED_PLANET_COLOR = { 0.55, 0.55, 0.6 };
+    // relative to the working directory, load it in chrome://tracing or ui.perfetto.dev
+    const char* PROFILER_TRACE_PATH = "islands_trace.json";
+    constexpr size_t ALLOC_CALL_SITES_SHOWN = 20;
     Game* get_game_instance_ptr_from_window(GLFWwindow* window)
     {
         Game* instance = static_cast<Game*>(glfwGetWindowUserPointer(window));
         return instance;
     }
-    // for path prediction
-    struct Gravdata {
-        float mass {};
-        glm::vec3 pos {};
-        glm::vec3 vel {};
-        glm::vec3 acc {};
-        float radius {};
-        bool is_star {};
-    };
-    // step through one frame of gravity simulation
-    void gravity_step(std::vector<Gravdata>& gravdata, double delta_t, bool do_collision, const gui::CancelationToken& cancel)
-    {
-        for (size_t body = 0; body < gravdata.size() && !cancel.is_cancelled(); body++) {
-            for (size_t next_body = body + 1; next_body < gravdata.size() && !cancel.is_cancelled(); next_body++) {
-                auto& b_1 = gravdata[body];
-                auto& b_2 = gravdata[next_body];
-
-                if (do_collision && glm::distance(b_1.pos, b_2.pos) <= b_1.radius + b_2.radius) {
-                    auto [eater, eaten] = b_1.mass > b_2.mass ? std::make_tuple(std::ref(b_1), std::ref(b_2)) : std::make_tuple(std::ref(b_2), std::ref(b_1));
-                    if (eaten.is_star) {
-                        std::swap(eater, eaten);
-                    }
-                    eaten.mass = 0.0;
-                    eaten.radius = 0.0;
-                    eaten.vel = glm::vec3 { 0.0 };
-                }
-                // https://en.wikipedia.org/wiki/Newton%27s_law_of_universal_gravitation#Vector_form
-                auto m_1 = b_1.mass * obj::CelestialBody::MASS_BOOST_FACTOR;
-                auto m_2 = b_2.mass * obj::CelestialBody::MASS_BOOST_FACTOR;
-                ;
-
-                auto r_21 = b_2.pos - b_1.pos;
-                auto r_21_hat = glm::normalize(r_21);
-                auto distance = glm::distance(b_1.pos, b_2.pos);
-                // attraction force
-                auto f_21 = -GRAV_CONST * ((m_1 * m_2) / (distance * distance)) * r_21_hat;
-                auto f_12 = -f_21;
-
-                b_1.acc += f_12;
-                b_2.acc += f_21;
-            }
-        }
-        for (auto& b : gravdata) {
-            if (cancel.is_cancelled())
-                break;
-            b.vel += b.acc;
-            b.acc = glm::vec3(0);
-            auto tmp_speed = b.vel;
-            tmp_speed *= delta_t;
-            b.pos += tmp_speed;
-        }
-    }
     }
 
     void Game::collect_light_sources()
@@ -103,15 +68,19 @@ namespace gm{
         if (m_ssbos.light_sources.size != m_light_data.size()) {
             m_light_data.resize(m_ssbos.light_sources.size);
         }
+        m_shadow_maps.reserve(m_light_data.size());
         // std::vector<LightSource> ls(m_ssbos.light_sources.size);
         std::for_each(m_bodies.begin(), m_bodies.end(), [&](auto b_ptr) {
             if (auto star = dynamic_cast<obj::Star*>(b_ptr.get()); star) {
+                // stars past the shadow map array capacity still light the scene, just without shadows
+                star->set_shadow_layer(offset < (int)m_shadow_maps.get_capacity() ? offset : -1);
                 m_light_data[offset++] = {
                     .position = star->get_pos(),
                     .color = star->get_color(),
                     .att_linear = star->get_attenuation_linear(),
                     .att_quadratic = star->get_attenuation_quadratic(),
                     .radius = star->get_light_source_radius(),
+                    .shadow_layer = star->get_shadow_layer(),
                 };
             }
         });
@@ -211,11 +180,10 @@ namespace gm{
         }
         glfwGetFramebufferSize(m_window_ptr, &m_width, &m_height);
 
-        glViewport(0, 0, m_width, m_height);
+        gl_state::viewport(0, 0, m_width, m_height);
 
         initialize_singletons();
         initialize_uniforms();
-        m_gbuffer = Gbuffer { this->m_width, this->m_height };
 
 
         //load icons
@@ -272,6 +240,68 @@ namespace gm{
         m_gui.game_options_menu.fov = m_fov;
         m_gui.help_menu_enabled = true;
 
+        initialize_hud();
+
+        m_gui.selected_body_menu.trajectory_trail = obj::Trail(1024);
+        m_gui.selected_body_menu.trajectory_data.resize(m_gui.selected_body_menu.trajectory_trail.size());
+        m_gui.selected_body_menu.trajectory_color = { 0.1, 0.6, 0.4, 0.5 };
+        m_gui.selected_body_menu.trajectory_trail.set_color(m_gui.selected_body_menu.trajectory_color);
+
+        load_custom_textures_paths();
+    }
+    void Game::initialize_headless()
+    {
+        m_script = HeadlessScript::load(m_headless_options.script);
+        if (m_headless_options.frames)
+            m_script.frames = m_headless_options.frames;
+        m_width = m_script.width;
+        m_height = m_script.height;
+
+        m_headless = std::make_unique<HeadlessContext>();
+        m_headless->load_gl();
+        m_offscreen = OffscreenTarget(m_width, m_height);
+        // everything that would go to the window ends up in the offscreen target
+        m_render_graph.set_backbuffer(m_offscreen.get_framebuffer());
+        gl_state::bind_framebuffer(GL_FRAMEBUFFER, m_offscreen.get_framebuffer());
+        gl_state::viewport(0, 0, m_width, m_height);
+
+        initialize_singletons();
+        initialize_uniforms();
+
+        m_grid = std::make_unique<Grid>(Grid(9));
+        m_grid->set_scale(m_gui.game_options_menu.grid_scale);
+        m_grid->set_color(m_gui.game_options_menu.grid_color);
+        const std::array<std::string, 6> cube_map = {
+            files::game_data::textures::background::BKG1_RIGHT_PNG,
+            files::game_data::textures::background::BKG1_LEFT_PNG,
+            files::game_data::textures::background::BKG1_BOT_PNG,
+            files::game_data::textures::background::BKG1_TOP_PNG,
+            files::game_data::textures::background::BKG1_FRONT_PNG,
+            files::game_data::textures::background::BKG1_BACK_PNG,
+        };
+        m_skybox = std::make_unique<Skybox>(cube_map);
+        m_gui.game_options_menu.shadow_quality = std::clamp(m_script.shadow_quality, 0, static_cast<int>(ShadowQuality::__end) - 1);
+
+        if (!m_script.scene.empty())
+            generate_scene(m_script.scene, m_script.scene_bodies, m_script.scene_seed, false);
+        std::vector<gravity::Gravdata> bodies{};
+        for (auto& body : m_script.bodies) {
+            bodies.push_back(gravity::Gravdata {
+                .mass = body.mass,
+                .pos = body.pos,
+                .vel = body.vel,
+                .is_star = body.is_star,
+            });
+        }
+        add_bodies(bodies, "SCRIPTED");
+        // the script colors win over the default ones
+        for (size_t i = 0; i < m_script.bodies.size(); i++)
+            m_bodies[m_bodies.size() - m_script.bodies.size() + i]->set_color(m_script.bodies[i].color);
+
+        initialize_hud();
+    }
+    void Game::initialize_hud()
+    {
         m_gui.mode = font::Text2D("Edit");
         m_gui.mode.set_pos({ 0, 0 });
         m_gui.mode.set_color(gui::GameUI::EDIT_MODE_TEXT_COLOR);
@@ -288,19 +318,12 @@ namespace gm{
         m_gui.fps_count = font::Text2D("0");
         m_gui.fps_count.set_color({ 1.0, 1.0, 1.0 });
         m_gui.fps_count.set_scale(.5f);
-        m_gui.fps_count.set_pos({ m_width - m_gui.game_version.get_text_width(), m_gui.game_version.get_text_height() });
-
-        m_gui.selected_body_menu.trajectory_trail = obj::Trail(1024);
-        m_gui.selected_body_menu.trajectory_data.resize(m_gui.selected_body_menu.trajectory_trail.size());
-        m_gui.selected_body_menu.trajectory_color = { 0.1, 0.6, 0.4, 0.5 };
-        m_gui.selected_body_menu.trajectory_trail.set_color(m_gui.selected_body_menu.trajectory_color);
-
-        load_custom_textures_paths();
+        m_gui.fps_count.set_pos({ m_width - m_gui.fps_count.get_text_width(), m_gui.game_version.get_text_height() });
     }
     void Game::initialize_uniforms()
     {
         m_ubos.matrices.projection = glm::perspective(glm::radians(m_fov),
-            (float)m_width / (float)m_height, 0.1f, PROJECTION_FAR_PLANE);
+            (float)m_width / (float)m_height, PROJECTION_NEAR_PLANE, PROJECTION_FAR_PLANE);
 
         m_ubos.matrices.text_projection = glm::ortho(
             0.0f,
@@ -332,13 +355,23 @@ namespace gm{
         glGenBuffers(1, &m_ubos.lighting_globals.id);
         glBindBuffer(GL_UNIFORM_BUFFER, m_ubos.lighting_globals.id);
         glBufferData(GL_UNIFORM_BUFFER,
-            sizeof(LightingGlobalsUBO),
-            &m_ubos.lighting_globals, GL_STATIC_DRAW);
+            sizeof(LightingGlobalsUBO::__ambient_s_pad) + sizeof(LightingGlobalsUBO::camera_pos),
+            NULL, GL_STATIC_DRAW);
 
+        glBufferSubData(GL_UNIFORM_BUFFER,
+            0,
+            sizeof(LightingGlobalsUBO::__ambient_s_pad),
+            &m_ubos.lighting_globals.__ambient_s_pad);
         glBufferSubData(GL_UNIFORM_BUFFER,
             sizeof(LightingGlobalsUBO::__ambient_s_pad),
             sizeof(LightingGlobalsUBO::camera_pos),
             m_camera.get_pos_ptr());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, m_ubos.lighting_globals.mount_point, m_ubos.lighting_globals.id);
+
+        glGenBuffers(1, &m_ssbos.light_sources.id);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_ssbos.light_sources.mount_point, m_ssbos.light_sources.id);
     }
     void Game::initialize_singletons(){
         singl::shader_instances::load_all();
@@ -347,6 +380,11 @@ namespace gm{
     }
     void Game::run()
     {
+        profiler::set_thread_name("main");
+        if (m_headless) {
+            run_headless();
+            return;
+        }
         while (!glfwWindowShouldClose(m_window_ptr)) {
             m_current_frame_t = glfwGetTime();
             m_fps++;
@@ -356,6 +394,13 @@ namespace gm{
                 m_delta_t_record.pop_front();
             }
             m_delta_t_record.push_back(m_delta_t);
+            // the first delta is the whole startup
+            if (m_last_frame_t > 0.0) {
+                m_frame_times.add(m_delta_t * 1000.0);
+                if (m_frame_times_csv.is_open())
+                    m_frame_times_csv.write(m_current_frame_t, m_delta_t * 1000.0, m_sim_steps, gl_state::get_last_frame_stats().draw_calls);
+            }
+            m_sim_steps = 0;
             // a fixed update happens every 0.2 second
             if (m_current_frame_t - m_last_fixed_update_t >= 0.2) {
                 m_last_fixed_update_t = m_current_frame_t;
@@ -363,24 +408,111 @@ namespace gm{
             }
             if (m_current_frame_t - m_last_fps_update_t >= 1.0) {
                 m_last_fps_update_t = m_current_frame_t;
-                m_gui.fps_count.set_text(std::to_string(m_fps));
+                // the average hides stutter, the tail of the window shows it
+                char fps_text[64];
+                std::snprintf(fps_text, sizeof(fps_text), "%d fps, p99 %.1f ms", m_fps, m_frame_times.percentile(0.99));
+                m_gui.fps_count.set_text(fps_text);
+                m_gui.fps_count.set_pos({ m_width - m_gui.fps_count.get_text_width(), m_gui.game_version.get_text_height() });
                 m_fps = 0;
             }
             m_last_frame_t = m_current_frame_t;
 
+            GpuTimer::sync_clock();
             update_buffers();
             update();
             render();
-            glDisable(GL_FRAMEBUFFER_SRGB);
-            ImGui::Render();
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-            glEnable(GL_FRAMEBUFFER_SRGB);
-            glfwSwapBuffers(m_window_ptr);
+            {
+                PROFILE_ZONE("imgui render");
+                gl_state::disable(GL_FRAMEBUFFER_SRGB);
+                ImGui::Render();
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+                gl_state::enable(GL_FRAMEBUFFER_SRGB);
+            }
+            {
+                PROFILE_ZONE("swap buffers");
+                glfwSwapBuffers(m_window_ptr);
+            }
+            gl_state::end_frame();
+            profiler::end_frame();
+            alloc::end_frame();
             m_fixed_update = false;
         }
     }
+    void Game::run_headless()
+    {
+        HeadlessReport report{};
+        profiler::start_capture();
+        // same rate as the windowed fixed update
+        const uint32_t fixed_update_frames = std::max<uint32_t>(1, (uint32_t)std::lround(0.2 / m_script.delta_t));
+        const uint32_t total_frames = m_script.warmup + m_script.frames;
+        for (uint32_t frame = 0; frame < total_frames; frame++) {
+            const bool measured = frame >= m_script.warmup;
+            auto frame_start = profiler::now();
+            GpuTimer::sync_clock();
+            m_delta_t = m_script.delta_t;
+            m_fixed_update = frame % fixed_update_frames == 0;
+            // warmup frames included, or their steps would end up in the first measured one
+            m_sim_steps = 0;
+
+            auto [pos, target] = m_script.camera_at(frame);
+            auto dir = target - pos;
+            if (glm::length(dir) > 0.0f) {
+                dir = glm::normalize(dir);
+                m_camera.set_yaw(glm::degrees(std::atan2(dir.z, dir.x)));
+                m_camera.set_pitch(glm::degrees(std::asin(dir.y)));
+            }
+            m_camera.set_pos(pos);
+
+            update_buffers();
+            if (m_replay)
+                update_replay();
+            else
+                update_bodies();
+            render();
+            // stands in for the swap, keeps the driver from queueing up frames
+            glFlush();
+            alloc::end_frame();
+            if (measured) {
+                auto frame_ms = (profiler::now() - frame_start) / 1e6;
+                report.add_frame(frame_ms, gl_state::get_frame_stats(), alloc::get_last_frame());
+                if (m_frame_times_csv.is_open())
+                    m_frame_times_csv.write(frame * m_script.delta_t, frame_ms, m_sim_steps, gl_state::get_frame_stats().draw_calls);
+                auto& schedule = m_render_graph.get_schedule();
+                for (size_t i = 0; i < schedule.size(); i++) {
+                    report.add_pass(m_render_graph.get_pass(schedule[i]).name,
+                        m_render_graph.get_pass_cpu_ms()[i], m_render_graph.get_pass_draw_calls()[i]);
+                }
+            }
+            gl_state::end_frame();
+            profiler::end_frame();
+            if (measured) {
+                for (auto& zone : profiler::get_last_frame()) {
+                    if (zone.thread == profiler::GPU_THREAD)
+                        report.add_gpu_pass(zone.name, (zone.end - zone.start) / 1e6);
+                }
+            }
+        }
+        glFinish();
+        if (!m_headless_options.trace.empty())
+            profiler::stop_capture(m_headless_options.trace);
+
+        auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        if (m_headless_options.output.empty()) {
+            report.write_json(std::cout, m_script, renderer ? renderer : "");
+        } else {
+            auto out = std::ofstream(m_headless_options.output);
+            if (!out)
+                throw std::runtime_error("Failed to open " + m_headless_options.output.string());
+            report.write_json(out, m_script, renderer ? renderer : "");
+        }
+    }
+    void Game::stream_frame_times(const std::filesystem::path& path)
+    {
+        m_frame_times_csv = FrameTimesCsv(path);
+    }
     void Game::update()
     {
+        PROFILE_ZONE("update");
         auto selected_pos_before_update = glm::vec3(0);
         auto selected_pos_after_update = glm::vec3(0);
         // in case the body was selected during the update loop, so the initial camera offset is not equal to the bodies position
@@ -396,6 +528,7 @@ namespace gm{
         ImGui::NewFrame();
         // this has to happen before the while loop
         if (m_gui_enabled) {
+            PROFILE_ZONE("imgui build");
             draw_gui();
         }
         while (!m_key_events.empty()) {
@@ -411,7 +544,9 @@ namespace gm{
         }
         continuos_key_input();
 
-        if (!m_paused) {
+        if (m_replay) {
+            update_replay();
+        } else if (!m_paused) {
             update_bodies();
         }
         if (m_maximize != MaximizeState::DoNothing) {
@@ -471,6 +606,11 @@ namespace gm{
     }
     void Game::update_bodies()
     {
+        PROFILE_ZONE("update_bodies");
+        m_sim_steps++;
+        // the kernel already knows every distance, so the potential comes almost for free. It keeps the
+        // invariants of gravity::measure_pairwise, for the delta t of this step
+        gravity::Invariants invariants{};
         std::unordered_map<std::shared_ptr<obj::CelestialBody>, size_t> to_delete {};
         // std::vector<std::shared_ptr<obj::CelestialBody>> to_delete{};
         auto offset = 0;
@@ -483,15 +623,29 @@ namespace gm{
                     .att_linear = star->get_attenuation_linear(),
                     .att_quadratic = star->get_attenuation_quadratic(),
                     .radius = star->get_light_source_radius(),
+                    .shadow_layer = star->get_shadow_layer(),
                 };
             }
+            // the kernel adds forces straight to the velocity, so every body has unit inertia
+            invariants.add_body(1.0f, m_bodies[body]->get_pos(), m_bodies[body]->get_speed());
+            // a body that ate another one this step feels nothing from the rest of its row
+            bool ate = false;
             for (size_t next_body = body + 1; next_body < m_bodies.size(); next_body++) {
                 auto b_1 = m_bodies[body];
                 auto b_2 = m_bodies[next_body];
 
+                // https://en.wikipedia.org/wiki/Newton%27s_law_of_universal_gravitation#Vector_form
+                auto m_1 = b_1->get_mass() * gravity::MASS_BOOST_FACTOR;
+                auto m_2 = b_2->get_mass() * gravity::MASS_BOOST_FACTOR;
+                auto distance = glm::distance(b_1->get_pos(), b_2->get_pos());
+                // every pair, before a collision can skip the rest of the row
+                invariants.potential -= (double)gravity::GRAV_CONST * m_1 * m_2 / (distance * m_delta_t);
+                if (ate)
+                    continue;
+
                 auto& do_collision = m_gui.game_options_menu.do_collision;
                 // check if collision first
-                if (do_collision && glm::distance(b_1->get_pos(), b_2->get_pos()) <= b_1->get_radius() + b_2->get_radius()) {
+                if (do_collision && distance <= b_1->get_radius() + b_2->get_radius()) {
                     auto [eater, eaten] = b_1->get_mass() > b_2->get_mass() ? std::make_tuple(b_1, b_2) : std::make_tuple(b_2, b_1);
                     if (dynamic_cast<obj::Star*>(eaten.get())) {
                         std::swap(eater, eaten);
@@ -499,19 +653,15 @@ namespace gm{
                     if (to_delete.find(eaten) == to_delete.end()) {
                         eater->set_mass(eater->get_mass() + eaten->get_mass());
                         to_delete.insert({ eaten, next_body });
-                        break;
+                        ate = true;
+                        continue;
                     }
                 }
-                // https://en.wikipedia.org/wiki/Newton%27s_law_of_universal_gravitation#Vector_form
-                auto m_1 = b_1->get_mass() * obj::CelestialBody::MASS_BOOST_FACTOR;
-                auto m_2 = b_2->get_mass() * obj::CelestialBody::MASS_BOOST_FACTOR;
-                ;
 
                 auto r_21 = b_2->get_pos() - b_1->get_pos();
                 auto r_21_hat = glm::normalize(r_21);
-                auto distance = glm::distance(b_1->get_pos(), b_2->get_pos());
                 // attraction force
-                auto f_21 = -GRAV_CONST * ((m_1 * m_2) / (distance * distance)) * r_21_hat;
+                auto f_21 = -gravity::GRAV_CONST * ((m_1 * m_2) / (distance * distance)) * r_21_hat;
                 auto f_12 = -f_21;
 
                 b_1->set_acceleration(b_1->get_acceleration() + f_12);
@@ -521,10 +671,134 @@ namespace gm{
             if (m_fixed_update)
                 m_bodies[body]->fixed_update();
         }
+        m_drift_monitor.add(invariants);
         for (auto [ptr, idx] : to_delete) {
             remove_body(ptr.get());
         }
-        buffer_light_data();
+        m_step++;
+        m_sim_time += m_delta_t;
+        if (m_recorder && m_recorder->wants(m_step))
+            record_frame();
+        if (m_checkpoints && m_step % m_checkpoint_every == 0)
+            m_checkpoints->write(capture_scene());
+    }
+    void Game::record_frame()
+    {
+        PROFILE_ZONE("record");
+        auto frame = m_recorder->begin_frame();
+        // the writer is behind, better a gap in the recording than a hitch
+        if (!frame)
+            return;
+        frame->step = m_step;
+        frame->time = m_sim_time;
+        frame->layout = m_body_layout;
+        frame->resize(m_bodies.size());
+        for (size_t i = 0; i < m_bodies.size(); i++) {
+            auto& body = m_bodies[i];
+            frame->pos[i] = body->get_pos();
+            frame->mass[i] = body->get_mass();
+            frame->radius[i] = body->get_radius();
+            frame->color[i] = body->get_color();
+            frame->flags[i] = dynamic_cast<obj::Star*>(body.get()) ? record::FLAG_STAR : 0;
+        }
+        m_recorder->submit(frame);
+    }
+    void Game::start_recording(const std::filesystem::path& path, uint32_t interval)
+    {
+        stop_recording();
+        m_recorder = std::make_unique<record::Recorder>(path, interval);
+    }
+    void Game::stop_recording()
+    {
+        m_recorder.reset();
+    }
+    void Game::start_checkpoints(const std::filesystem::path& base, uint64_t every, uint32_t keep)
+    {
+        stop_checkpoints();
+        // a fork would take the window and the GL context along, so the game always copies
+        m_checkpoints = std::make_unique<scene::CheckpointWriter>(base, keep);
+        m_checkpoint_every = std::max<uint64_t>(every, 1);
+    }
+    void Game::stop_checkpoints()
+    {
+        m_checkpoints.reset();
+    }
+    void Game::start_replay(const std::filesystem::path& path)
+    {
+        auto replay = std::make_unique<record::Replay>(path);
+        stop_recording();
+        remove_all_bodies();
+        m_replay = std::move(replay);
+        m_replay_time = m_replay->get_entry(0).time;
+        m_replay_record = 0;
+        m_replay_layout = UINT64_MAX;
+        apply_replay_frame(m_replay->decode(0));
+    }
+    void Game::stop_replay()
+    {
+        m_replay.reset();
+        on_bodies_changed();
+    }
+    void Game::update_replay()
+    {
+        PROFILE_ZONE("update_replay");
+        auto first = m_replay->get_entry(0).time;
+        auto last = m_replay->get_entry(m_replay->size() - 1).time;
+        if (!m_paused) {
+            m_replay_time += m_delta_t * m_gui.game_options_menu.replay_speed;
+            if (m_replay_time > last)
+                m_replay_time = m_gui.game_options_menu.replay_loop ? first : last;
+            if (m_fixed_update) {
+                for (auto& body : m_bodies)
+                    body->fixed_update();
+            }
+        }
+        // at high speeds most records are skipped, only the shown one gets decoded
+        auto record = m_replay->find(std::clamp(m_replay_time, first, last));
+        if (record != m_replay_record)
+            apply_replay_frame(m_replay->decode(record));
+        m_replay_record = record;
+    }
+    void Game::apply_replay_frame(const record::Frame& frame)
+    {
+        PROFILE_ZONE("apply replay frame");
+        const size_t n = frame.pos.size();
+        bool same_bodies = m_bodies.size() == n;
+        for (size_t i = 0; same_bodies && i < n; i++)
+            same_bodies = (dynamic_cast<obj::Star*>(m_bodies[i].get()) != nullptr) == ((frame.flags[i] & record::FLAG_STAR) != 0);
+        if (!same_bodies) {
+            remove_all_bodies();
+            m_bodies.reserve(n);
+            for (size_t i = 0; i < n; i++) {
+                std::shared_ptr<obj::CelestialBody> body{};
+                if (frame.flags[i] & record::FLAG_STAR) {
+                    body = std::make_shared<obj::Star>(nullptr, frame.pos[i], glm::vec3(0), glm::vec3(0), frame.mass[i]);
+                    m_ssbos.light_sources.size++;
+                } else {
+                    body = std::make_shared<obj::Planet>(nullptr, frame.pos[i], glm::vec3(0), glm::vec3(0), frame.mass[i]);
+                }
+                body->set_color(frame.color[i]);
+                m_bodies.push_back(std::move(body));
+            }
+            on_bodies_changed();
+        } else {
+            // the speed is what stop_replay leaves the bodies with
+            auto dt = frame.time - m_replay->get_entry(m_replay_record).time;
+            bool forward = dt > 0.0 && m_replay_layout == frame.layout;
+            for (size_t i = 0; i < n; i++) {
+                auto& body = m_bodies[i];
+                if (forward)
+                    body->set_speed((frame.pos[i] - body->get_pos()) / (float)dt);
+                body->move_to(frame.pos[i]);
+                // only keyframes can change anything else
+                if (m_replay_layout != frame.layout) {
+                    body->set_mass(frame.mass[i]);
+                    body->set_color(frame.color[i]);
+                }
+            }
+        }
+        m_replay_layout = frame.layout;
+        collect_light_sources();
     }
     void Game::remove_body(obj::CelestialBody* body)
     {
@@ -534,91 +808,168 @@ namespace gm{
             remove_planet(dynamic_cast<obj::Planet*>(body));
         }
     }
+    void Game::cull_scene()
+    {
+        auto frustum = Frustum::from_matrix(m_ubos.matrices.projection * m_ubos.matrices.view);
+        m_visible_bodies.clear();
+        m_visible_trails.clear();
+        m_visible_labels.clear();
+
+        m_cull_spheres.clear();
+        for (auto& body : m_bodies)
+            m_cull_spheres.push(body->get_pos(), body->get_radius());
+        frustum.cull_spheres(m_cull_spheres, m_visible_bodies);
+
+        if (m_gui.game_options_menu.draw_trails) {
+            m_cull_spheres.clear();
+            for (auto& body : m_bodies) {
+                auto [center, radius] = body->trail().get_bounding_sphere();
+                m_cull_spheres.push(center, radius);
+            }
+            frustum.cull_spheres(m_cull_spheres, m_visible_trails);
+        }
+        if (m_gui.game_options_menu.draw_labels) {
+            m_cull_spheres.clear();
+            for (auto& body : m_bodies) {
+                auto& label = body->label();
+                // labels are billboards centered on their position, so the diagonal covers any rotation
+                auto extent = glm::vec2(label.get_text_width(), label.get_text_height());
+                m_cull_spheres.push(label.get_pos(), glm::length(extent));
+            }
+            frustum.cull_spheres(m_cull_spheres, m_visible_labels);
+        }
+    }
+    void Game::select_lods(bool allow_impostors)
+    {
+        m_impostor_planets.clear();
+        m_impostor_stars.clear();
+        std::fill(std::begin(m_lod_counts), std::end(m_lod_counts), 0);
+
+        const float pixels_per_unit = m_ubos.matrices.projection[1][1] * m_height * 0.5f;
+        auto selected = m_gui.selected_body.lock();
+        // bodies that become impostors are moved out of m_visible_bodies into their own batches
+        size_t kept = 0;
+        for (auto idx : m_visible_bodies) {
+            auto& body = m_bodies[idx];
+            auto distance = std::max(glm::distance(m_camera.get_pos(), body->get_pos()), PROJECTION_NEAR_PLANE);
+            auto radius_px = body->get_radius() / distance * pixels_per_unit;
+            // textured and selected bodies always keep a mesh, the impostors only know a flat color
+            if (allow_impostors && radius_px < IMPOSTOR_SCREEN_RADIUS && !body->get_texture() && body != selected) {
+                obj::ImpostorData impostor {
+                    .center = body->get_pos(),
+                    .radius = body->get_radius(),
+                    .color = body->get_color(),
+                };
+                if (dynamic_cast<obj::Star*>(body.get()))
+                    m_impostor_stars.push_back(impostor);
+                else
+                    m_impostor_planets.push_back(impostor);
+                continue;
+            }
+            body->set_lod(obj::UnitSphereVAO::lod_for_screen_radius(radius_px));
+            m_lod_counts[body->get_lod()]++;
+            m_visible_bodies[kept++] = idx;
+        }
+        m_visible_bodies.resize(kept);
+    }
+    void Game::render_impostors(Shader* shader, const std::vector<obj::ImpostorData>& impostors)
+    {
+        if (impostors.empty())
+            return;
+        shader->use_shader();
+        shader->set_float("viewport_height", m_height);
+        shader->set_vec2("viewport_size", glm::vec2(m_width, m_height));
+        shader->set_mat4("inverse_view_projection", glm::inverse(m_ubos.matrices.projection * m_ubos.matrices.view));
+        gl_state::enable(GL_PROGRAM_POINT_SIZE);
+        singl::buffer_instances::get_instance<obj::ImpostorBatchVAO>(singl::buffer_instances::BufferInstance::Impostors)->draw(impostors);
+        gl_state::disable(GL_PROGRAM_POINT_SIZE);
+    }
+    void Game::render_shadow_maps()
+    {
+        PROFILE_ZONE("shadow maps");
+        // every star draws into its own layers of the array, so it only has to be cleared once
+        glClear(GL_DEPTH_BUFFER_BIT);
+        gl_state::cull_face(GL_FRONT);
+        for (auto& c_obj : m_bodies) {
+            auto star = dynamic_cast<obj::Star*>(c_obj.get());
+            if (!star || star->get_shadow_layer() < 0)
+                continue;
+            PROFILE_ZONE("shadow map star");
+            star->get_shadow_timer().begin();
+            star->load_shadow_transforms_uniform();
+            star->reset_shadow_cull_stats();
+            for (auto& obj : m_bodies) {
+                if (obj.get() == star)
+                    continue;
+                auto face_mask = star->shadow_face_mask(obj->get_pos(), obj->get_radius());
+                star->record_shadow_caster(face_mask);
+                if (face_mask)
+                    obj->shadow_render(face_mask, star->shadow_lod(obj->get_pos(), obj->get_radius()));
+            }
+            star->get_shadow_timer().end();
+        }
+        gl_state::cull_face(GL_BACK);
+    }
     void Game::render_gbuffer()
     {
+        PROFILE_ZONE("gbuffer");
         glClearColor(0, 0, 0, 0);
-        m_gbuffer.bind();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glDisable(GL_BLEND);
-        glDisable(GL_FRAMEBUFFER_SRGB);
-        // glDisable(GL_CULL_FACE);
-        std::size_t i = 0;
-        for (auto& c_obj : m_bodies) {
-            if (auto planet = dynamic_cast<obj::Planet*>(c_obj.get()); planet) {
+        gl_state::disable(GL_BLEND);
+        gl_state::disable(GL_FRAMEBUFFER_SRGB);
+        for (auto idx : m_visible_bodies) {
+            if (auto planet = dynamic_cast<obj::Planet*>(m_bodies[idx].get()); planet) {
                 planet->deferred_render();
             }
-            if (auto star = dynamic_cast<obj::Star*>(c_obj.get()); star) {
-                m_gbuffer.unbind();
-                glBindFramebuffer(GL_FRAMEBUFFER, star->get_shadow_map_fbo());
-                auto [w, h] = obj::Star::get_shadow_map_size();
-                glViewport(0, 0, w, h);
-                glClear(GL_DEPTH_BUFFER_BIT);
-                glCullFace(GL_FRONT);
-
-                star->load_shadow_transforms_uniform();
-                for (auto& obj : m_bodies) {
-                    if (obj.get() == star)
-                        continue;
-                    obj->shadow_render();
-                }
-                glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-                m_gbuffer.bind();
-                m_light_data[i++].shadow_map_id = star->get_shadow_map_id();
-                glCullFace(GL_BACK);
-            }
         }
-        m_gbuffer.unbind();
+        render_impostors(singl::shader_instances::get_instance(singl::shader_instances::ShaderInstance::ImpostorDeferred),
+            m_impostor_planets);
     }
-    void Game::render_light_volumes()
+    void Game::render_lighting(uint32_t g_depth, uint32_t g_normal, uint32_t g_albedo_spec)
     {
+        PROFILE_ZONE("lighting");
+        buffer_light_data();
+        m_light_clusters.build(m_light_data,
+            m_ubos.matrices.view,
+            m_ubos.matrices.projection,
+            PROJECTION_NEAR_PLANE,
+            PROJECTION_FAR_PLANE);
+        m_light_clusters.upload();
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendEquation(GL_FUNC_ADD);
-        glBlendFunc(GL_ONE, GL_ONE);
-        glCullFace(GL_FRONT);
-        auto* uv = singl::buffer_instances::get_instance<obj::UnitSphereVAO>(singl::buffer_instances::BufferInstance::UnitSphere);
+        // the light pass writes the gbuffer depth into the backbuffer, so the forward pass can depth test against it
+        gl_state::enable(GL_DEPTH_TEST);
+        gl_state::depth_func(GL_ALWAYS);
         using namespace singl;
-        auto lv_shader = shader_instances::get_instance(shader_instances::ShaderInstance::LightPassSphere);
-        lv_shader->use_shader();
-        lv_shader->set_int("g_position", 0);
-        lv_shader->set_int("g_normal", 1);
-        lv_shader->set_int("g_albedo_spec", 2);
-        lv_shader->set_float("far_plane", obj::Star::s_shadow_far_plane);
+        auto quality = static_cast<ShadowQuality>(m_gui.game_options_menu.shadow_quality);
+        auto& timer = m_light_pass_timers[static_cast<int>(quality)];
+        timer.begin();
+        auto lp_shader = shader_instances::light_pass_instance(quality);
+        lp_shader->use_shader();
+        lp_shader->set_int("g_depth", 0);
+        lp_shader->set_int("g_normal", 1);
+        lp_shader->set_int("g_albedo_spec", 2);
+        lp_shader->set_int("shadow_maps", 3);
+        lp_shader->set_float("far_plane", obj::Star::s_shadow_far_plane);
+        lp_shader->set_vec2("screen_size", glm::vec2(m_width, m_height));
+        lp_shader->set_mat4("inverse_view_projection", glm::inverse(m_ubos.matrices.projection * m_ubos.matrices.view));
+        m_light_clusters.set_uniforms(lp_shader);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_gbuffer.g_position);
+        glBindTexture(GL_TEXTURE_2D, g_depth);
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, m_gbuffer.g_normal);
+        glBindTexture(GL_TEXTURE_2D, g_normal);
         glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, m_gbuffer.g_color_spec);
-        for (auto& ls : m_light_data) {
-            glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, ls.shadow_map_id);
-            lv_shader->set_int("shadow_map", 3);
-            auto model = glm::mat4(1.0f);
-            model = glm::translate(model, ls.position);
-            model = glm::scale(model, glm::vec3(ls.radius));
-            lv_shader->set_mat4("model", model);
-            lv_shader->set_vec3("color", ls.color);
-            lv_shader->set_float("att_linear", ls.att_linear);
-            lv_shader->set_float("att_quadratic", ls.att_quadratic);
-            lv_shader->set_vec3("light_source_pos", ls.position);
-            uv->draw();
-        }
-        glDisable(GL_CULL_FACE);
-        glBlendFunc(GL_ONE, GL_ZERO);
-        glDisable(GL_BLEND);
-        glEnable(GL_DEPTH_TEST);
-
-        // blit the depth buffer
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_gbuffer.fbo);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-        glBlitFramebuffer(
-            0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glEnable(GL_FRAMEBUFFER_SRGB);
+        glBindTexture(GL_TEXTURE_2D, g_albedo_spec);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_shadow_maps.get_texture());
+        m_render_graph.draw_fullscreen_triangle();
+        glActiveTexture(GL_TEXTURE0);
+        gl_state::depth_func(GL_LESS);
+        timer.end();
+
+        gl_state::enable(GL_CULL_FACE);
+        gl_state::cull_face(GL_BACK);
+        gl_state::enable(GL_FRAMEBUFFER_SRGB);
     }
     void Game::render()
     {
@@ -634,22 +985,79 @@ namespace gm{
 #else
             false;
 #endif
-        if (!wireframe_draw)
-            render_gbuffer();
-
-        if (!wireframe_draw)
-            render_light_volumes();
-        else {
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        }
-
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        PROFILE_ZONE("render");
+        cull_scene();
+        select_lods(!normals_draw && !wireframe_draw);
+        build_render_graph(normals_draw, wireframe_draw);
+        m_render_graph.compile();
+        m_render_graph.execute();
+    }
+    void Game::build_render_graph(bool normals_draw, bool wireframe_draw)
+    {
+        using Pass = RenderGraph::Pass;
+        auto& graph = m_render_graph;
+        graph.begin_frame(m_width, m_height);
+        if (!wireframe_draw) {
+            auto g_depth = graph.create_texture("gbuffer depth", { GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, true });
+            // octahedral encoded normals
+            auto g_normal = graph.create_texture("gbuffer normal", { GL_RG16_SNORM, GL_RG, GL_SHORT, false });
+            auto g_albedo_spec = graph.create_texture("gbuffer albedo", { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, false });
+            std::vector<RenderGraph::Resource> lighting_inputs = { g_depth, g_normal, g_albedo_spec };
+            if (m_shadow_maps.get_capacity() > 0) {
+                auto shadow_maps = graph.import_target("shadow maps", m_shadow_maps.get_framebuffer(),
+                    m_shadow_maps.get_width(), m_shadow_maps.get_height());
+                graph.add_pass(Pass {
+                    .name = "shadows",
+                    .writes = { shadow_maps },
+                    .execute = [this](const RenderGraph&) { render_shadow_maps(); },
+                });
+                lighting_inputs.push_back(shadow_maps);
+            }
+            graph.add_pass(Pass {
+                .name = "gbuffer",
+                .writes = { g_normal, g_albedo_spec, g_depth },
+                .execute = [this](const RenderGraph&) { render_gbuffer(); },
+            });
+            graph.add_pass(Pass {
+                .name = "lighting",
+                .reads = lighting_inputs,
+                .writes = { RenderGraph::BACKBUFFER },
+                .execute = [this, g_depth, g_normal, g_albedo_spec](const RenderGraph& g) {
+                    render_lighting(g.get_texture(g_depth), g.get_texture(g_normal), g.get_texture(g_albedo_spec));
+                },
+            });
+        } else {
+            graph.add_pass(Pass {
+                .name = "clear",
+                .writes = { RenderGraph::BACKBUFFER },
+                .execute = [](const RenderGraph&) { glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); },
+            });
+        }
+        graph.add_pass(Pass {
+            .name = "forward",
+            .writes = { RenderGraph::BACKBUFFER },
+            .execute = [this, normals_draw, wireframe_draw](const RenderGraph&) { render_forward(normals_draw, wireframe_draw); },
+        });
+        graph.add_pass(Pass {
+            .name = "labels and HUD",
+            .writes = { RenderGraph::BACKBUFFER },
+            .execute = [this](const RenderGraph&) { render_2d(); },
+        });
+    }
+    void Game::render_forward(bool normals_draw, bool wireframe_draw)
+    {
+        PROFILE_ZONE("forward");
+        gl_state::enable(GL_BLEND);
+        gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         if(m_gui.game_options_menu.draw_skybox)
             m_skybox->forward_render();
-        for (auto& c_obj : m_bodies) {
-            c_obj->forward_render(normals_draw, wireframe_draw, m_gui.game_options_menu.draw_trails);
+        for (auto idx : m_visible_bodies) {
+            m_bodies[idx]->forward_render(normals_draw, wireframe_draw, false);
+        }
+        render_impostors(singl::shader_instances::get_instance(singl::shader_instances::ShaderInstance::ImpostorForward),
+            m_impostor_stars);
+        for (auto idx : m_visible_trails) {
+            m_bodies[idx]->trail().forward_render();
         }
         if (m_gui.game_options_menu.draw_grid) {
             m_grid->forward_render(m_camera.get_pos());
@@ -661,37 +1069,38 @@ namespace gm{
             auto slc = m_gui.selected_body.lock();
             obj::SelectedMarker::instance().forward_render(m_camera.get_pos(), slc->get_pos(), slc->get_radius());
         }
-        if (m_gui.game_options_menu.draw_labels) {
-            for (auto& obj : m_bodies) {
-                auto& lab = obj->label();
-                lab.draw();
-            }
-        }
-        glDisable(GL_BLEND);
-
-        render_2d();
+        gl_state::disable(GL_BLEND);
     }
     void Game::render_2d()
     {
-        glDisable(GL_CULL_FACE);
+        PROFILE_ZONE("labels and HUD");
+        for (auto idx : m_visible_labels) {
+            m_text_batch.add(m_bodies[idx]->label());
+        }
+        gl_state::disable(GL_CULL_FACE);
 #ifdef DEBUG
         if (m_gui.debug_menu.draw_wireframe) {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            gl_state::polygon_mode(GL_FILL);
         }
 #endif
-        m_gui.mode.draw();
+        m_text_batch.add(m_gui.mode);
         if (m_paused) {
-            m_gui.paused.draw();
-        }
-        m_gui.game_version.draw();
-        m_gui.fps_count.draw();
+            m_text_batch.add(m_gui.paused);
+        }
+        m_text_batch.add(m_gui.game_version);
+        m_text_batch.add(m_gui.fps_count);
+        // labels and HUD go out together, the HUD sits on the near plane so the depth test never hides it
+        gl_state::enable(GL_BLEND);
+        gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        m_text_batch.flush();
+        gl_state::disable(GL_BLEND);
 #ifdef DEBUG
         if (m_gui.debug_menu.draw_wireframe) {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            gl_state::polygon_mode(GL_LINE);
         }
         if (m_gui.debug_menu.do_face_culling) {
 #endif
-            glEnable(GL_CULL_FACE);
+            gl_state::enable(GL_CULL_FACE);
 #ifdef DEBUG
         }
 #endif
@@ -728,6 +1137,48 @@ namespace gm{
             .h = size.y
         };
     }
+#ifdef DEBUG
+    // one lane per thread, one row per zone depth, the width of the window is the last frame
+    static void draw_profiler_flame_view()
+    {
+        constexpr float ROW_HEIGHT = 18.0f;
+        const auto& events = profiler::get_last_frame();
+        const auto frame_start = profiler::get_last_frame_start();
+        const auto frame_end = profiler::get_last_frame_end();
+        if (frame_end <= frame_start)
+            return;
+        const float width = ImGui::GetContentRegionAvail().x;
+        const float ns_to_px = width / (float)(frame_end - frame_start);
+        auto draw_list = ImGui::GetWindowDrawList();
+        for (auto& thread : profiler::get_threads()) {
+            uint32_t rows = 0;
+            for (auto& e : events)
+                if (e.thread == thread.id)
+                    rows = std::max(rows, e.depth + 1);
+            if (rows == 0)
+                continue;
+            ImGui::Text("%s", thread.name ? thread.name : "unnamed thread");
+            auto origin = ImGui::GetCursorScreenPos();
+            ImGui::InvisibleButton(thread.name ? thread.name : "##lane", ImVec2(width, rows * ROW_HEIGHT));
+            auto mouse = ImGui::GetMousePos();
+            for (auto& e : events) {
+                if (e.thread != thread.id)
+                    continue;
+                // zones of other threads can start before this frame
+                auto start = std::max(e.start, frame_start);
+                auto min = ImVec2(origin.x + (start - frame_start) * ns_to_px, origin.y + e.depth * ROW_HEIGHT);
+                auto max = ImVec2(std::max(origin.x + (e.end - frame_start) * ns_to_px, min.x + 1.0f), min.y + ROW_HEIGHT - 1.0f);
+                auto hue = (float)(std::hash<const char*> {}(e.name) % 64) / 64.0f;
+                draw_list->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.7f));
+                draw_list->PushClipRect(min, max, true);
+                draw_list->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32_WHITE, e.name);
+                draw_list->PopClipRect();
+                if (ImGui::IsItemHovered() && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y)
+                    ImGui::SetTooltip("%s: %.3f ms", e.name, (e.end - e.start) / 1e6);
+            }
+        }
+    }
+#endif
     void Game::draw_game_options_gui()
     {
         ImGui::Begin("Game Options", &m_gui.game_options_menu_enabled, 0);
@@ -738,7 +1189,7 @@ namespace gm{
         if (ImGui::SliderFloat("Camera FOV", &m_gui.game_options_menu.fov, 30, 120, NULL, ImGuiSliderFlags_AlwaysClamp)) {
             m_fov = m_gui.game_options_menu.fov;
             m_ubos.matrices.projection = glm::perspective(glm::radians(m_fov),
-                (float)m_width / (float)m_height, 0.1f, PROJECTION_FAR_PLANE);
+                (float)m_width / (float)m_height, PROJECTION_NEAR_PLANE, PROJECTION_FAR_PLANE);
         }
         if (ImGui::Combo("Window size",
                 &m_gui.game_options_menu.current,
@@ -761,9 +1212,89 @@ namespace gm{
         if (ImGui::SliderFloat4("Grid color", glm::value_ptr(m_gui.game_options_menu.grid_color), 0.0, 1.0)) {
             m_grid->set_color(m_gui.game_options_menu.grid_color);
         }
+        ImGui::Combo("Shadow quality", &m_gui.game_options_menu.shadow_quality,
+            SHADOW_QUALITY_NAMES, static_cast<int>(ShadowQuality::__end));
+        if (ImGui::BeginTable("Lighting pass GPU time", 2)) {
+            for (int q = 0; q < static_cast<int>(ShadowQuality::__end); q++) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", SHADOW_QUALITY_NAMES[q]);
+                ImGui::TableNextColumn();
+                if (m_light_pass_timers[q].has_result())
+                    ImGui::Text("%.3f ms", m_light_pass_timers[q].get_average_ms());
+                else
+                    ImGui::TextDisabled("not measured");
+            }
+            ImGui::EndTable();
+        }
         if (ImGui::ColorEdit3("Predicted trajectory color", glm::value_ptr(m_gui.selected_body_menu.trajectory_color))) {
             m_gui.selected_body_menu.trajectory_trail.set_color(m_gui.selected_body_menu.trajectory_color);
         }
+        ImGui::SeparatorText("Recording");
+        auto& options = m_gui.game_options_menu;
+        if (!m_recorder) {
+            m_typing |= ImGui::InputText("Recording file", options.record_file, IM_ARRAYSIZE(options.record_file));
+            ImGui::InputInt("Record every N steps", &options.record_interval);
+            options.record_interval = std::max(options.record_interval, 1);
+            if (ImGui::Button("Start recording")) {
+                try {
+                    start_recording(options.record_file, options.record_interval);
+                    options.record_error.clear();
+                } catch (const std::runtime_error& e) {
+                    options.record_error = e.what();
+                }
+            }
+            if (!options.record_error.empty())
+                ImGui::TextColored(ImVec4(.8, .1, .0, 1.), "%s", options.record_error.c_str());
+        } else {
+            ImGui::Text("%llu steps recorded, %llu dropped, %.1f MB", (unsigned long long)m_recorder->get_recorded(),
+                (unsigned long long)m_recorder->get_dropped(), m_recorder->get_bytes_written() / 1e6);
+            if (ImGui::Button("Stop recording"))
+                stop_recording();
+        }
+        ImGui::SeparatorText("Checkpoints");
+        if (!m_checkpoints) {
+            m_typing |= ImGui::InputText("Checkpoint file", options.checkpoint_file, IM_ARRAYSIZE(options.checkpoint_file));
+            ImGui::InputInt("Checkpoint every N steps", &options.checkpoint_every);
+            options.checkpoint_every = std::max(options.checkpoint_every, 1);
+            ImGui::InputInt("Checkpoints kept", &options.checkpoint_keep);
+            options.checkpoint_keep = std::max(options.checkpoint_keep, 1);
+            if (ImGui::Button("Start checkpoints"))
+                start_checkpoints(options.checkpoint_file, options.checkpoint_every, options.checkpoint_keep);
+        } else {
+            ImGui::Text("%llu written, %llu skipped", (unsigned long long)m_checkpoints->get_written(),
+                (unsigned long long)m_checkpoints->get_skipped());
+            if (m_fixed_update)
+                options.checkpoint_error = m_checkpoints->get_error();
+            if (!options.checkpoint_error.empty())
+                ImGui::TextColored(ImVec4(.8, .1, .0, 1.), "%s", options.checkpoint_error.c_str());
+            if (ImGui::Button("Stop checkpoints"))
+                stop_checkpoints();
+        }
+        ImGui::SeparatorText("Replay");
+        if (!m_replay) {
+            m_typing |= ImGui::InputText("Replay file", options.replay_file, IM_ARRAYSIZE(options.replay_file));
+            if (ImGui::Button("Start replay")) {
+                try {
+                    start_replay(options.replay_file);
+                    options.replay_error.clear();
+                } catch (const std::runtime_error& e) {
+                    options.replay_error = e.what();
+                }
+            }
+            if (!options.replay_error.empty())
+                ImGui::TextColored(ImVec4(.8, .1, .0, 1.), "%s", options.replay_error.c_str());
+        } else {
+            double first = m_replay->get_entry(0).time;
+            double last = m_replay->get_entry(m_replay->size() - 1).time;
+            ImGui::SliderScalar("Time", ImGuiDataType_Double, &m_replay_time, &first, &last, "%.2f s");
+            ImGui::SliderFloat("Speed", &options.replay_speed, 0.1, 1000.0, "%.1fx", ImGuiSliderFlags_Logarithmic);
+            ImGui::Checkbox("Loop", &options.replay_loop);
+            ImGui::Text("record %zu/%zu, step %llu", m_replay_record + 1, m_replay->size(),
+                (unsigned long long)m_replay->get_entry(m_replay_record).step);
+            if (ImGui::Button("Stop replay"))
+                stop_replay();
+        }
         ImGui::End();
     }
     static bool validate_new_name(const std::string& new_name)
@@ -796,6 +1327,47 @@ namespace gm{
             ImGui::TextColored(ImVec4(.8, .1, .0, 1.), "Invalid name");
         }
         ImGui::Checkbox("Is star", &m_gui.spawn_menu.is_star);
+
+        ImGui::SeparatorText("Generate scene");
+        ImGui::Combo("Distribution", &m_gui.spawn_menu.scene, scene::SCENE_NAMES, IM_ARRAYSIZE(scene::SCENE_NAMES));
+        ImGui::InputInt("Bodies", &m_gui.spawn_menu.scene_bodies, 100, 10000);
+        m_gui.spawn_menu.scene_bodies = std::clamp(m_gui.spawn_menu.scene_bodies, 1, 1000000);
+        ImGui::InputInt("Seed", &m_gui.spawn_menu.scene_seed);
+        ImGui::Checkbox("Replace the current bodies", &m_gui.spawn_menu.scene_replace);
+        if (ImGui::Button("Generate")) {
+            generate_scene(scene::SCENE_NAMES[m_gui.spawn_menu.scene], m_gui.spawn_menu.scene_bodies,
+                m_gui.spawn_menu.scene_seed, m_gui.spawn_menu.scene_replace);
+        }
+        // every body pulls on every other one
+        if (m_gui.spawn_menu.scene_bodies > 5000)
+            ImGui::TextColored(ImVec4(.8, .6, .0, 1.), "The simulation is O(N^2), expect a slideshow");
+
+        ImGui::SeparatorText("Scene file");
+        m_typing |= ImGui::InputText("File", m_gui.spawn_menu.scene_file, IM_ARRAYSIZE(m_gui.spawn_menu.scene_file));
+        auto& status = m_gui.spawn_menu.scene_file_status;
+        char buffer[128];
+        if (ImGui::Button("Save")) {
+            try {
+                save_scene(m_gui.spawn_menu.scene_file);
+                std::snprintf(buffer, sizeof(buffer), "Saved %zu bodies", m_bodies.size());
+                status = buffer;
+            } catch (const std::runtime_error& e) {
+                status = e.what();
+            }
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Load")) {
+            try {
+                auto start = profiler::now();
+                load_scene(m_gui.spawn_menu.scene_file, m_gui.spawn_menu.scene_replace);
+                std::snprintf(buffer, sizeof(buffer), "Loaded in %.1f ms", (profiler::now() - start) / 1e6);
+                status = buffer;
+            } catch (const std::runtime_error& e) {
+                status = e.what();
+            }
+        }
+        if (!status.empty())
+            ImGui::TextWrapped("%s", status.c_str());
         ImGui::End();
     }
     void Game::draw_help_menu_gui()
@@ -883,19 +1455,207 @@ namespace gm{
         m_imgui_window_rects.push(get_current_imgui_window_rect());
         if (ImGui::Checkbox("Do face culling", &m_gui.debug_menu.do_face_culling)) {
             if (m_gui.debug_menu.do_face_culling) {
-                glEnable(GL_CULL_FACE);
+                gl_state::enable(GL_CULL_FACE);
             } else {
-                glDisable(GL_CULL_FACE);
+                gl_state::disable(GL_CULL_FACE);
             }
         }
         if (ImGui::Checkbox("Do wireframe", &m_gui.debug_menu.draw_wireframe)) {
             if (m_gui.debug_menu.draw_wireframe) {
-                glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+                gl_state::polygon_mode(GL_LINE);
             } else {
-                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                gl_state::polygon_mode(GL_FILL);
             }
         }
         if (ImGui::Checkbox("Draw normals", &m_gui.debug_menu.draw_normals)) { }
+        if (ImGui::CollapsingHeader("Shadow caster culling")) {
+            for (auto& body : m_bodies) {
+                auto star = dynamic_cast<obj::Star*>(body.get());
+                if (!star)
+                    continue;
+                auto& stats = star->get_shadow_cull_stats();
+                // a submitted caster costs one draw per face it ends up in
+                auto face_draws_total = stats.casters * 6;
+                auto face_draws = stats.submitted * 6 - stats.faces_culled;
+                ImGui::Text("%s: %u/%u casters submitted, %u/%u face draws saved",
+                    star->get_name().c_str(),
+                    stats.submitted, stats.casters,
+                    face_draws_total - face_draws, face_draws_total);
+            }
+        }
+        if (ImGui::CollapsingHeader("Frustum culling")) {
+            ImGui::Text("Bodies visible: %zu/%zu", m_visible_bodies.size() + m_impostor_planets.size() + m_impostor_stars.size(), m_bodies.size());
+            ImGui::Text("Trails visible: %zu/%zu", m_visible_trails.size(), m_bodies.size());
+            ImGui::Text("Labels visible: %zu/%zu", m_visible_labels.size(), m_bodies.size());
+        }
+        if (ImGui::CollapsingHeader("Level of detail")) {
+            uint32_t triangles = 0;
+            for (uint32_t lod = 0; lod < obj::UnitSphereVAO::LOD_LEVELS; lod++) {
+                ImGui::Text("LOD %u (%u tris): %u bodies", lod, obj::UnitSphereVAO::triangle_count(lod), m_lod_counts[lod]);
+                triangles += m_lod_counts[lod] * obj::UnitSphereVAO::triangle_count(lod);
+            }
+            ImGui::Text("Impostors: %zu planets, %zu stars", m_impostor_planets.size(), m_impostor_stars.size());
+            ImGui::Text("Camera pass triangles: %u", triangles);
+        }
+        if (ImGui::CollapsingHeader("Light clusters")) {
+            auto& stats = m_light_clusters.get_stats();
+            ImGui::Text("Grid: %ux%ux%u", LightClusters::CLUSTERS_X, LightClusters::CLUSTERS_Y, LightClusters::CLUSTERS_Z);
+            ImGui::Text("Lights binned: %u/%zu", stats.lights_binned, m_light_data.size());
+            ImGui::Text("Light references: %u", stats.light_references);
+            ImGui::Text("Max lights per cluster: %u", stats.max_lights_per_cluster);
+            ImGui::Text("Shadow map layers: %u", m_shadow_maps.get_capacity());
+        }
+        if (ImGui::CollapsingHeader("Render graph")) {
+            auto& stats = m_render_graph.get_stats();
+            ImGui::Text("Passes: %u (%u culled)", stats.passes, stats.culled_passes);
+            ImGui::Text("Framebuffer switches: %u", stats.framebuffer_switches);
+            ImGui::Text("Transient textures: %u, framebuffers: %u", stats.transient_textures, stats.framebuffers);
+            auto& schedule = m_render_graph.get_schedule();
+            auto& draws = m_render_graph.get_pass_draw_calls();
+            for (size_t i = 0; i < schedule.size(); i++)
+                ImGui::BulletText("%s: %u draws", m_render_graph.get_pass(schedule[i]).name.c_str(), i < draws.size() ? draws[i] : 0);
+        }
+        if (ImGui::CollapsingHeader("Frame times")) {
+            int window = m_frame_times.get_window();
+            if (ImGui::SliderInt("Window (frames)", &window, 60, 10000, "%d", ImGuiSliderFlags_Logarithmic))
+                m_frame_times.set_window(std::max(window, 1));
+            auto summary = m_frame_times.summary();
+            ImGui::Text("%u frames, mean %.2f ms", summary.frames, summary.mean_ms);
+            ImGui::Text("p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms", summary.p50_ms, summary.p95_ms, summary.p99_ms, summary.max_ms);
+            auto& samples = m_frame_times.get_samples();
+            if (!samples.empty()) {
+                ImGui::PlotLines("Frames", samples.data(), samples.size(), m_frame_times.get_samples_offset(),
+                    nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+                // only the occupied range of the buckets, each bar is one bucket, so the x axis is logarithmic
+                uint32_t first = FrameTimes::bucket_for(*std::min_element(samples.begin(), samples.end()));
+                uint32_t last = FrameTimes::bucket_for(summary.max_ms);
+                std::vector<float> counts{};
+                for (uint32_t bucket = first; bucket <= last; bucket++)
+                    counts.push_back(m_frame_times.get_count(bucket));
+                char overlay[64];
+                std::snprintf(overlay, sizeof(overlay), "%.2f - %.2f ms", FrameTimes::bucket_upper_ms(first), FrameTimes::bucket_upper_ms(last));
+                ImGui::PlotHistogram("Histogram", counts.data(), counts.size(), 0, overlay, 0.0f, FLT_MAX, ImVec2(0, 60));
+            }
+            ImGui::Text("CSV: %s", m_frame_times_csv.is_open() ? "streaming" : "off (--frame-csv PATH)");
+        }
+        if (ImGui::CollapsingHeader("Conservation")) {
+            auto& monitor = m_drift_monitor;
+            auto& last = monitor.get_last_invariants();
+            ImGui::TextWrapped("Drift since the bodies last changed. The game's kernel adds forces straight to the velocities, so these are the "
+                "invariants of bodies with unit inertia in a potential scaled by 1 / dt, not the Newtonian ones. They only hold while dt stays the same.");
+            ImGui::Text("%u steps, E = %.4g (K %.4g, W %.4g)", monitor.get_samples(), last.energy(), last.kinetic, last.potential);
+            if (ImGui::Button("Reset baseline"))
+                monitor.reset();
+            for (uint32_t series = 0; series < gravity::DriftMonitor::__end; series++) {
+                auto s = static_cast<gravity::DriftMonitor::Series>(series);
+                char overlay[32];
+                std::snprintf(overlay, sizeof(overlay), "%.3e", monitor.get_last(s));
+                ImGui::PlotLines(gravity::DriftMonitor::SERIES_NAMES[series], monitor.get_history(s), gravity::DriftMonitor::HISTORY_SIZE,
+                    monitor.get_history_offset(), overlay, FLT_MAX, FLT_MAX, ImVec2(0, 40));
+            }
+        }
+        if (ImGui::CollapsingHeader("GPU timings")) {
+            if (!GpuTimer::is_supported())
+                ImGui::TextDisabled("The driver has no timestamp queries");
+            auto plot = [](const char* label, const GpuTimer& timer) {
+                if (!timer.has_result()) {
+                    ImGui::TextDisabled("%s: not measured", label);
+                    return;
+                }
+                char overlay[32];
+                std::snprintf(overlay, sizeof(overlay), "%.3f ms", timer.get_average_ms());
+                // scale from 0 so bars of different passes can be compared by eye
+                ImGui::PlotLines(label, timer.get_history(), GpuTimer::HISTORY_SIZE, timer.get_history_offset(),
+                    overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+            };
+            for (auto& [name, timer] : m_render_graph.get_pass_timers())
+                plot(name.c_str(), timer);
+            for (auto& body : m_bodies) {
+                if (auto star = dynamic_cast<obj::Star*>(body.get()); star && star->get_shadow_layer() >= 0)
+                    plot(("shadows " + star->get_name()).c_str(), star->get_shadow_timer());
+            }
+        }
+        if (ImGui::CollapsingHeader("GL state")) {
+            auto& stats = gl_state::get_last_frame_stats();
+            ImGui::Text("State calls: %u (%u redundant skipped)", stats.calls, stats.skipped);
+            ImGui::Text("Program binds: %u", stats.program_binds);
+            ImGui::Text("Framebuffer switches: %u", stats.framebuffer_binds);
+            ImGui::Text("Draw calls: %u", stats.draw_calls);
+        }
+        if (ImGui::CollapsingHeader("CPU profiler")) {
+            bool enabled = profiler::is_enabled();
+            if (ImGui::Checkbox("Record zones", &enabled))
+                profiler::set_enabled(enabled);
+            ImGui::SameLine();
+            if (!profiler::is_capturing()) {
+                if (ImGui::Button("Start trace capture"))
+                    profiler::start_capture();
+            } else if (ImGui::Button("Save trace")) {
+                profiler::stop_capture(PROFILER_TRACE_PATH);
+            }
+            ImGui::Text("Frame: %.3f ms, dropped zones: %llu",
+                (profiler::get_last_frame_end() - profiler::get_last_frame_start()) / 1e6,
+                (unsigned long long)profiler::get_dropped());
+            draw_profiler_flame_view();
+        }
+        if (ImGui::CollapsingHeader("Allocations")) {
+            if (!alloc::is_enabled()) {
+                ImGui::TextDisabled("Build with -DISLANDS_ALLOC_TRACKING=ON to count heap allocations");
+            } else {
+                auto frame = alloc::get_last_frame();
+                ImGui::Text("Last frame: %llu allocations, %llu bytes, %llu frees", (unsigned long long)frame.allocations,
+                    (unsigned long long)frame.bytes, (unsigned long long)frame.frees);
+                // zones include their children, so the numbers don't add up to the frame
+                std::vector<std::pair<std::string, profiler::ZoneEvent>> zones{};
+                for (auto& zone : profiler::get_last_frame()) {
+                    if (!zone.allocations)
+                        continue;
+                    auto it = std::find_if(zones.begin(), zones.end(), [&](auto& z) { return z.first == zone.name; });
+                    if (it == zones.end()) {
+                        zones.emplace_back(zone.name, zone);
+                    } else {
+                        it->second.allocations += zone.allocations;
+                        it->second.bytes += zone.bytes;
+                    }
+                }
+                std::sort(zones.begin(), zones.end(), [](auto& a, auto& b) { return a.second.allocations > b.second.allocations; });
+                for (auto& [name, zone] : zones)
+                    ImGui::BulletText("%s: %u allocations, %llu bytes", name.c_str(), zone.allocations, (unsigned long long)zone.bytes);
+
+                bool capture = alloc::is_capturing_call_sites();
+                if (ImGui::Checkbox("Record call sites", &capture))
+                    alloc::set_capture_call_sites(capture);
+                ImGui::SameLine();
+                if (ImGui::Button("Refresh"))
+                    m_alloc_call_sites = alloc::get_top_call_sites(ALLOC_CALL_SITES_SHOWN);
+                ImGui::SameLine();
+                if (ImGui::Button("Reset")) {
+                    alloc::reset_call_sites();
+                    m_alloc_call_sites.clear();
+                }
+                if (auto untracked = alloc::get_untracked_allocations())
+                    ImGui::Text("%llu allocations didn't fit into the call site table", (unsigned long long)untracked);
+                for (size_t i = 0; i < m_alloc_call_sites.size(); i++) {
+                    auto& site = m_alloc_call_sites[i];
+                    // the innermost frames are allocator plumbing, label it with the first one outside the standard library
+                    auto caller = std::find_if(site.frames.begin(), site.frames.end(), [](const std::string& frame) {
+                        return frame.rfind("std::", 0) != 0 && frame.rfind("__gnu_cxx::", 0) != 0 && frame.rfind("operator new", 0) != 0;
+                    });
+                    ImGui::PushID(i);
+                    if (ImGui::TreeNode("", "%llu allocations, %llu bytes: %s", (unsigned long long)site.allocations,
+                        (unsigned long long)site.bytes, caller == site.frames.end() ? "?" : caller->c_str())) {
+                        for (auto& frame : site.frames)
+                            ImGui::TextUnformatted(frame.c_str());
+                        ImGui::TreePop();
+                    }
+                    ImGui::PopID();
+                }
+            }
+        }
+        if (ImGui::CollapsingHeader("Text batch")) {
+            ImGui::Text("Glyphs: %zu", m_text_batch.get_last_glyph_count());
+            ImGui::Text("Draw calls: %u", m_text_batch.get_last_draw_calls());
+        }
         ImGui::End();
     }
 #endif
@@ -1030,9 +1790,10 @@ namespace gm{
         }
         ImGui::EndListBox();
         if (ImGui::Button("DELETE ALL")) {
-            m_bodies.clear();
+            remove_all_bodies();
             collect_light_sources();
             buffer_light_data();
+            on_bodies_changed();
         }
 
         ImGui::End();
@@ -1042,6 +1803,110 @@ namespace gm{
         auto planet = std::make_shared<obj::Planet>(std::move(new_planet));
         m_bodies.push_back(planet);
         collect_light_sources();
+        on_bodies_changed();
+    }
+    void Game::add_bodies(const std::vector<gravity::Gravdata>& bodies, const std::string& name_prefix)
+    {
+        m_bodies.reserve(m_bodies.size() + bodies.size());
+        for (size_t i = 0; i < bodies.size(); i++) {
+            auto& body = bodies[i];
+            auto name = name_prefix + std::to_string(i);
+            if (body.is_star) {
+                auto star = std::make_shared<obj::Star>(nullptr, body.pos, body.vel, glm::vec3(0), body.mass);
+                star->set_color(GENERATED_STAR_COLOR);
+                star->set_name(std::move(name));
+                m_bodies.push_back(std::move(star));
+                m_ssbos.light_sources.size++;
+            } else {
+                auto planet = std::make_shared<obj::Planet>(nullptr, body.pos, body.vel, glm::vec3(0), body.mass);
+                planet->set_color(GENERATED_PLANET_COLOR);
+                planet->set_name(std::move(name));
+                m_bodies.push_back(std::move(planet));
+            }
+        }
+        collect_light_sources();
+        on_bodies_changed();
+    }
+    void Game::generate_scene(const std::string& name, size_t bodies, uint32_t seed, bool replace)
+    {
+        auto generated = scene::generate(name, bodies, seed);
+        if (replace)
+            remove_all_bodies();
+        auto prefix = name;
+        std::transform(prefix.begin(), prefix.end(), prefix.begin(), [](unsigned char c) { return std::toupper(c); });
+        add_bodies(generated, prefix);
+    }
+    void Game::save_scene(const std::filesystem::path& path)
+    {
+        scene::save(path, capture_scene());
+    }
+    scene::SceneData Game::capture_scene() const
+    {
+        PROFILE_ZONE("capture scene");
+        std::unordered_map<const obj::Texture*, std::string> texture_paths{};
+        for (auto& [texture_file, loaded] : m_loaded_textures)
+            texture_paths.emplace(loaded.get(), texture_file.generic_string());
+        scene::SceneData scene{ .step = m_step, .time = m_sim_time };
+        scene.bodies.reserve(m_bodies.size());
+        for (auto& body : m_bodies) {
+            scene.bodies.push_back(gravity::Gravdata {
+                .mass = body->get_mass(),
+                .pos = body->get_pos(),
+                .vel = body->get_speed(),
+                .radius = body->get_radius(),
+                .is_star = dynamic_cast<obj::Star*>(body.get()) != nullptr,
+            });
+            scene.colors.push_back(body->get_color());
+            scene.names.push_back(body->get_name());
+            auto texture = texture_paths.find(body->get_texture().get());
+            scene.textures.push_back(texture != texture_paths.end() ? texture->second : std::string{});
+        }
+        return scene;
+    }
+    void Game::load_scene(const std::filesystem::path& path, bool replace)
+    {
+        // the bodies are built straight from the mapped columns, nothing gets parsed or copied first
+        scene::MappedScene mapped(path);
+        if (replace) {
+            remove_all_bodies();
+            // a checkpoint resumes where it was written, the next checkpoints and recorded steps count on from there
+            m_step = mapped.get_step();
+            m_sim_time = mapped.get_time();
+        }
+        auto pos = mapped.positions();
+        auto vel = mapped.velocities();
+        auto mass = mapped.masses();
+        auto color = mapped.colors();
+        auto flags = mapped.flags();
+        m_bodies.reserve(m_bodies.size() + mapped.size());
+        for (size_t i = 0; i < mapped.size(); i++) {
+            std::shared_ptr<obj::CelestialBody> body{};
+            if (flags[i] & scene::FLAG_STAR) {
+                body = std::make_shared<obj::Star>(nullptr, pos[i], vel[i], glm::vec3(0), mass[i]);
+                m_ssbos.light_sources.size++;
+            } else {
+                body = std::make_shared<obj::Planet>(nullptr, pos[i], vel[i], glm::vec3(0), mass[i]);
+            }
+            body->set_color(color[i]);
+            if (auto name = mapped.name(i); !name.empty())
+                body->set_name(std::string(name));
+            if (auto texture = mapped.texture(i); !texture.empty())
+                body->set_texture(find_texture(std::string(texture)));
+            m_bodies.push_back(std::move(body));
+        }
+        collect_light_sources();
+        on_bodies_changed();
+    }
+    void Game::on_bodies_changed()
+    {
+        m_drift_monitor.reset();
+        m_body_layout++;
+    }
+    void Game::remove_all_bodies()
+    {
+        m_gui.selected_body.reset();
+        m_bodies.clear();
+        m_ssbos.light_sources.size = 0;
     }
     void Game::remove_planet(obj::Planet* planet)
     {
@@ -1051,6 +1916,7 @@ namespace gm{
         if (f != m_bodies.end()) {
             m_bodies.erase(f);
             collect_light_sources();
+            on_bodies_changed();
         }
     }
     void Game::add_star(obj::Star&& new_star)
@@ -1059,6 +1925,7 @@ namespace gm{
         m_bodies.emplace_back(std::move(star));
         m_ssbos.light_sources.size++;
         collect_light_sources();
+        on_bodies_changed();
     }
     void Game::remove_star(obj::Star* star)
     {
@@ -1069,6 +1936,7 @@ namespace gm{
             m_bodies.erase(f);
             m_ssbos.light_sources.size--;
             collect_light_sources();
+            on_bodies_changed();
         }
     }
     void Game::key_handler(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -1096,14 +1964,13 @@ namespace gm{
     void Game::framebuffer_size_handler(GLFWwindow* window, int width, int height)
     {
         (void)window;
-        glViewport(0, 0, width, height);
+        gl_state::viewport(0, 0, width, height);
         m_width = width;
         m_height = height;
-        m_gbuffer = Gbuffer(width, height);
         m_ubos.matrices.text_projection = glm::ortho(0.0f, static_cast<float>(m_width), static_cast<float>(m_height), 0.0f, 0.0f, 100.0f);
 
         m_ubos.matrices.projection = glm::perspective(glm::radians(m_fov),
-            (float)m_width / (float)m_height, 0.1f, PROJECTION_FAR_PLANE);
+            (float)m_width / (float)m_height, PROJECTION_NEAR_PLANE, PROJECTION_FAR_PLANE);
 
         glBindBuffer(GL_UNIFORM_BUFFER, m_ubos.matrices.id);
         // projection
@@ -1115,7 +1982,7 @@ namespace gm{
             2 * sizeof(MatricesUBO::view), sizeof(MatricesUBO::text_projection), glm::value_ptr(m_ubos.matrices.text_projection));
         glBindBuffer(GL_UNIFORM_BUFFER, 0);
         m_gui.paused.set_pos({ 0, m_height - m_gui.paused.get_text_height() });
-        m_gui.fps_count.set_pos({ m_width - m_gui.game_version.get_text_width(), m_gui.game_version.get_text_height() });
+        m_gui.fps_count.set_pos({ m_width - m_gui.fps_count.get_text_width(), m_gui.game_version.get_text_height() });
         m_gui.game_version.set_pos({ m_width - m_gui.game_version.get_text_width(), m_height - m_gui.game_version.get_text_height() });
     }
     void Game::mouse_handler(GLFWwindow* window, double xpos, double ypos)
@@ -1258,6 +2125,15 @@ namespace gm{
             }
         }
     }
+    std::shared_ptr<obj::Texture> Game::find_texture(const std::string& path){
+        for (auto& [texture_file, texture] : m_loaded_textures)
+            if (texture_file.generic_string() == path)
+                return texture;
+        if (!std::filesystem::is_regular_file(path))
+            return nullptr;
+        load_texture_from_path(path);
+        return m_loaded_textures[path];
+    }
     void Game::load_texture_from_path(const std::filesystem::path& path){
         auto path_as_string = path.generic_string();
         auto texture = obj::Texture(path_as_string);
@@ -1281,11 +2157,11 @@ namespace gm{
         }
         // collect bodies into gravdata and schedule the simulation
         if (status == gui::TrailCompStatus::Idle) {
-            auto gravdata = std::vector<Gravdata>(m_bodies.size());
+            auto gravdata = std::vector<gravity::Gravdata>(m_bodies.size());
             auto selected = m_gui.selected_body.lock().get();
             size_t selected_idx {};
             for (size_t i = 0; i < m_bodies.size(); i++) {
-                gravdata[i] = Gravdata {
+                gravdata[i] = gravity::Gravdata {
                     .mass = m_bodies[i]->get_mass(),
                     .pos = m_bodies[i]->get_pos(),
                     .vel = m_bodies[i]->get_speed(),
@@ -1297,10 +2173,13 @@ namespace gm{
             }
 
             auto mean_delta_t = std::accumulate(m_delta_t_record.begin(), m_delta_t_record.end(), 0.0) / m_delta_t_record.size();
+            // before the thread starts, so the destructor can't miss it and leave it running on a dead game
+            m_gui.selected_body_menu.trajectory_status.store(gui::TrailCompStatus::Running);
 
-            std::thread([this](std::vector<Gravdata> gd, size_t s_idx, double mean_dt, bool do_collision) {
+            std::thread([this](std::vector<gravity::Gravdata> gd, size_t s_idx, double mean_dt, bool do_collision) {
+                profiler::set_thread_name("trajectory");
+                PROFILE_ZONE("trajectory prediction");
                 auto& cancel = m_gui.selected_body_menu.calc_cancellation;
-                m_gui.selected_body_menu.trajectory_status.store(gui::TrailCompStatus::Running);
                 auto clock = std::chrono::steady_clock {};
                 auto dt = mean_dt;
                 auto last_frame_t = clock.now();
@@ -1312,7 +2191,7 @@ namespace gm{
                     std::chrono::duration<double> delta_t = current_frame_t - last_frame_t;
                     m_last_frame_t = m_current_frame_t;
                     for (auto i = 0; i < 2 && !cancel.is_cancelled(); i++) {
-                        gravity_step(gravd, dt, do_collision, cancel);
+                        gravity::step_pairwise(gravd, dt, do_collision, [&]() { return cancel.is_cancelled(); });
                     }
                     res[i] = gravd[s_idx].pos;
                 }
@@ -13,6 +13,7 @@
 #include <glm/gtc/type_ptr.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
+#include <thread>
 namespace gm {
 
     Game::Game()
@@ -26,9 +27,28 @@ namespace gm {
         initialize_key_bindings();
         m_gui.help_menu.help_text = m_keybinds.gen_help_text();
     }
+    Game::Game(const HeadlessOptions& options)
+        : m_headless_options { options }
+        , m_width { 0 }
+        , m_height { 0 }
+        , m_fov { 70 }
+        , m_camera { Camera(glm::vec3(0, 0, 3), glm::vec3(0)) }
+        , m_ubos {}
+    {
+        initialize_headless();
+    }
     Game::~Game()
     {
-        m_gbuffer = Gbuffer();
+        // the trajectory thread is detached and works on this game, it notices within one row of its step
+        m_gui.selected_body_menu.calc_cancellation.cancel();
+        while (m_gui.selected_body_menu.trajectory_status.load() == gui::TrailCompStatus::Running)
+            std::this_thread::yield();
+        m_render_graph = RenderGraph();
+        m_shadow_maps = ShadowMapArray();
+        m_light_clusters = LightClusters();
+        for (auto& timer : m_light_pass_timers)
+            timer = GpuTimer();
+        m_text_batch = font::TextBatch();
         m_skybox = nullptr;
         m_bodies.clear();
         m_loaded_textures.clear();
@@ -38,6 +58,10 @@ namespace gm {
         glDeleteBuffers(1, &m_ubos.matrices.id);
         glDeleteBuffers(1, &m_ubos.lighting_globals.id);
         glDeleteBuffers(1, &m_ssbos.light_sources.id);
+        if (m_headless) {
+            m_offscreen = OffscreenTarget();
+            return;
+        }
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
@@ -0,0 +1,152 @@
+#include "GlState.hpp"
+#include <unordered_map>
+
+namespace gm::gl_state {
+    namespace {
+        constexpr uint32_t UNKNOWN = UINT32_MAX;
+        struct Cache {
+            std::unordered_map<GLenum, bool> capabilities{};
+            std::unordered_map<GLenum, int32_t> pixel_store{};
+            GLenum blend_src{}, blend_dst{};
+            bool blend_known{};
+            GLenum cull_face{};
+            GLenum depth_func{};
+            GLenum polygon_mode{};
+            uint32_t program{ UNKNOWN };
+            uint32_t read_fbo{ UNKNOWN }, draw_fbo{ UNKNOWN };
+            int32_t viewport[4]{};
+            bool viewport_known{};
+        };
+        Cache CACHE{};
+        Stats STATS{}, LAST_STATS{};
+
+        // returns true if the call has to be issued
+        inline bool changed(bool differs){
+            if (differs)
+                STATS.calls++;
+            else
+                STATS.skipped++;
+            return differs;
+        }
+    }
+
+    void enable(GLenum cap){
+        set_enabled(cap, true);
+    }
+    void disable(GLenum cap){
+        set_enabled(cap, false);
+    }
+    void set_enabled(GLenum cap, bool enabled){
+        auto it = CACHE.capabilities.find(cap);
+        if (!changed(it == CACHE.capabilities.end() || it->second != enabled))
+            return;
+        CACHE.capabilities[cap] = enabled;
+        if (enabled)
+            glEnable(cap);
+        else
+            glDisable(cap);
+    }
+    void blend_func(GLenum src, GLenum dst){
+        if (!changed(!CACHE.blend_known || CACHE.blend_src != src || CACHE.blend_dst != dst))
+            return;
+        CACHE.blend_known = true;
+        CACHE.blend_src = src;
+        CACHE.blend_dst = dst;
+        glBlendFunc(src, dst);
+    }
+    void cull_face(GLenum mode){
+        if (!changed(CACHE.cull_face != mode))
+            return;
+        CACHE.cull_face = mode;
+        glCullFace(mode);
+    }
+    void depth_func(GLenum func){
+        if (!changed(CACHE.depth_func != func))
+            return;
+        CACHE.depth_func = func;
+        glDepthFunc(func);
+    }
+    void polygon_mode(GLenum mode){
+        if (!changed(CACHE.polygon_mode != mode))
+            return;
+        CACHE.polygon_mode = mode;
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+    void use_program(uint32_t program){
+        if (!changed(CACHE.program != program))
+            return;
+        CACHE.program = program;
+        STATS.program_binds++;
+        glUseProgram(program);
+    }
+    void bind_framebuffer(GLenum target, uint32_t fbo){
+        bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+        bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+        if (!changed((read && CACHE.read_fbo != fbo) || (draw && CACHE.draw_fbo != fbo)))
+            return;
+        if (read)
+            CACHE.read_fbo = fbo;
+        if (draw)
+            CACHE.draw_fbo = fbo;
+        STATS.framebuffer_binds++;
+        glBindFramebuffer(target, fbo);
+    }
+    void viewport(int32_t x, int32_t y, int32_t width, int32_t height){
+        auto& v = CACHE.viewport;
+        if (!changed(!CACHE.viewport_known || v[0] != x || v[1] != y || v[2] != width || v[3] != height))
+            return;
+        CACHE.viewport_known = true;
+        v[0] = x;
+        v[1] = y;
+        v[2] = width;
+        v[3] = height;
+        glViewport(x, y, width, height);
+    }
+    void pixel_store(GLenum pname, int32_t value){
+        auto it = CACHE.pixel_store.find(pname);
+        if (!changed(it == CACHE.pixel_store.end() || it->second != value))
+            return;
+        CACHE.pixel_store[pname] = value;
+        glPixelStorei(pname, value);
+    }
+    void draw_arrays(GLenum mode, int32_t first, int32_t count){
+        STATS.draw_calls++;
+        glDrawArrays(mode, first, count);
+    }
+    void draw_arrays_instanced(GLenum mode, int32_t first, int32_t count, int32_t instances){
+        STATS.draw_calls++;
+        glDrawArraysInstanced(mode, first, count, instances);
+    }
+    void draw_elements(GLenum mode, int32_t count, GLenum type, const void* offset){
+        STATS.draw_calls++;
+        glDrawElements(mode, count, type, offset);
+    }
+    void draw_elements_instanced(GLenum mode, int32_t count, GLenum type, const void* offset, int32_t instances){
+        STATS.draw_calls++;
+        glDrawElementsInstanced(mode, count, type, offset, instances);
+    }
+    void forget_program(uint32_t program){
+        if (CACHE.program == program)
+            CACHE.program = UNKNOWN;
+    }
+    void forget_framebuffer(uint32_t fbo){
+        // GL falls back to the default framebuffer when the bound one gets deleted
+        if (CACHE.read_fbo == fbo)
+            CACHE.read_fbo = UNKNOWN;
+        if (CACHE.draw_fbo == fbo)
+            CACHE.draw_fbo = UNKNOWN;
+    }
+    void invalidate(){
+        CACHE = Cache{};
+    }
+    void end_frame(){
+        LAST_STATS = STATS;
+        STATS = {};
+    }
+    const Stats& get_last_frame_stats(){
+        return LAST_STATS;
+    }
+    const Stats& get_frame_stats(){
+        return STATS;
+    }
+}
@@ -0,0 +1,132 @@
+#include "GpuTimer.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <glad/glad.h>
+#include <utility>
+
+namespace gm {
+    namespace {
+        // profiler time minus GL time
+        int64_t CLOCK_OFFSET{};
+        int32_t TIMESTAMP_BITS{ -1 };
+    }
+
+    GpuTimer::GpuTimer(){}
+    GpuTimer::GpuTimer(const char* name):
+        m_name(name)
+    {}
+    GpuTimer::GpuTimer(GpuTimer&& other):
+        m_next(other.m_next),
+        m_pending(other.m_pending),
+        m_running(other.m_running),
+        m_last_ms(other.m_last_ms),
+        m_average_ms(other.m_average_ms),
+        m_has_result(other.m_has_result),
+        m_name(other.m_name),
+        m_history_offset(other.m_history_offset)
+    {
+        for (uint32_t i = 0; i < QUERY_COUNT; i++)
+            for (uint32_t j = 0; j < 2; j++)
+                m_queries[i][j] = std::exchange(other.m_queries[i][j], 0);
+        std::copy(std::begin(other.m_history), std::end(other.m_history), std::begin(m_history));
+        other.m_pending = 0;
+        other.m_running = false;
+    }
+    GpuTimer& GpuTimer::operator=(GpuTimer&& other){
+        release();
+        for (uint32_t i = 0; i < QUERY_COUNT; i++)
+            for (uint32_t j = 0; j < 2; j++)
+                m_queries[i][j] = std::exchange(other.m_queries[i][j], 0);
+        m_next = other.m_next;
+        m_pending = std::exchange(other.m_pending, 0);
+        m_running = std::exchange(other.m_running, false);
+        m_last_ms = other.m_last_ms;
+        m_average_ms = other.m_average_ms;
+        m_has_result = other.m_has_result;
+        m_name = other.m_name;
+        std::copy(std::begin(other.m_history), std::end(other.m_history), std::begin(m_history));
+        m_history_offset = other.m_history_offset;
+        return *this;
+    }
+    GpuTimer::~GpuTimer(){
+        release();
+    }
+    void GpuTimer::release(){
+        if (m_queries[0][0])
+            glDeleteQueries(QUERY_COUNT * 2, &m_queries[0][0]);
+        for (auto& q : m_queries)
+            q[0] = q[1] = 0;
+        m_pending = 0;
+        m_running = false;
+    }
+    bool GpuTimer::is_supported(){
+        // software drivers are allowed to report a zero bit counter
+        if (TIMESTAMP_BITS < 0)
+            glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &TIMESTAMP_BITS);
+        return TIMESTAMP_BITS > 0;
+    }
+    void GpuTimer::sync_clock(){
+        if (!is_supported())
+            return;
+        int64_t gl_now = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gl_now);
+        CLOCK_OFFSET = (int64_t)profiler::now() - gl_now;
+    }
+    void GpuTimer::collect(){
+        while (m_pending > 0) {
+            auto& queries = m_queries[(m_next + QUERY_COUNT - m_pending) % QUERY_COUNT];
+            int32_t available = 0;
+            // the end timestamp lands last
+            glGetQueryObjectiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            uint64_t start = 0, end = 0;
+            glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+            m_last_ms = (end - start) / 1e6f;
+            m_average_ms = m_has_result ? m_average_ms * 0.9f + m_last_ms * 0.1f : m_last_ms;
+            m_has_result = true;
+            m_history[m_history_offset] = m_last_ms;
+            m_history_offset = (m_history_offset + 1) % HISTORY_SIZE;
+            if (m_name && profiler::is_capturing()) {
+                profiler::add_gpu_zone(m_name,
+                    (uint64_t)std::max<int64_t>((int64_t)start + CLOCK_OFFSET, 0),
+                    (uint64_t)std::max<int64_t>((int64_t)end + CLOCK_OFFSET, 0));
+            }
+            m_pending--;
+        }
+    }
+    void GpuTimer::begin(){
+        if (!is_supported())
+            return;
+        if (!m_queries[0][0])
+            glGenQueries(QUERY_COUNT * 2, &m_queries[0][0]);
+        collect();
+        m_running = m_pending < QUERY_COUNT;
+        if (m_running)
+            glQueryCounter(m_queries[m_next][0], GL_TIMESTAMP);
+    }
+    void GpuTimer::end(){
+        if (!m_running)
+            return;
+        glQueryCounter(m_queries[m_next][1], GL_TIMESTAMP);
+        m_next = (m_next + 1) % QUERY_COUNT;
+        m_pending++;
+        m_running = false;
+    }
+    bool GpuTimer::has_result() const {
+        return m_has_result;
+    }
+    float GpuTimer::get_last_ms() const {
+        return m_last_ms;
+    }
+    float GpuTimer::get_average_ms() const {
+        return m_average_ms;
+    }
+    const float* GpuTimer::get_history() const {
+        return m_history;
+    }
+    uint32_t GpuTimer::get_history_offset() const {
+        return m_history_offset;
+    }
+}
@@ -0,0 +1,249 @@
+#include "Gravity.hpp"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace gm::gravity {
+
+    WorkerPool::WorkerPool(uint32_t threads){
+        threads = std::max<uint32_t>(threads, 1);
+        // index 0 is the calling thread
+        for (uint32_t i = 1; i < threads; i++)
+            m_workers.emplace_back(&WorkerPool::work, this, i);
+    }
+    WorkerPool::~WorkerPool(){
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_start.notify_all();
+        for (auto& w : m_workers)
+            w.join();
+    }
+    void WorkerPool::work(uint32_t index){
+        uint64_t seen = 0;
+        while (true) {
+            const std::function<void(uint32_t, uint32_t)>* job{};
+            {
+                std::unique_lock lock(m_mutex);
+                m_start.wait(lock, [&]() { return m_stop || m_generation != seen; });
+                if (m_stop)
+                    return;
+                seen = m_generation;
+                job = m_job;
+            }
+            (*job)(index, size());
+            {
+                std::lock_guard lock(m_mutex);
+                m_busy--;
+            }
+            m_done.notify_one();
+        }
+    }
+    uint32_t WorkerPool::size() const {
+        return m_workers.size() + 1;
+    }
+    void WorkerPool::run(const std::function<void(uint32_t, uint32_t)>& job){
+        if (m_workers.empty()) {
+            job(0, 1);
+            return;
+        }
+        {
+            std::lock_guard lock(m_mutex);
+            m_job = &job;
+            m_busy = m_workers.size();
+            m_generation++;
+        }
+        m_start.notify_all();
+        job(0, size());
+        std::unique_lock lock(m_mutex);
+        m_done.wait(lock, [&]() { return m_busy == 0; });
+    }
+    std::pair<size_t, size_t> WorkerPool::split(size_t items, uint32_t index, uint32_t count){
+        return { items * index / count, items * (index + 1) / count };
+    }
+
+    bool step_pairwise(std::vector<Gravdata>& bodies, double delta_t, bool do_collision, const std::function<bool()>& cancelled){
+        for (size_t body = 0; body < bodies.size(); body++) {
+            if (cancelled && cancelled())
+                return false;
+            for (size_t next_body = body + 1; next_body < bodies.size(); next_body++) {
+                auto& b_1 = bodies[body];
+                auto& b_2 = bodies[next_body];
+
+                // a massless body was already eaten and only waits to be removed, it takes no part in collisions
+                if (do_collision && b_1.mass > 0.0f && b_2.mass > 0.0f && glm::distance(b_1.pos, b_2.pos) <= b_1.radius + b_2.radius) {
+                    auto [eater, eaten] = b_1.mass > b_2.mass ? std::make_tuple(std::ref(b_1), std::ref(b_2)) : std::make_tuple(std::ref(b_2), std::ref(b_1));
+                    if (eaten.is_star) {
+                        std::swap(eater, eaten);
+                    }
+                    eater.mass += eaten.mass;
+                    eaten.mass = 0.0;
+                    eaten.radius = 0.0;
+                    eaten.vel = glm::vec3 { 0.0 };
+                }
+                // https://en.wikipedia.org/wiki/Newton%27s_law_of_universal_gravitation#Vector_form
+                auto m_1 = b_1.mass * MASS_BOOST_FACTOR;
+                auto m_2 = b_2.mass * MASS_BOOST_FACTOR;
+
+                auto r_21 = b_2.pos - b_1.pos;
+                auto r_21_hat = glm::normalize(r_21);
+                auto distance = glm::distance(b_1.pos, b_2.pos);
+                // attraction force
+                auto f_21 = -GRAV_CONST * ((m_1 * m_2) / (distance * distance)) * r_21_hat;
+                auto f_12 = -f_21;
+
+                b_1.acc += f_12;
+                b_2.acc += f_21;
+            }
+        }
+        for (auto& b : bodies) {
+            b.vel += b.acc;
+            b.acc = glm::vec3(0);
+            auto tmp_speed = b.vel;
+            tmp_speed *= delta_t;
+            b.pos += tmp_speed;
+        }
+        return true;
+    }
+    void step_leapfrog(std::vector<Gravdata>& bodies, double delta_t, WorkerPool& pool, float softening){
+        const float dt = delta_t;
+        const float eps2 = softening * softening;
+        const size_t n = bodies.size();
+        pool.run([&](uint32_t index, uint32_t count) {
+            auto [begin, end] = WorkerPool::split(n, index, count);
+            for (size_t i = begin; i < end; i++)
+                bodies[i].pos += bodies[i].vel * (dt * 0.5f);
+        });
+        // every thread only writes the bodies it owns, the positions are read only until the next run
+        pool.run([&](uint32_t index, uint32_t count) {
+            auto [begin, end] = WorkerPool::split(n, index, count);
+            for (size_t i = begin; i < end; i++) {
+                auto pos = bodies[i].pos;
+                auto acc = glm::vec3(0);
+                for (size_t j = 0; j < n; j++) {
+                    auto r = bodies[j].pos - pos;
+                    float d2 = glm::dot(r, r) + eps2;
+                    // the body itself contributes nothing, r is zero
+                    acc += r * (bodies[j].mass / (d2 * std::sqrt(d2)));
+                }
+                bodies[i].acc = acc * SIM_GRAV_CONST;
+            }
+        });
+        pool.run([&](uint32_t index, uint32_t count) {
+            auto [begin, end] = WorkerPool::split(n, index, count);
+            for (size_t i = begin; i < end; i++) {
+                auto& b = bodies[i];
+                b.vel += b.acc * dt;
+                b.pos += b.vel * (dt * 0.5f);
+            }
+        });
+    }
+    double total_energy(const std::vector<Gravdata>& bodies, WorkerPool& pool, float softening){
+        return measure(bodies, pool, softening).energy();
+    }
+
+    double Invariants::energy() const {
+        return kinetic + potential;
+    }
+    double Invariants::virial_ratio() const {
+        return potential != 0.0 ? 2.0 * kinetic / std::abs(potential) : 0.0;
+    }
+    void Invariants::add_body(float mass, glm::vec3 pos, glm::vec3 vel){
+        auto p = glm::dvec3(vel) * (double)mass;
+        auto l = glm::cross(glm::dvec3(pos), p);
+        kinetic += 0.5 * mass * glm::dot(glm::dvec3(vel), glm::dvec3(vel));
+        momentum += p;
+        angular_momentum += l;
+        momentum_norm += glm::length(p);
+        angular_momentum_norm += glm::length(l);
+        bodies++;
+    }
+    namespace {
+        // inertia replaces the mass in the kinetic and momentum terms when it isn't 0, the potential is
+        // multiplied by potential_scale
+        Invariants measure_with(const std::vector<Gravdata>& bodies, WorkerPool& pool, double eps2, float inertia, double potential_scale){
+            const size_t n = bodies.size();
+            std::vector<Invariants> partial(pool.size());
+            pool.run([&](uint32_t index, uint32_t count) {
+                auto [begin, end] = WorkerPool::split(n, index, count);
+                auto& inv = partial[index];
+                for (size_t i = begin; i < end; i++) {
+                    auto& b = bodies[i];
+                    inv.add_body(inertia != 0.0f ? inertia : b.mass, b.pos, b.vel);
+                    // eaten bodies wait to be removed, unsoftened they could sit right on their eater
+                    if (b.mass == 0.0f)
+                        continue;
+                    // every pair is counted from both sides, hence the half
+                    double potential = 0.0;
+                    for (size_t j = 0; j < n; j++) {
+                        if (j == i || bodies[j].mass == 0.0f)
+                            continue;
+                        auto r = glm::dvec3(bodies[j].pos) - glm::dvec3(b.pos);
+                        potential += bodies[j].mass / std::sqrt(glm::dot(r, r) + eps2);
+                    }
+                    inv.potential -= 0.5 * SIM_GRAV_CONST * potential_scale * b.mass * potential;
+                }
+            });
+            Invariants total{};
+            for (auto& inv : partial) {
+                total.kinetic += inv.kinetic;
+                total.potential += inv.potential;
+                total.momentum += inv.momentum;
+                total.angular_momentum += inv.angular_momentum;
+                total.momentum_norm += inv.momentum_norm;
+                total.angular_momentum_norm += inv.angular_momentum_norm;
+                total.bodies += inv.bodies;
+            }
+            return total;
+        }
+    }
+    Invariants measure(const std::vector<Gravdata>& bodies, WorkerPool& pool, float softening){
+        return measure_with(bodies, pool, (double)softening * softening, 0.0f, 1.0);
+    }
+    Invariants measure_pairwise(const std::vector<Gravdata>& bodies, WorkerPool& pool, double delta_t){
+        return measure_with(bodies, pool, 0.0, 1.0f, 1.0 / delta_t);
+    }
+
+    void DriftMonitor::reset(){
+        m_baseline.reset();
+        m_samples = 0;
+    }
+    void DriftMonitor::add(const Invariants& sample){
+        if (!m_baseline)
+            m_baseline = sample;
+        auto& base = *m_baseline;
+        // the larger of then and now, a scene that starts at rest has no momentum scale at the baseline.
+        // Only when both are 0 there is nothing to compare against, the drift is absolute then
+        auto relative = [](double value, double scale_then, double scale_now) {
+            auto scale = std::max(std::abs(scale_then), std::abs(scale_now));
+            return (float)(scale != 0.0 ? value / scale : value);
+        };
+        m_history[Energy][m_history_offset] = relative(sample.energy() - base.energy(), base.energy(), 0.0);
+        m_history[Momentum][m_history_offset] = relative(glm::length(sample.momentum - base.momentum),
+            base.momentum_norm, sample.momentum_norm);
+        m_history[AngularMomentum][m_history_offset] = relative(glm::length(sample.angular_momentum - base.angular_momentum),
+            base.angular_momentum_norm, sample.angular_momentum_norm);
+        m_history[VirialRatio][m_history_offset] = (float)sample.virial_ratio();
+        m_history_offset = (m_history_offset + 1) % HISTORY_SIZE;
+        m_last = sample;
+        m_samples++;
+    }
+    float DriftMonitor::get_last(Series series) const {
+        if (m_samples == 0)
+            return 0.0f;
+        return m_history[series][(m_history_offset + HISTORY_SIZE - 1) % HISTORY_SIZE];
+    }
+    const Invariants& DriftMonitor::get_last_invariants() const {
+        return m_last;
+    }
+    const float* DriftMonitor::get_history(Series series) const {
+        return m_history[series];
+    }
+    uint32_t DriftMonitor::get_history_offset() const {
+        return m_history_offset;
+    }
+    uint32_t DriftMonitor::get_samples() const {
+        return m_samples;
+    }
+}
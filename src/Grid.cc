@@ -1,4 +1,5 @@
 #include "Grid.hpp"
+#include "GlState.hpp"
 #include "shader/Shader.hpp"
 #include <utility>
 #include <vector>
@@ -190,6 +191,6 @@ void Grid::forward_render(glm::vec3 camera_pos) {
     m_shader->set_mat4("model", model);
     m_shader->set_vec4("color", m_color);
     ::glBindVertexArray(m_vao);
-    ::glDrawElementsInstanced(GL_LINES, m_i_count, GL_UNSIGNED_INT, NULL, m_instance_count);
+    gm::gl_state::draw_elements_instanced(GL_LINES, m_i_count, GL_UNSIGNED_INT, NULL, m_instance_count);
     ::glBindVertexArray(0);
 }
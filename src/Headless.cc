@@ -0,0 +1,272 @@
+#include "Headless.hpp"
+#include "GlState.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <glad/glad.h>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#ifdef ISLANDS_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace gm {
+
+    HeadlessScript HeadlessScript::load(const std::filesystem::path& path){
+        auto in = std::ifstream(path);
+        if (!in)
+            throw std::runtime_error("Failed to open the headless script " + path.string());
+        HeadlessScript script{};
+        std::string line{};
+        for (size_t line_n = 1; std::getline(in, line); line_n++) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream ss(line);
+            std::string cmd{};
+            if (!(ss >> cmd))
+                continue;
+            if (cmd == "size") {
+                ss >> script.width >> script.height;
+            } else if (cmd == "frames") {
+                ss >> script.frames;
+            } else if (cmd == "warmup") {
+                ss >> script.warmup;
+            } else if (cmd == "delta_t") {
+                ss >> script.delta_t;
+            } else if (cmd == "shadow_quality") {
+                ss >> script.shadow_quality;
+            } else if (cmd == "scene") {
+                ss >> script.scene >> script.scene_bodies >> script.scene_seed;
+            } else if (cmd == "star" || cmd == "planet") {
+                Body b{ .is_star = cmd == "star" };
+                ss >> b.pos.x >> b.pos.y >> b.pos.z >> b.vel.x >> b.vel.y >> b.vel.z >> b.mass;
+                // the color is optional
+                if (!ss.fail() && !(ss >> b.color.r >> b.color.g >> b.color.b)) {
+                    b.color = glm::vec3(0.5f);
+                    ss.clear(std::ios::eofbit);
+                }
+                script.bodies.push_back(b);
+            } else if (cmd == "camera") {
+                CameraKey key{};
+                ss >> key.frame >> key.pos.x >> key.pos.y >> key.pos.z >> key.target.x >> key.target.y >> key.target.z;
+                script.camera.push_back(key);
+            } else {
+                throw std::runtime_error(path.string() + ":" + std::to_string(line_n) + ": unknown command '" + cmd + "'");
+            }
+            if (ss.fail())
+                throw std::runtime_error(path.string() + ":" + std::to_string(line_n) + ": malformed '" + cmd + "' line");
+        }
+        if (script.width <= 0 || script.height <= 0)
+            throw std::runtime_error(path.string() + ": the size has to be positive");
+        std::sort(script.camera.begin(), script.camera.end(), [](const CameraKey& a, const CameraKey& b) {
+            return a.frame < b.frame;
+        });
+        return script;
+    }
+    std::pair<glm::vec3, glm::vec3> HeadlessScript::camera_at(uint32_t frame) const {
+        if (camera.empty())
+            return { glm::vec3(0, 20, 60), glm::vec3(0) };
+        if (frame <= camera.front().frame)
+            return { camera.front().pos, camera.front().target };
+        for (size_t i = 1; i < camera.size(); i++) {
+            auto& a = camera[i - 1];
+            auto& b = camera[i];
+            if (frame > b.frame)
+                continue;
+            float t = b.frame == a.frame ? 1.0f : (float)(frame - a.frame) / (float)(b.frame - a.frame);
+            return { glm::mix(a.pos, b.pos, t), glm::mix(a.target, b.target, t) };
+        }
+        return { camera.back().pos, camera.back().target };
+    }
+
+    HeadlessReport::PassStats& HeadlessReport::pass(const std::string& name){
+        auto it = std::find_if(m_passes.begin(), m_passes.end(), [&](const PassStats& p) { return p.name == name; });
+        if (it != m_passes.end())
+            return *it;
+        return m_passes.emplace_back(PassStats { .name = name });
+    }
+    void HeadlessReport::add_frame(double cpu_ms, const gl_state::Stats& stats, const alloc::Counters& allocs){
+        m_frame_ms.push_back(cpu_ms);
+        m_allocations += allocs.allocations;
+        m_allocated_bytes += allocs.bytes;
+        m_max_frame_allocations = std::max(m_max_frame_allocations, allocs.allocations);
+        m_draw_calls += stats.draw_calls;
+        m_gl_calls += stats.calls;
+        m_skipped_gl_calls += stats.skipped;
+        m_program_binds += stats.program_binds;
+        m_framebuffer_binds += stats.framebuffer_binds;
+    }
+    void HeadlessReport::add_pass(const std::string& name, float cpu_ms, uint32_t draw_calls){
+        auto& p = pass(name);
+        p.cpu_ms += cpu_ms;
+        p.draw_calls += draw_calls;
+        p.frames++;
+    }
+    void HeadlessReport::add_gpu_pass(const std::string& name, double gpu_ms){
+        auto& p = pass(name);
+        p.gpu_ms += gpu_ms;
+        p.gpu_frames++;
+    }
+    void HeadlessReport::write_json(std::ostream& os, const HeadlessScript& script, const std::string& renderer) const {
+        auto sorted = m_frame_ms;
+        std::sort(sorted.begin(), sorted.end());
+        // nearest rank
+        auto percentile = [&](double p) {
+            if (sorted.empty())
+                return 0.0;
+            auto rank = (size_t)std::ceil(p * sorted.size());
+            return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+        };
+        double frames = std::max<size_t>(m_frame_ms.size(), 1);
+        double total_ms = 0.0;
+        for (auto ms : m_frame_ms)
+            total_ms += ms;
+        auto escape = [](const std::string& s) {
+            std::string out{};
+            for (char c : s) {
+                if (c == '"' || c == '\\')
+                    out += '\\';
+                out += c;
+            }
+            return out;
+        };
+        os << "{\n  \"benchmark\": \"islands_headless\",\n"
+           << "  \"renderer\": \"" << escape(renderer) << "\",\n"
+           << "  \"width\": " << script.width << ",\n"
+           << "  \"height\": " << script.height << ",\n"
+           << "  \"frames\": " << m_frame_ms.size() << ",\n"
+           << "  \"warmup\": " << script.warmup << ",\n"
+           << "  \"shadow_quality\": " << script.shadow_quality << ",\n"
+           << "  \"frame_cpu_ms\": {\"mean\": " << total_ms / frames << ", \"p50\": " << percentile(0.5)
+           << ", \"p95\": " << percentile(0.95) << ", \"p99\": " << percentile(0.99)
+           << ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << "},\n"
+           << "  \"per_frame\": {\"draw_calls\": " << m_draw_calls / frames << ", \"gl_calls\": " << m_gl_calls / frames
+           << ", \"skipped_gl_calls\": " << m_skipped_gl_calls / frames << ", \"program_binds\": " << m_program_binds / frames
+           << ", \"framebuffer_binds\": " << m_framebuffer_binds / frames;
+        // null without ISLANDS_ALLOC_TRACKING, 0 would look like a clean run
+        if (alloc::is_enabled()) {
+            os << ", \"allocations\": " << m_allocations / frames << ", \"allocated_bytes\": " << m_allocated_bytes / frames
+               << ", \"max_allocations\": " << m_max_frame_allocations;
+        } else {
+            os << ", \"allocations\": null, \"allocated_bytes\": null, \"max_allocations\": null";
+        }
+        os << "},\n"
+           << "  \"passes\": [";
+        for (size_t i = 0; i < m_passes.size(); i++) {
+            auto& p = m_passes[i];
+            // passes that only have a GPU zone are nested inside another pass, e.g. every star's shadow map
+            os << (i ? ",\n" : "\n") << "    {\"name\": \"" << escape(p.name) << "\", \"frames\": " << p.frames
+               << ", \"cpu_ms\": " << (p.frames ? p.cpu_ms / p.frames : 0.0)
+               << ", \"draw_calls\": " << (p.frames ? (double)p.draw_calls / p.frames : 0.0) << ", \"gpu_ms\": ";
+            if (p.gpu_frames)
+                os << p.gpu_ms / p.gpu_frames << "}";
+            else
+                os << "null}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+#ifdef ISLANDS_HEADLESS
+    HeadlessContext::HeadlessContext(){
+        EGLDisplay display = EGL_NO_DISPLAY;
+        auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (get_platform_display)
+            display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+            throw std::runtime_error("Failed to initialize an EGL display");
+        m_display = display;
+        if (!eglBindAPI(EGL_OPENGL_API))
+            throw std::runtime_error("EGL has no desktop OpenGL");
+
+        // no config needed, nothing ever gets drawn into an EGL surface
+        EGLConfig config = EGL_NO_CONFIG_KHR;
+        std::string extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (extensions.find("EGL_KHR_no_config_context") == std::string::npos) {
+            const EGLint config_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_SURFACE_TYPE, EGL_DONT_CARE, EGL_NONE };
+            EGLint count = 0;
+            if (!eglChooseConfig(display, config_attribs, &config, 1, &count) || count == 0)
+                throw std::runtime_error("No EGL config supports desktop OpenGL");
+        }
+        const EGLint context_attribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 6,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        m_context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+        if (m_context == EGL_NO_CONTEXT)
+            throw std::runtime_error("Failed to create an OpenGL 4.6 core context through EGL");
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+            throw std::runtime_error("Failed to make the EGL context current without a surface");
+    }
+    HeadlessContext::~HeadlessContext(){
+        if (!m_display)
+            return;
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (m_context)
+            eglDestroyContext(m_display, m_context);
+        eglTerminate(m_display);
+    }
+    void HeadlessContext::load_gl() const {
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+            throw std::runtime_error("Failed to initialize GLAD");
+    }
+#else
+    HeadlessContext::HeadlessContext(){
+        throw std::runtime_error("Headless rendering needs a build with ISLANDS_HEADLESS=ON");
+    }
+    HeadlessContext::~HeadlessContext(){}
+    void HeadlessContext::load_gl() const {}
+#endif
+
+    OffscreenTarget::OffscreenTarget(){}
+    OffscreenTarget::OffscreenTarget(int32_t width, int32_t height){
+        glGenRenderbuffers(1, &m_color);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_color);
+        // sRGB like the window's default framebuffer, the game renders with GL_FRAMEBUFFER_SRGB on
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, width, height);
+        glGenRenderbuffers(1, &m_depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &m_fbo);
+        gl_state::bind_framebuffer(GL_FRAMEBUFFER, m_fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            throw std::runtime_error("Failed to complete the offscreen framebuffer");
+    }
+    OffscreenTarget::OffscreenTarget(OffscreenTarget&& other):
+        m_fbo(std::exchange(other.m_fbo, 0)),
+        m_color(std::exchange(other.m_color, 0)),
+        m_depth(std::exchange(other.m_depth, 0))
+    {}
+    OffscreenTarget& OffscreenTarget::operator=(OffscreenTarget&& other){
+        release();
+        m_fbo = std::exchange(other.m_fbo, 0);
+        m_color = std::exchange(other.m_color, 0);
+        m_depth = std::exchange(other.m_depth, 0);
+        return *this;
+    }
+    OffscreenTarget::~OffscreenTarget(){
+        release();
+    }
+    void OffscreenTarget::release(){
+        if (m_fbo) {
+            gl_state::forget_framebuffer(m_fbo);
+            glDeleteFramebuffers(1, &m_fbo);
+        }
+        if (m_color)
+            glDeleteRenderbuffers(1, &m_color);
+        if (m_depth)
+            glDeleteRenderbuffers(1, &m_depth);
+        m_fbo = m_color = m_depth = 0;
+    }
+    uint32_t OffscreenTarget::get_framebuffer() const {
+        return m_fbo;
+    }
+}
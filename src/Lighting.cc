@@ -0,0 +1,255 @@
+#include "Lighting.hpp"
+#include "GlState.hpp"
+#include "Object.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glad/glad.h>
+#include <stdexcept>
+#include <utility>
+
+namespace gm {
+
+    ShadowMapArray::ShadowMapArray(){}
+    ShadowMapArray::ShadowMapArray(ShadowMapArray&& other):
+        m_texture(other.m_texture),
+        m_fbo(other.m_fbo),
+        m_capacity(other.m_capacity),
+        m_width(other.m_width),
+        m_height(other.m_height)
+    {
+        other.m_texture = 0;
+        other.m_fbo = 0;
+        other.m_capacity = 0;
+    }
+    ShadowMapArray& ShadowMapArray::operator=(ShadowMapArray&& other){
+        release();
+        m_texture = std::exchange(other.m_texture, 0);
+        m_fbo = std::exchange(other.m_fbo, 0);
+        m_capacity = std::exchange(other.m_capacity, 0);
+        m_width = other.m_width;
+        m_height = other.m_height;
+        return *this;
+    }
+    ShadowMapArray::~ShadowMapArray(){
+        release();
+    }
+    void ShadowMapArray::release(){
+        if(m_fbo){
+            gl_state::forget_framebuffer(m_fbo);
+            glDeleteFramebuffers(1, &m_fbo);
+        }
+        if(m_texture)
+            glDeleteTextures(1, &m_texture);
+        m_fbo = 0;
+        m_texture = 0;
+        m_capacity = 0;
+    }
+    void ShadowMapArray::reserve(uint32_t lights){
+        lights = std::min(lights, MAX_SHADOW_CASTING_LIGHTS);
+        auto [width, height] = obj::Star::get_shadow_map_size();
+        if(lights <= m_capacity && width == m_width && height == m_height)
+            return;
+        // grow in steps so adding stars one by one doesn't reallocate every time
+        uint32_t capacity = std::max<uint32_t>(m_capacity, 1);
+        while(capacity < lights)
+            capacity *= 2;
+        capacity = std::min(capacity, MAX_SHADOW_CASTING_LIGHTS);
+        release();
+        m_width = width;
+        m_height = height;
+        m_capacity = capacity;
+
+        glGenTextures(1, &m_texture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_texture);
+        glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY,
+                0,
+                GL_DEPTH_COMPONENT,
+                m_width,
+                m_height,
+                m_capacity * 6,
+                0,
+                GL_DEPTH_COMPONENT,
+                GL_FLOAT,
+                NULL);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+        glGenFramebuffers(1, &m_fbo);
+        gl_state::bind_framebuffer(GL_FRAMEBUFFER, m_fbo);
+        // layered attachment, the shadow geometry shader picks the layer with gl_Layer
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_texture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+            throw std::runtime_error("Failed to complete the shadow map array framebuffer");
+        }
+        gl_state::bind_framebuffer(GL_FRAMEBUFFER, 0);
+    }
+    uint32_t ShadowMapArray::get_capacity() const {
+        return m_capacity;
+    }
+    uint32_t ShadowMapArray::get_texture() const {
+        return m_texture;
+    }
+    uint32_t ShadowMapArray::get_framebuffer() const {
+        return m_fbo;
+    }
+    uint32_t ShadowMapArray::get_width() const {
+        return m_width;
+    }
+    uint32_t ShadowMapArray::get_height() const {
+        return m_height;
+    }
+
+    LightClusters::LightClusters(){}
+    LightClusters::LightClusters(LightClusters&& other):
+        m_clusters_ssbo(other.m_clusters_ssbo),
+        m_indices_ssbo(other.m_indices_ssbo),
+        m_near(other.m_near),
+        m_far(other.m_far),
+        m_clusters(std::move(other.m_clusters)),
+        m_indices(std::move(other.m_indices)),
+        m_ranges(std::move(other.m_ranges)),
+        m_stats(other.m_stats)
+    {
+        other.m_clusters_ssbo = 0;
+        other.m_indices_ssbo = 0;
+    }
+    LightClusters& LightClusters::operator=(LightClusters&& other){
+        release();
+        m_clusters_ssbo = std::exchange(other.m_clusters_ssbo, 0);
+        m_indices_ssbo = std::exchange(other.m_indices_ssbo, 0);
+        m_near = other.m_near;
+        m_far = other.m_far;
+        m_clusters = std::move(other.m_clusters);
+        m_indices = std::move(other.m_indices);
+        m_ranges = std::move(other.m_ranges);
+        m_stats = other.m_stats;
+        return *this;
+    }
+    LightClusters::~LightClusters(){
+        release();
+    }
+    void LightClusters::release(){
+        if(m_clusters_ssbo)
+            glDeleteBuffers(1, &m_clusters_ssbo);
+        if(m_indices_ssbo)
+            glDeleteBuffers(1, &m_indices_ssbo);
+        m_clusters_ssbo = 0;
+        m_indices_ssbo = 0;
+    }
+    uint32_t LightClusters::slice_for_depth(float depth) const {
+        // exponential slices so clusters close to the camera stay small
+        auto slice = std::floor(std::log(depth / m_near) / std::log(m_far / m_near) * (float)CLUSTERS_Z);
+        return (uint32_t)std::clamp(slice, 0.0f, (float)CLUSTERS_Z - 1);
+    }
+    void LightClusters::build(const std::vector<LightSource>& lights, const glm::mat4& view, const glm::mat4& projection, float near, float far){
+        m_near = near;
+        m_far = far;
+        m_stats = {};
+        m_ranges.clear();
+        m_clusters.assign(CLUSTER_COUNT, {});
+
+        auto tile = [](float ndc, uint32_t tiles) {
+            return (int32_t)std::floor((ndc * 0.5f + 0.5f) * (float)tiles);
+        };
+        for (uint32_t i = 0; i < lights.size(); i++) {
+            auto& ls = lights[i];
+            float r = ls.radius;
+            if (!(r > 0.0f))
+                continue;
+            auto center = glm::vec3(view * glm::vec4(ls.position, 1.0f));
+            float depth = -center.z;
+            float z_min = depth - r, z_max = depth + r;
+            if (z_max < near || z_min > far)
+                continue;
+
+            ClusterRange range { .light = i };
+            range.z0 = slice_for_depth(std::max(z_min, near));
+            range.z1 = slice_for_depth(std::min(z_max, far));
+            if (z_min <= near) {
+                // the camera is inside (or right next to) the light volume
+                range.x0 = 0;
+                range.x1 = CLUSTERS_X - 1;
+                range.y0 = 0;
+                range.y1 = CLUSTERS_Y - 1;
+            } else {
+                // conservative screen space bounds of the sphere, project the extremes at the nearest
+                // and farthest depth and take whichever is wider
+                float p_x = projection[0][0], p_y = projection[1][1];
+                float x_lo = p_x * std::min((center.x - r) / z_min, (center.x - r) / z_max);
+                float x_hi = p_x * std::max((center.x + r) / z_min, (center.x + r) / z_max);
+                float y_lo = p_y * std::min((center.y - r) / z_min, (center.y - r) / z_max);
+                float y_hi = p_y * std::max((center.y + r) / z_min, (center.y + r) / z_max);
+                int32_t x0 = tile(x_lo, CLUSTERS_X), x1 = tile(x_hi, CLUSTERS_X);
+                int32_t y0 = tile(y_lo, CLUSTERS_Y), y1 = tile(y_hi, CLUSTERS_Y);
+                if (x1 < 0 || y1 < 0 || x0 >= (int32_t)CLUSTERS_X || y0 >= (int32_t)CLUSTERS_Y)
+                    continue;
+                range.x0 = std::max(x0, 0);
+                range.x1 = std::min(x1, (int32_t)CLUSTERS_X - 1);
+                range.y0 = std::max(y0, 0);
+                range.y1 = std::min(y1, (int32_t)CLUSTERS_Y - 1);
+            }
+            m_ranges.push_back(range);
+        }
+        auto for_each_cluster = [](const ClusterRange& r, auto&& f) {
+            for (uint32_t z = r.z0; z <= r.z1; z++)
+                for (uint32_t y = r.y0; y <= r.y1; y++)
+                    for (uint32_t x = r.x0; x <= r.x1; x++)
+                        f(x + y * CLUSTERS_X + z * CLUSTERS_X * CLUSTERS_Y);
+        };
+        // count, prefix sum, then fill
+        for (auto& r : m_ranges)
+            for_each_cluster(r, [&](uint32_t c) { m_clusters[c].count++; });
+        uint32_t total = 0;
+        for (auto& c : m_clusters) {
+            c.offset = total;
+            total += c.count;
+            m_stats.max_lights_per_cluster = std::max(m_stats.max_lights_per_cluster, c.count);
+            c.count = 0;
+        }
+        m_indices.resize(total);
+        for (auto& r : m_ranges)
+            for_each_cluster(r, [&](uint32_t c) {
+                auto& cl = m_clusters[c];
+                m_indices[cl.offset + cl.count++] = r.light;
+            });
+        m_stats.lights_binned = m_ranges.size();
+        m_stats.light_references = total;
+    }
+    void LightClusters::upload(){
+        if (!m_clusters_ssbo)
+            glGenBuffers(1, &m_clusters_ssbo);
+        if (!m_indices_ssbo)
+            glGenBuffers(1, &m_indices_ssbo);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusters_ssbo);
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+            m_clusters.size() * sizeof(Cluster),
+            m_clusters.data(),
+            GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_indices_ssbo);
+        // never allocate an empty buffer, the shader still expects something bound
+        const uint32_t dummy = 0;
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+            std::max<size_t>(m_indices.size(), 1) * sizeof(uint32_t),
+            m_indices.empty() ? &dummy : m_indices.data(),
+            GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTERS_MOUNT_POINT, m_clusters_ssbo);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDICES_MOUNT_POINT, m_indices_ssbo);
+    }
+    void LightClusters::set_uniforms(Shader* shader) const {
+        shader->set_uint("clusters_x", CLUSTERS_X);
+        shader->set_uint("clusters_y", CLUSTERS_Y);
+        shader->set_uint("clusters_z", CLUSTERS_Z);
+        shader->set_float("cluster_near", m_near);
+        shader->set_float("cluster_depth_scale", (float)CLUSTERS_Z / std::log(m_far / m_near));
+    }
+    const LightClusters::Stats& LightClusters::get_stats() const {
+        return m_stats;
+    }
+}
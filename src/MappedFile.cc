@@ -0,0 +1,89 @@
+#include "MappedFile.hpp"
+#include <stdexcept>
+#include <utility>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gm {
+    MappedFile::MappedFile(const std::filesystem::path& path){
+#ifdef _WIN32
+        m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            m_file = nullptr;
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+        LARGE_INTEGER size{};
+        GetFileSizeEx(m_file, &size);
+        m_size = (size_t)size.QuadPart;
+        if (m_size) {
+            m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            m_data = m_mapping ? static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Failed to open " + path.string());
+        struct stat st{};
+        ::fstat(fd, &st);
+        m_size = (size_t)st.st_size;
+        if (m_size) {
+            void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            m_data = data == MAP_FAILED ? nullptr : static_cast<const std::byte*>(data);
+        }
+        // the mapping keeps the file alive
+        ::close(fd);
+#endif
+        if (m_size && !m_data) {
+            unmap();
+            throw std::runtime_error(path.string() + ": mapping it failed");
+        }
+    }
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this == &other)
+            return *this;
+        unmap();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+        m_file = std::exchange(other.m_file, nullptr);
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+        return *this;
+    }
+    MappedFile::~MappedFile(){
+        unmap();
+    }
+    void MappedFile::unmap(){
+#ifdef _WIN32
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file)
+            CloseHandle(m_file);
+        m_file = m_mapping = nullptr;
+#else
+        if (m_data)
+            ::munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+    const std::byte* MappedFile::data() const {
+        return m_data;
+    }
+    size_t MappedFile::size() const {
+        return m_size;
+    }
+}
@@ -3,6 +3,7 @@
 #include <glm/gtx/string_cast.hpp>
 #include "shader/Shader.hpp"
 #include <Singletons.hpp>
+#include "GlState.hpp"
 using namespace gm::singl;
 namespace obj {
     SelectedMarker::SelectedMarker() {
@@ -27,9 +28,9 @@ namespace obj {
         sh->set_vec3("center", pos);
 
         m_vao->bind();
-        ::glDisable(GL_CULL_FACE);
-        ::glDrawArrays(GL_TRIANGLES, 0, 12);
-        ::glEnable(GL_CULL_FACE);
+        gm::gl_state::disable(GL_CULL_FACE);
+        gm::gl_state::draw_arrays(GL_TRIANGLES, 0, 12);
+        gm::gl_state::enable(GL_CULL_FACE);
         m_vao->unbind();
     }
 }
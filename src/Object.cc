@@ -2,18 +2,20 @@
 #include <Object.hpp>
 #include <algorithm>
 #include <cstdio>
+#include <map>
 
 using namespace gm::singl;
 
 namespace obj {
-    void CelestialBody::shadow_render() {
+    void CelestialBody::shadow_render(uint32_t face_mask, uint32_t lod) {
         auto* sh = shader_instances::get_instance(shader_instances::ShaderInstance::ShadowMap);
         sh->use_shader();
         auto model = glm::mat4(1.0);
         model = glm::translate(model, m_pos);
         model = glm::scale(model, glm::vec3(m_radius));
         sh->set_mat4("model", model);
-        m_sphere->draw();
+        sh->set_uint("face_mask", face_mask);
+        m_sphere->draw(lod);
     }
     void CelestialBody::forward_render(bool, bool, bool render_trails){
         if(m_selected){
@@ -35,6 +37,9 @@ namespace obj {
     const font::Text3D& CelestialBody::label(){
         return m_label;
     }
+    Trail& CelestialBody::trail(){
+        return m_trail;
+    }
     void CelestialBody::update(double& delta_t){
         m_speed += m_acceleration;
         m_acceleration = glm::vec3(0);
@@ -50,6 +55,10 @@ namespace obj {
         m_pos = pos;
         m_trail.fill(m_pos);
     }
+    void CelestialBody::move_to(glm::vec3 pos){
+        m_pos = pos;
+        m_label.set_pos(glm::vec3(m_pos.x, m_pos.y + m_radius + m_label.get_text_height() * 1.2, m_pos.z));
+    }
     glm::vec3 CelestialBody::get_pos() const{
         return m_pos;
     }
@@ -101,9 +110,37 @@ namespace obj {
     void CelestialBody::set_rotation_speed(float rot_speed){
         m_rotation_speed = rot_speed;
     }
-    void UnitSphereVAO::draw() const {
+    uint32_t CelestialBody::get_lod() const{
+        return m_lod;
+    }
+    void CelestialBody::set_lod(uint32_t lod){
+        m_lod = std::min(lod, UnitSphereVAO::LOD_LEVELS - 1);
+    }
+    void UnitSphereVAO::draw(uint32_t lod) const {
+        auto& range = m_lods[std::min(lod, LOD_LEVELS - 1)];
         glBindVertexArray(m_vao);
-        glDrawElements(GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT, 0);
+        gm::gl_state::draw_elements(GL_TRIANGLES, range.num_indices, GL_UNSIGNED_INT, (void*)(range.first_index * sizeof(int32_t)));
+        glBindVertexArray(0);
+    }
+    uint32_t UnitSphereVAO::lod_for_screen_radius(float radius_px) {
+        // roughly keeps the triangle edges a few pixels long
+        constexpr float thresholds[LOD_LEVELS - 1] = { 6.0f, 16.0f, 40.0f, 100.0f };
+        uint32_t lod = 0;
+        while (lod < LOD_LEVELS - 1 && radius_px >= thresholds[lod])
+            lod++;
+        return lod;
+    }
+    uint32_t UnitSphereVAO::triangle_count(uint32_t lod) {
+        return 20u << (2 * std::min(lod, LOD_LEVELS - 1));
+    }
+    void ImpostorBatchVAO::draw(const std::vector<ImpostorData>& impostors) const {
+        if (impostors.empty())
+            return;
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER, impostors.size() * sizeof(ImpostorData), impostors.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(m_vao);
+        gm::gl_state::draw_arrays(GL_POINTS, 0, impostors.size());
         glBindVertexArray(0);
     }
 
@@ -132,59 +169,51 @@ namespace obj {
         std::vector<UnitSphereCreationData::VertexData> vrt{};
         std::vector<int32_t> indices{};
 
-        constexpr const float pitch_start_value = -90;
-        float pitch = pitch_start_value, yaw = 0;
-        const int step = 30;
-        const float pitch_step = 180. / step;
-        const float yaw_step = 360. / step;
-        glm::vec3 bottom_pole = glm::vec3(0, -1.0f, 0);
-        for(auto i = 0; i < step; i++){
-            vrt.push_back({bottom_pole, bottom_pole, { (i * yaw_step) / 360., 0.0 }});
-        }
-
-        auto ring_base = glm::vec3(0);
-        for(int i = 0; i < step; i++){
-            pitch += pitch_step;
-            ring_base.y = std::sin(glm::radians(pitch));
-            ring_base.x = std::cos(glm::radians(pitch));
-            for(int j = 0; j < step; j++){
-                glm::vec3 current_vert = { ring_base };
-                current_vert.x = std::cos(glm::radians(yaw)) * std::cos(glm::radians(pitch));
-                current_vert.z = std::sin(glm::radians(yaw)) * std::cos(glm::radians(pitch));
-                yaw += yaw_step;
-                vrt.push_back({current_vert, glm::normalize(current_vert), { (yaw) / (360.), (pitch - pitch_start_value) / 180.  }});
+        // start from an icosahedron and split every triangle in four for each level
+        const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+        std::vector<glm::vec3> positions = {
+            {-1,  t,  0}, { 1,  t,  0}, {-1, -t,  0}, { 1, -t,  0},
+            { 0, -1,  t}, { 0,  1,  t}, { 0, -1, -t}, { 0,  1, -t},
+            { t,  0, -1}, { t,  0,  1}, {-t,  0, -1}, {-t,  0,  1},
+        };
+        for (auto& p : positions)
+            p = glm::normalize(p);
+        std::vector<int32_t> tris = {
+            0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+            1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+            3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+            4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1,
+        };
+        for (uint32_t lod = 0; lod < LOD_LEVELS; lod++) {
+            if (lod > 0) {
+                std::map<std::pair<int32_t, int32_t>, int32_t> midpoints{};
+                auto midpoint = [&](int32_t a, int32_t b) {
+                    auto key = std::minmax(a, b);
+                    if (auto it = midpoints.find(key); it != midpoints.end())
+                        return it->second;
+                    positions.push_back(glm::normalize(positions[a] + positions[b]));
+                    int32_t idx = positions.size() - 1;
+                    midpoints.insert({ key, idx });
+                    return idx;
+                };
+                std::vector<int32_t> next{};
+                next.reserve(tris.size() * 4);
+                for (size_t i = 0; i < tris.size(); i += 3) {
+                    auto a = tris[i], b = tris[i + 1], c = tris[i + 2];
+                    auto ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+                    next.insert(next.end(), { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca });
+                }
+                tris = std::move(next);
             }
-            yaw = 0;
-        }
-        glm::vec3 top_pole = glm::vec3(0, 1.0f, 0);
-
-        for(auto i = 0; i < step; i++){
-            vrt.push_back({top_pole, glm::normalize(top_pole), { (i * yaw_step) / 360., 1.0 }});
-        }
-
-        //indices for the bottom pole cap (triangles with the bottom pole)
-        auto bottom_idx = 0;
-        for(size_t idx = step; idx < step - 1; idx++){
-            indices.push_back(bottom_idx++);
-            indices.push_back(idx);
-            indices.push_back(idx + 1);
-            /*if(idx == step - 1){*/
-            /*    indices.push_back(bottom_idx);*/
-            /*    indices.push_back(step);*/
-            /*    indices.push_back(start);*/
-            /*}*/
-        }
-        const auto first_top_vert_idx = (step + 1);
-        auto top_idx = vrt.size() - first_top_vert_idx;
-        //body of the sphere up to the top pole cap, i guess it also does the cap? no idea why tho, but cool that it works i guess
-        for(size_t idx = 0; idx < vrt.size() - first_top_vert_idx; idx++){
-            indices.push_back(idx + step);
-            indices.push_back(idx + 1);
-            indices.push_back(idx);
-
-            indices.push_back(std::clamp(idx + step - 1, idx, top_idx));
-            indices.push_back(std::clamp(idx + step, idx, top_idx++));
-            indices.push_back(idx);
+            // levels share nothing, so the indices just get offset by the vertices already written
+            const int32_t base_vertex = vrt.size();
+            m_lods[lod] = { .first_index = indices.size(), .num_indices = tris.size() };
+            for (auto& p : positions) {
+                glm::vec2 uv = { std::atan2(p.z, p.x) / (2.0f * (float)M_PI) + 0.5f, std::asin(p.y) / (float)M_PI + 0.5f };
+                vrt.push_back({ p, p, uv });
+            }
+            for (auto i : tris)
+                indices.push_back(base_vertex + i);
         }
         return UnitSphereCreationData{
             .vertices = std::move(vrt),
@@ -132,7 +132,6 @@ UnitSphereVAO::UnitSphereVAO()
 {
     auto sphere = make_unit_sphere();
     m_num_verticies = sphere.vertices.size();
-    m_num_indices = sphere.indices.size();
     m_vbo = make_unit_sphere_vbo(sphere);
     m_ebo = make_unit_sphere_ebo(sphere);
     glGenVertexArrays(1, &m_vao);
@@ -154,20 +153,20 @@ UnitSphereVAO::UnitSphereVAO()
 }
 // move constructor
 UnitSphereVAO::UnitSphereVAO(UnitSphereVAO&& other) : VertexArrrayObject(std::move(other))
-    , m_num_indices { other.m_num_indices }
     , m_num_verticies { other.m_num_verticies }
 {
+    std::copy(std::begin(other.m_lods), std::end(other.m_lods), std::begin(m_lods));
+    std::fill(std::begin(other.m_lods), std::end(other.m_lods), LodRange{});
     other.m_num_verticies = 0;
-    other.m_num_indices = 0;
 }
 // move assign
 UnitSphereVAO& UnitSphereVAO::operator=(UnitSphereVAO&& other)
 {
     VertexArrrayObject::operator=(std::move(other));
     m_num_verticies = other.m_num_verticies;
-    m_num_indices = other.m_num_indices;
+    std::copy(std::begin(other.m_lods), std::end(other.m_lods), std::begin(m_lods));
+    std::fill(std::begin(other.m_lods), std::end(other.m_lods), LodRange{});
     other.m_num_verticies = 0;
-    other.m_num_indices = 0;
     return *this;
 }
 // destructor
@@ -15,12 +15,12 @@ namespace obj {
             w_sh->use_shader();
             w_sh->set_mat4(name_of(model), model);
             w_sh->set_vec3(name_of(color), m_color);
-            m_sphere->draw();
+            m_sphere->draw(m_lod);
         }
         if(render_normals){
             m_normals_shader->use_shader();
             m_normals_shader->set_mat4(name_of(model), model);
-            m_sphere->draw();
+            m_sphere->draw(m_lod);
         }
 
     }
@@ -45,7 +45,7 @@ namespace obj {
         } else {
             m_shader->set_int("has_texture", false);
         }
-        m_sphere->draw();
+        m_sphere->draw(m_lod);
     }
     void Planet::set_mass(float new_mass) {
         CelestialBody::set_mass(new_mass);
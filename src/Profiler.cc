@@ -0,0 +1,230 @@
+#include "Profiler.hpp"
+#include "AllocTracker.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace gm::profiler {
+    namespace {
+        // single producer (the owning thread), single consumer (the main thread in end_frame)
+        struct ThreadRing {
+            std::array<ZoneEvent, RING_SIZE> events{};
+            std::atomic<uint32_t> head{}, tail{};
+            std::atomic<bool> retired{};
+            uint32_t id{};
+            std::atomic<const char*> name{};
+            uint32_t depth{};
+        };
+        struct Registry {
+            std::mutex mutex{};
+            std::vector<std::shared_ptr<ThreadRing>> rings{};
+            std::atomic<uint32_t> next_id{};
+        };
+        // only touched by the main thread
+        struct Collector {
+            std::vector<ZoneEvent> last_frame{};
+            std::vector<ZoneEvent> gpu_zones{};
+            std::vector<ThreadInfo> threads{};
+            // every thread ever seen, the trace still needs the names of threads that are gone
+            std::unordered_map<uint32_t, const char*> names{};
+            uint64_t frame_start{}, frame_end{};
+            std::deque<ZoneEvent> capture{};
+            bool capturing{};
+        };
+        const auto EPOCH = std::chrono::steady_clock::now();
+        std::atomic<bool> ENABLED{ true };
+        std::atomic<uint64_t> DROPPED{};
+        Registry REGISTRY{};
+        Collector COLLECTOR{};
+
+        // registers the ring on first use and retires it once the thread exits,
+        // the collector frees it after draining what is left
+        struct ThreadSlot {
+            std::shared_ptr<ThreadRing> ring{};
+            ThreadSlot(){
+                ring = std::make_shared<ThreadRing>();
+                ring->id = REGISTRY.next_id.fetch_add(1);
+                std::lock_guard lock(REGISTRY.mutex);
+                REGISTRY.rings.push_back(ring);
+            }
+            ~ThreadSlot(){
+                ring->retired.store(true, std::memory_order_release);
+            }
+        };
+        ThreadRing& this_thread_ring(){
+            thread_local ThreadSlot slot{};
+            return *slot.ring;
+        }
+        void push(ThreadRing& ring, const ZoneEvent& event){
+            auto head = ring.head.load(std::memory_order_relaxed);
+            if (head - ring.tail.load(std::memory_order_acquire) >= RING_SIZE) {
+                DROPPED.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            ring.events[head % RING_SIZE] = event;
+            ring.head.store(head + 1, std::memory_order_release);
+        }
+        void drain(ThreadRing& ring, std::vector<ZoneEvent>& out){
+            auto tail = ring.tail.load(std::memory_order_relaxed);
+            auto head = ring.head.load(std::memory_order_acquire);
+            for (; tail != head; tail++)
+                out.push_back(ring.events[tail % RING_SIZE]);
+            ring.tail.store(tail, std::memory_order_release);
+        }
+        void write_escaped(std::ostream& os, const char* s){
+            os << '"';
+            for (; s && *s; s++) {
+                if (*s == '"' || *s == '\\')
+                    os << '\\';
+                os << *s;
+            }
+            os << '"';
+        }
+    }
+
+    Zone::Zone(const char* name):
+        m_name(name),
+        m_recording(ENABLED.load(std::memory_order_relaxed))
+    {
+        if (!m_recording)
+            return;
+        this_thread_ring().depth++;
+        auto allocs = alloc::get_thread_counters();
+        m_allocations = allocs.allocations;
+        m_bytes = allocs.bytes;
+        m_start = now();
+    }
+    Zone::~Zone(){
+        if (!m_recording)
+            return;
+        auto end = now();
+        auto allocs = alloc::get_thread_counters();
+        auto& ring = this_thread_ring();
+        ring.depth--;
+        push(ring, ZoneEvent {
+            .name = m_name,
+            .start = m_start,
+            .end = end,
+            .depth = ring.depth,
+            .thread = ring.id,
+            .allocations = (uint32_t)(allocs.allocations - m_allocations),
+            .bytes = allocs.bytes - m_bytes,
+        });
+    }
+
+    uint64_t now(){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - EPOCH).count();
+    }
+    void set_enabled(bool enabled){
+        ENABLED.store(enabled, std::memory_order_relaxed);
+    }
+    bool is_enabled(){
+        return ENABLED.load(std::memory_order_relaxed);
+    }
+    void set_thread_name(const char* name){
+        this_thread_ring().name.store(name, std::memory_order_relaxed);
+    }
+
+    void end_frame(){
+        auto& c = COLLECTOR;
+        c.frame_start = c.frame_end;
+        c.frame_end = now();
+        c.last_frame.clear();
+        c.threads.clear();
+        {
+            std::lock_guard lock(REGISTRY.mutex);
+            for (auto& ring : REGISTRY.rings) {
+                // read the flag first, anything pushed before retiring is visible after it
+                bool retired = ring->retired.load(std::memory_order_acquire);
+                drain(*ring, c.last_frame);
+                c.threads.push_back({ ring->id, ring->name.load(std::memory_order_relaxed) });
+                c.names[ring->id] = c.threads.back().name;
+                if (retired)
+                    ring.reset();
+            }
+            REGISTRY.rings.erase(std::remove(REGISTRY.rings.begin(), REGISTRY.rings.end(), nullptr), REGISTRY.rings.end());
+        }
+        c.last_frame.insert(c.last_frame.end(), c.gpu_zones.begin(), c.gpu_zones.end());
+        c.gpu_zones.clear();
+        std::sort(c.last_frame.begin(), c.last_frame.end(), [](const ZoneEvent& a, const ZoneEvent& b) {
+            return a.thread != b.thread ? a.thread < b.thread : a.start < b.start;
+        });
+        if (c.capturing) {
+            c.capture.insert(c.capture.end(), c.last_frame.begin(), c.last_frame.end());
+            while (c.capture.size() > CAPTURE_LIMIT)
+                c.capture.pop_front();
+        }
+    }
+    uint64_t get_last_frame_start(){
+        return COLLECTOR.frame_start;
+    }
+    uint64_t get_last_frame_end(){
+        return COLLECTOR.frame_end;
+    }
+    const std::vector<ZoneEvent>& get_last_frame(){
+        return COLLECTOR.last_frame;
+    }
+    std::vector<ThreadInfo> get_threads(){
+        return COLLECTOR.threads;
+    }
+    void add_gpu_zone(const char* name, uint64_t start, uint64_t end){
+        COLLECTOR.gpu_zones.push_back({ .name = name, .start = start, .end = end, .thread = GPU_THREAD });
+    }
+    uint64_t get_dropped(){
+        return DROPPED.load(std::memory_order_relaxed);
+    }
+
+    void start_capture(){
+        COLLECTOR.capture.clear();
+        COLLECTOR.capturing = true;
+    }
+    bool is_capturing(){
+        return COLLECTOR.capturing;
+    }
+    void stop_capture(const std::filesystem::path& path){
+        auto& c = COLLECTOR;
+        c.capturing = false;
+        auto out = std::ofstream(path);
+        if (!out)
+            throw std::runtime_error("Failed to open " + path.string() + " for the profiler trace");
+        out << std::fixed << std::setprecision(3);
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&]() {
+            if (!first)
+                out << ",\n";
+            first = false;
+        };
+        c.names[GPU_THREAD] = "GPU";
+        for (auto [id, name] : c.names) {
+            if (!name)
+                continue;
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << id << ",\"args\":{\"name\":";
+            write_escaped(out, name);
+            out << "}}";
+        }
+        // complete events, timestamps in microseconds
+        for (auto& e : c.capture) {
+            separator();
+            out << "{\"name\":";
+            write_escaped(out, e.name);
+            out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread
+                << ",\"ts\":" << e.start / 1000.0
+                << ",\"dur\":" << (e.end - e.start) / 1000.0;
+            if (e.allocations)
+                out << ",\"args\":{\"allocations\":" << e.allocations << ",\"bytes\":" << e.bytes << "}";
+            out << "}";
+        }
+        out << "\n]}\n";
+        c.capture.clear();
+    }
+}
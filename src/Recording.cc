@@ -0,0 +1,340 @@
+#include "Recording.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace gm::record {
+    namespace {
+        // how long the writer sleeps when nothing is queued, a recorded step every few frames is plenty
+        constexpr auto IDLE_WAIT = std::chrono::milliseconds(2);
+
+        template<typename T>
+        void append(std::vector<uint8_t>& out, const T* data, size_t n){
+            auto bytes = reinterpret_cast<const uint8_t*>(data);
+            out.insert(out.end(), bytes, bytes + n * sizeof(T));
+        }
+        void append_varint(std::vector<uint8_t>& out, int64_t value){
+            // zigzag, so small negative numbers stay small
+            auto v = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+            while (v >= 0x80) {
+                out.push_back((uint8_t)(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back((uint8_t)v);
+        }
+        // throws when the payload ends in the middle of it
+        int64_t read_varint(const uint8_t*& it, const uint8_t* end){
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (it == end)
+                    throw std::runtime_error("Recording delta chunk is cut short");
+                auto byte = *it++;
+                v |= (uint64_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            }
+            throw std::runtime_error("Recording delta chunk is corrupt");
+        }
+        // false when the position doesn't fit into the grid anymore
+        bool quantize(glm::vec3 pos, double scale, glm::ivec3& out){
+            for (int axis = 0; axis < 3; axis++) {
+                double q = std::round(pos[axis] / scale);
+                if (!(std::abs(q) <= std::numeric_limits<int32_t>::max()))
+                    return false;
+                out[axis] = (int32_t)q;
+            }
+            return true;
+        }
+    }
+
+    void Frame::resize(size_t n){
+        pos.resize(n);
+        mass.resize(n);
+        radius.resize(n);
+        color.resize(n);
+        flags.resize(n);
+    }
+
+    Recorder::Recorder(const std::filesystem::path& path, uint32_t interval, uint32_t keyframe_interval):
+        m_out(path, std::ios::binary),
+        m_interval(std::max(interval, 1u)),
+        m_keyframe_interval(std::max(keyframe_interval, 1u))
+    {
+        if (!m_out)
+            throw std::runtime_error("Failed to create " + path.string());
+        FileHeader header{ .version = FILE_VERSION, .header_size = sizeof(FileHeader), .interval = m_interval, .keyframe_interval = m_keyframe_interval };
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_bytes = sizeof(header);
+        for (auto& frame : m_frames)
+            m_free.push(&frame);
+        m_writer = std::thread(&Recorder::write_loop, this);
+    }
+    Recorder::~Recorder(){
+        m_stop.store(true, std::memory_order_release);
+        m_writer.join();
+        Trailer trailer{ .index_offset = m_bytes };
+        std::memcpy(trailer.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        m_payload.clear();
+        append(m_payload, m_index.data(), m_index.size());
+        write_chunk(ChunkHeader { .kind = Index, .payload_size = m_payload.size() });
+        m_out.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    }
+
+    bool Recorder::wants(uint64_t step) const {
+        return step % m_interval == 0;
+    }
+    Frame* Recorder::begin_frame(bool wait){
+        Frame* frame{};
+        while (!m_free.pop(frame)) {
+            if (!wait) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            std::this_thread::sleep_for(IDLE_WAIT);
+        }
+        return frame;
+    }
+    void Recorder::submit(Frame* frame){
+        // can't fail, there are only as many frames as the queue holds
+        m_pending.push(frame);
+    }
+    uint32_t Recorder::get_interval() const {
+        return m_interval;
+    }
+    uint64_t Recorder::get_recorded() const {
+        return m_recorded.load(std::memory_order_relaxed);
+    }
+    uint64_t Recorder::get_dropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+    uint64_t Recorder::get_bytes_written() const {
+        return m_bytes.load(std::memory_order_relaxed);
+    }
+
+    void Recorder::write_loop(){
+        profiler::set_thread_name("recorder");
+        while (true) {
+            Frame* frame{};
+            if (m_pending.pop(frame)) {
+                write_frame(*frame);
+                m_free.push(frame);
+                continue;
+            }
+            if (m_stop.load(std::memory_order_acquire)) {
+                // the simulation is done submitting by now, whatever is still queued goes out
+                while (m_pending.pop(frame))
+                    write_frame(*frame);
+                break;
+            }
+            std::this_thread::sleep_for(IDLE_WAIT);
+        }
+        m_out.flush();
+    }
+    void Recorder::write_frame(const Frame& frame){
+        PROFILE_ZONE("record frame");
+        const size_t n = frame.pos.size();
+        bool keyframe = m_index.empty() || frame.layout != m_last_layout || n != m_last_quantized.size()
+            || m_since_keyframe + 1 >= m_keyframe_interval;
+        m_payload.clear();
+        if (!keyframe) {
+            for (size_t i = 0; i < n; i++) {
+                glm::ivec3 q{};
+                if (!quantize(frame.pos[i], m_scale, q)) {
+                    // flew off the grid, the keyframe picks a coarser one
+                    keyframe = true;
+                    break;
+                }
+                for (int axis = 0; axis < 3; axis++)
+                    append_varint(m_payload, (int64_t)q[axis] - m_last_quantized[i][axis]);
+                m_last_quantized[i] = q;
+            }
+        }
+        if (keyframe) {
+            float extent = 1.0f;
+            for (auto& p : frame.pos)
+                extent = std::max({ extent, std::abs(p.x), std::abs(p.y), std::abs(p.z) });
+            m_scale = (double)extent / (1 << QUANT_BITS);
+            m_last_quantized.resize(n);
+            for (size_t i = 0; i < n; i++)
+                quantize(frame.pos[i], m_scale, m_last_quantized[i]);
+            m_payload.clear();
+            append(m_payload, m_last_quantized.data(), n);
+            append(m_payload, frame.mass.data(), n);
+            append(m_payload, frame.radius.data(), n);
+            append(m_payload, frame.color.data(), n);
+            append(m_payload, frame.flags.data(), n);
+            m_keyframe_offset = m_bytes;
+            m_last_layout = frame.layout;
+            m_since_keyframe = 0;
+        } else {
+            m_since_keyframe++;
+        }
+        m_index.push_back({ .step = frame.step, .time = frame.time, .offset = m_bytes, .keyframe_offset = m_keyframe_offset });
+        write_chunk(ChunkHeader {
+            .kind = keyframe ? Keyframe : Delta,
+            .bodies = (uint32_t)n,
+            .step = frame.step,
+            .time = frame.time,
+            .scale = m_scale,
+            .payload_size = m_payload.size(),
+        });
+        m_recorded.fetch_add(1, std::memory_order_relaxed);
+    }
+    void Recorder::write_chunk(const ChunkHeader& header){
+        m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_out.write(reinterpret_cast<const char*>(m_payload.data()), m_payload.size());
+        m_bytes.fetch_add(sizeof(header) + m_payload.size(), std::memory_order_relaxed);
+    }
+
+    Replay::Replay(const std::filesystem::path& path):
+        m_file(path)
+    {
+        if (m_file.size() < sizeof(FileHeader))
+            throw std::runtime_error(path.string() + " is not a recording");
+        m_header = reinterpret_cast<const FileHeader*>(m_file.data());
+        if (std::memcmp(m_header->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+            throw std::runtime_error(path.string() + " is not a recording");
+        if (m_header->version != FILE_VERSION)
+            throw std::runtime_error(path.string() + " has version " + std::to_string(m_header->version) + ", expected " + std::to_string(FILE_VERSION));
+        if (!read_index())
+            scan_chunks();
+        if (m_index.empty())
+            throw std::runtime_error(path.string() + " has no records");
+    }
+    ChunkHeader Replay::chunk(uint64_t offset, const uint8_t** payload) const {
+        // chunks follow each other without padding, so nothing in the file is aligned
+        auto size = m_file.size();
+        ChunkHeader header{};
+        if (offset > size || size - offset < sizeof(ChunkHeader))
+            throw std::runtime_error("Recording is cut short");
+        std::memcpy(&header, m_file.data() + offset, sizeof(header));
+        if (header.payload_size > size - offset - sizeof(ChunkHeader))
+            throw std::runtime_error("Recording is cut short");
+        if (payload)
+            *payload = reinterpret_cast<const uint8_t*>(m_file.data() + offset + sizeof(ChunkHeader));
+        return header;
+    }
+    bool Replay::read_index(){
+        auto size = m_file.size();
+        if (size < sizeof(FileHeader) + sizeof(Trailer))
+            return false;
+        Trailer trailer{};
+        std::memcpy(&trailer, m_file.data() + size - sizeof(Trailer), sizeof(trailer));
+        if (std::memcmp(trailer.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+            return false;
+        const uint8_t* entries{};
+        auto header = chunk(trailer.index_offset, &entries);
+        if (header.kind != Index || header.payload_size % sizeof(IndexEntry))
+            return false;
+        m_index.resize(header.payload_size / sizeof(IndexEntry));
+        std::memcpy(m_index.data(), entries, header.payload_size);
+        return true;
+    }
+    void Replay::scan_chunks(){
+        uint64_t offset = m_header->header_size, keyframe_offset = 0;
+        bool has_keyframe = false;
+        while (true) {
+            ChunkHeader header{};
+            try {
+                header = chunk(offset);
+            } catch (const std::runtime_error&) {
+                // the writer was cut off in the middle of this chunk
+                break;
+            }
+            if (header.kind == Index)
+                break;
+            if (header.kind == Keyframe) {
+                keyframe_offset = offset;
+                has_keyframe = true;
+            }
+            if (has_keyframe)
+                m_index.push_back({ .step = header.step, .time = header.time, .offset = offset, .keyframe_offset = keyframe_offset });
+            offset += sizeof(ChunkHeader) + header.payload_size;
+        }
+    }
+    size_t Replay::size() const {
+        return m_index.size();
+    }
+    uint32_t Replay::get_interval() const {
+        return m_header->interval;
+    }
+    const IndexEntry& Replay::get_entry(size_t i) const {
+        return m_index[i];
+    }
+    size_t Replay::find(double time) const {
+        auto it = std::upper_bound(m_index.begin(), m_index.end(), time, [](double t, const IndexEntry& entry) {
+            return t < entry.time;
+        });
+        return it == m_index.begin() ? 0 : it - m_index.begin() - 1;
+    }
+    const Frame& Replay::decode(size_t i){
+        PROFILE_ZONE("decode record");
+        auto& entry = m_index.at(i);
+        if (m_current == i)
+            return m_frame;
+        // the deltas since the record shown last are enough when it builds on the same keyframe
+        size_t from{};
+        bool forward = m_current != SIZE_MAX && m_current < i && m_index[m_current].keyframe_offset == entry.keyframe_offset;
+        if (!forward) {
+            auto last = m_index.begin() + i + 1;
+            auto keyframe = std::lower_bound(m_index.begin(), last, entry.keyframe_offset, [](const IndexEntry& e, uint64_t offset) {
+                return e.offset < offset;
+            });
+            if (keyframe == last || keyframe->offset != entry.keyframe_offset)
+                throw std::runtime_error("Recording index is corrupt");
+            decode_keyframe(keyframe->offset);
+            from = keyframe - m_index.begin() + 1;
+        } else {
+            from = m_current + 1;
+        }
+        // a corrupt chunk leaves the frame half decoded
+        m_current = SIZE_MAX;
+        for (size_t j = from; j <= i; j++)
+            decode_delta(m_index[j].offset);
+
+        auto header = chunk(entry.offset);
+        m_frame.step = entry.step;
+        m_frame.time = entry.time;
+        m_frame.layout = entry.keyframe_offset;
+        for (size_t b = 0; b < m_quantized.size(); b++)
+            m_frame.pos[b] = glm::vec3(glm::dvec3(m_quantized[b]) * header.scale);
+        m_current = i;
+        return m_frame;
+    }
+    void Replay::decode_keyframe(uint64_t offset){
+        const uint8_t* it{};
+        auto header = chunk(offset, &it);
+        const size_t n = header.bodies;
+        if (header.kind != Keyframe || header.payload_size != n * (sizeof(glm::ivec3) + 2 * sizeof(float) + sizeof(glm::vec3) + sizeof(uint32_t)))
+            throw std::runtime_error("Recording keyframe is corrupt");
+        auto read = [&](auto& column) {
+            using T = typename std::remove_reference_t<decltype(column)>::value_type;
+            column.resize(n);
+            std::memcpy(column.data(), it, n * sizeof(T));
+            it += n * sizeof(T);
+        };
+        m_frame.resize(n);
+        read(m_quantized);
+        read(m_frame.mass);
+        read(m_frame.radius);
+        read(m_frame.color);
+        read(m_frame.flags);
+    }
+    void Replay::decode_delta(uint64_t offset){
+        const uint8_t* it{};
+        auto header = chunk(offset, &it);
+        if (header.kind != Delta || header.bodies != m_quantized.size())
+            throw std::runtime_error("Recording delta chunk is corrupt");
+        auto end = it + header.payload_size;
+        for (auto& q : m_quantized)
+            for (int axis = 0; axis < 3; axis++)
+                q[axis] = (int32_t)(q[axis] + read_varint(it, end));
+    }
+}
@@ -0,0 +1,358 @@
+#include "RenderGraph.hpp"
+#include "GlState.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace gm {
+
+    RenderGraph::RenderGraph(){}
+    RenderGraph::RenderGraph(RenderGraph&& other):
+        m_resources(std::move(other.m_resources)),
+        m_passes(std::move(other.m_passes)),
+        m_schedule(std::move(other.m_schedule)),
+        m_targets(std::move(other.m_targets)),
+        m_pool(std::move(other.m_pool)),
+        m_framebuffers(std::move(other.m_framebuffers)),
+        m_pass_timers(std::move(other.m_pass_timers)),
+        m_pass_draw_calls(std::move(other.m_pass_draw_calls)),
+        m_pass_cpu_ms(std::move(other.m_pass_cpu_ms)),
+        m_backbuffer(other.m_backbuffer),
+        m_width(other.m_width),
+        m_height(other.m_height),
+        m_empty_vao(std::exchange(other.m_empty_vao, 0)),
+        m_stats(other.m_stats)
+    {
+        other.m_pool.clear();
+        other.m_framebuffers.clear();
+    }
+    RenderGraph& RenderGraph::operator=(RenderGraph&& other){
+        release();
+        if (m_empty_vao)
+            glDeleteVertexArrays(1, &m_empty_vao);
+        m_resources = std::move(other.m_resources);
+        m_passes = std::move(other.m_passes);
+        m_schedule = std::move(other.m_schedule);
+        m_targets = std::move(other.m_targets);
+        m_pool = std::move(other.m_pool);
+        m_framebuffers = std::move(other.m_framebuffers);
+        m_pass_timers = std::move(other.m_pass_timers);
+        m_pass_draw_calls = std::move(other.m_pass_draw_calls);
+        m_pass_cpu_ms = std::move(other.m_pass_cpu_ms);
+        m_backbuffer = other.m_backbuffer;
+        m_width = other.m_width;
+        m_height = other.m_height;
+        m_empty_vao = std::exchange(other.m_empty_vao, 0);
+        m_stats = other.m_stats;
+        other.m_pool.clear();
+        other.m_framebuffers.clear();
+        return *this;
+    }
+    RenderGraph::~RenderGraph(){
+        release();
+        if (m_empty_vao)
+            glDeleteVertexArrays(1, &m_empty_vao);
+        m_empty_vao = 0;
+    }
+    void RenderGraph::release(){
+        for (auto& [textures, fbo] : m_framebuffers) {
+            gl_state::forget_framebuffer(fbo);
+            glDeleteFramebuffers(1, &fbo);
+        }
+        m_framebuffers.clear();
+        for (auto& pooled : m_pool) {
+            // plan without compile leaves the pool without textures
+            if (pooled.texture)
+                glDeleteTextures(1, &pooled.texture);
+        }
+        m_pool.clear();
+        for (auto& r : m_resources)
+            r.pool_slot = -1;
+    }
+    void RenderGraph::begin_frame(int32_t width, int32_t height){
+        if (width != m_width || height != m_height)
+            release();
+        m_width = width;
+        m_height = height;
+        m_passes.clear();
+        m_schedule.clear();
+        m_targets.clear();
+        m_resources.clear();
+        m_resources.push_back(ResourceNode{ .name = "backbuffer", .fbo = m_backbuffer, .width = width, .height = height });
+    }
+    RenderGraph::Resource RenderGraph::create_texture(const std::string& name, const TextureDesc& desc){
+        m_resources.push_back(ResourceNode{ .name = name, .transient = true, .desc = desc });
+        return m_resources.size() - 1;
+    }
+    RenderGraph::Resource RenderGraph::import_target(const std::string& name, uint32_t fbo, int32_t width, int32_t height){
+        m_resources.push_back(ResourceNode{ .name = name, .fbo = fbo, .width = width, .height = height });
+        return m_resources.size() - 1;
+    }
+    void RenderGraph::add_pass(Pass pass){
+        bool transient = false, external = false;
+        for (auto r : pass.writes) {
+            if (r >= m_resources.size())
+                throw std::runtime_error("Render pass '" + pass.name + "' writes an unknown resource");
+            (m_resources[r].transient ? transient : external) = true;
+        }
+        if ((transient && external) || (external && pass.writes.size() > 1))
+            throw std::runtime_error("Render pass '" + pass.name + "' has to write either transient textures or a single target");
+        m_passes.push_back(std::move(pass));
+    }
+    void RenderGraph::compile(){
+        plan();
+        create_transients();
+
+        m_targets.clear();
+        for (auto p : m_schedule) {
+            auto& w = m_passes[p].writes;
+            if (!m_resources[w.front()].transient) {
+                m_targets.push_back(m_resources[w.front()].fbo);
+                continue;
+            }
+            std::vector<uint32_t> textures{};
+            std::vector<bool> depth{};
+            for (auto r : w) {
+                textures.push_back(m_pool[m_resources[r].pool_slot].texture);
+                depth.push_back(m_resources[r].desc.depth);
+            }
+            m_targets.push_back(framebuffer_for(textures, depth));
+        }
+        m_stats.framebuffers = m_framebuffers.size();
+    }
+    void RenderGraph::plan(){
+        const uint32_t n = m_passes.size();
+        m_schedule.clear();
+        auto writes = [this](uint32_t p, Resource r) {
+            auto& w = m_passes[p].writes;
+            return std::find(w.begin(), w.end(), r) != w.end();
+        };
+        auto reads = [this](uint32_t p, Resource r) {
+            auto& rd = m_passes[p].reads;
+            return std::find(rd.begin(), rd.end(), r) != rd.end();
+        };
+
+        // everything that ends up on screen is needed, and so is whatever produced its inputs
+        std::vector<bool> live(n, false);
+        std::vector<uint32_t> stack{};
+        for (uint32_t p = 0; p < n; p++) {
+            if (writes(p, BACKBUFFER)) {
+                live[p] = true;
+                stack.push_back(p);
+            }
+        }
+        while (!stack.empty()) {
+            auto p = stack.back();
+            stack.pop_back();
+            for (auto r : m_passes[p].reads) {
+                for (uint32_t q = 0; q < p; q++) {
+                    if (!live[q] && writes(q, r)) {
+                        live[q] = true;
+                        stack.push_back(q);
+                    }
+                }
+            }
+        }
+
+        // read after write, write after write and write after read all keep declaration order
+        std::vector<std::vector<uint32_t>> edges(n);
+        std::vector<uint32_t> in_degree(n, 0);
+        for (uint32_t j = 0; j < n; j++) {
+            if (!live[j])
+                continue;
+            for (uint32_t i = 0; i < j; i++) {
+                if (!live[i])
+                    continue;
+                bool depends = false;
+                for (auto r : m_passes[j].reads)
+                    depends |= writes(i, r);
+                for (auto r : m_passes[j].writes)
+                    depends |= writes(i, r) || reads(i, r);
+                if (depends) {
+                    edges[i].push_back(j);
+                    in_degree[j]++;
+                }
+            }
+        }
+
+        // among the passes that are ready, prefer the one drawing into the same target as the last one
+        std::vector<uint32_t> ready{};
+        for (uint32_t p = 0; p < n; p++) {
+            if (live[p] && in_degree[p] == 0)
+                ready.push_back(p);
+        }
+        const std::vector<Resource>* last_target = nullptr;
+        while (!ready.empty()) {
+            auto pick = std::min_element(ready.begin(), ready.end());
+            if (last_target) {
+                for (auto it = ready.begin(); it != ready.end(); ++it) {
+                    bool same = m_passes[*it].writes == *last_target;
+                    bool picked_same = m_passes[*pick].writes == *last_target;
+                    if (same && (!picked_same || *it < *pick))
+                        pick = it;
+                }
+            }
+            auto p = *pick;
+            ready.erase(pick);
+            m_schedule.push_back(p);
+            last_target = &m_passes[p].writes;
+            for (auto q : edges[p]) {
+                if (--in_degree[q] == 0)
+                    ready.push_back(q);
+            }
+        }
+
+        assign_transients();
+
+        m_stats.passes = m_schedule.size();
+        m_stats.culled_passes = n - m_schedule.size();
+        m_stats.transient_textures = m_pool.size();
+    }
+    void RenderGraph::assign_transients(){
+        // lifetime of every transient in schedule positions
+        std::vector<std::pair<int32_t, int32_t>> lifetime(m_resources.size(), { -1, -1 });
+        for (int32_t pos = 0; pos < (int32_t)m_schedule.size(); pos++) {
+            auto& pass = m_passes[m_schedule[pos]];
+            for (auto list : { &pass.reads, &pass.writes }) {
+                for (auto r : *list) {
+                    if (!m_resources[r].transient)
+                        continue;
+                    if (lifetime[r].first < 0)
+                        lifetime[r].first = pos;
+                    lifetime[r].second = pos;
+                }
+            }
+        }
+        std::vector<Resource> order{};
+        for (Resource r = 0; r < m_resources.size(); r++) {
+            if (lifetime[r].first >= 0)
+                order.push_back(r);
+        }
+        std::sort(order.begin(), order.end(), [&](Resource a, Resource b) {
+            return lifetime[a].first < lifetime[b].first;
+        });
+        for (auto& pooled : m_pool)
+            pooled.busy_until = -1;
+        // a pooled texture can back another transient once its previous user is done with it
+        for (auto r : order) {
+            auto& node = m_resources[r];
+            auto slot = std::find_if(m_pool.begin(), m_pool.end(), [&](const PooledTexture& t) {
+                return t.desc == node.desc && t.busy_until < lifetime[r].first;
+            });
+            // the texture itself comes later in create_transients
+            if (slot == m_pool.end()) {
+                m_pool.push_back(PooledTexture{ .desc = node.desc });
+                slot = m_pool.end() - 1;
+            }
+            slot->busy_until = lifetime[r].second;
+            node.pool_slot = slot - m_pool.begin();
+        }
+    }
+    void RenderGraph::create_transients(){
+        for (auto& pooled : m_pool) {
+            if (pooled.texture)
+                continue;
+            glGenTextures(1, &pooled.texture);
+            glBindTexture(GL_TEXTURE_2D, pooled.texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, pooled.desc.internal_format, m_width, m_height, 0,
+                pooled.desc.format, pooled.desc.type, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+    }
+    uint32_t RenderGraph::framebuffer_for(const std::vector<uint32_t>& textures, const std::vector<bool>& depth){
+        if (auto it = m_framebuffers.find(textures); it != m_framebuffers.end())
+            return it->second;
+        uint32_t fbo;
+        glGenFramebuffers(1, &fbo);
+        gl_state::bind_framebuffer(GL_FRAMEBUFFER, fbo);
+        std::vector<GLenum> draw_buffers{};
+        for (size_t i = 0; i < textures.size(); i++) {
+            GLenum attachment = depth[i] ? GL_DEPTH_STENCIL_ATTACHMENT : GL_COLOR_ATTACHMENT0 + draw_buffers.size();
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, textures[i], 0);
+            if (!depth[i])
+                draw_buffers.push_back(attachment);
+        }
+        if (draw_buffers.empty())
+            glDrawBuffer(GL_NONE);
+        else
+            glDrawBuffers(draw_buffers.size(), draw_buffers.data());
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            throw std::runtime_error("Failed to complete a render graph framebuffer");
+        gl_state::bind_framebuffer(GL_FRAMEBUFFER, m_backbuffer);
+        m_framebuffers.emplace(textures, fbo);
+        return fbo;
+    }
+    void RenderGraph::execute(){
+        if (!m_empty_vao)
+            glGenVertexArrays(1, &m_empty_vao);
+        m_stats.framebuffer_switches = 0;
+        m_pass_draw_calls.assign(m_schedule.size(), 0);
+        m_pass_cpu_ms.assign(m_schedule.size(), 0.0f);
+        uint32_t current = UINT32_MAX;
+        for (size_t pos = 0; pos < m_schedule.size(); pos++) {
+            auto& pass = m_passes[m_schedule[pos]];
+            if (m_targets[pos] != current) {
+                current = m_targets[pos];
+                auto& target = m_resources[pass.writes.front()];
+                gl_state::bind_framebuffer(GL_FRAMEBUFFER, current);
+                if (target.transient)
+                    gl_state::viewport(0, 0, m_width, m_height);
+                else
+                    gl_state::viewport(0, 0, target.width, target.height);
+                m_stats.framebuffer_switches++;
+            }
+            if (!pass.execute)
+                continue;
+            auto [it, inserted] = m_pass_timers.try_emplace(pass.name);
+            if (inserted)
+                it->second = GpuTimer(it->first.c_str());
+            auto draws_before = gl_state::get_frame_stats().draw_calls;
+            auto cpu_start = profiler::now();
+            it->second.begin();
+            pass.execute(*this);
+            it->second.end();
+            m_pass_cpu_ms[pos] = (profiler::now() - cpu_start) / 1e6f;
+            m_pass_draw_calls[pos] = gl_state::get_frame_stats().draw_calls - draws_before;
+        }
+        gl_state::bind_framebuffer(GL_FRAMEBUFFER, m_backbuffer);
+        gl_state::viewport(0, 0, m_width, m_height);
+    }
+    void RenderGraph::set_backbuffer(uint32_t fbo){
+        m_backbuffer = fbo;
+    }
+    const std::vector<uint32_t>& RenderGraph::get_pass_draw_calls() const {
+        return m_pass_draw_calls;
+    }
+    const std::vector<float>& RenderGraph::get_pass_cpu_ms() const {
+        return m_pass_cpu_ms;
+    }
+    const std::map<std::string, GpuTimer>& RenderGraph::get_pass_timers() const {
+        return m_pass_timers;
+    }
+    uint32_t RenderGraph::get_texture(Resource resource) const {
+        auto& node = m_resources.at(resource);
+        if (!node.transient || node.pool_slot < 0)
+            throw std::runtime_error("Render graph resource '" + node.name + "' has no texture");
+        return m_pool[node.pool_slot].texture;
+    }
+    void RenderGraph::draw_fullscreen_triangle() const {
+        // core profile still wants a VAO bound even though there are no attributes
+        glBindVertexArray(m_empty_vao);
+        gl_state::draw_arrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+    }
+    const std::vector<uint32_t>& RenderGraph::get_schedule() const {
+        return m_schedule;
+    }
+    const RenderGraph::Pass& RenderGraph::get_pass(uint32_t index) const {
+        return m_passes.at(index);
+    }
+    const RenderGraph::Stats& RenderGraph::get_stats() const {
+        return m_stats;
+    }
+}
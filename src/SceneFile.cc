@@ -0,0 +1,286 @@
+#include "SceneFile.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace gm::scene {
+    // the columns are written and read straight from memory
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float));
+    // and in host byte order, so a big endian host would write files no one else reads.
+    // MSVC doesn't define these, every target it builds for is little endian
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "scene files are little endian");
+#endif
+    namespace {
+        constexpr size_t COLUMN_SIZES[COLUMN_COUNT] = {
+            sizeof(glm::vec3), sizeof(glm::vec3), sizeof(float), sizeof(float),
+            sizeof(glm::vec3), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t),
+        };
+
+        size_t align_up(size_t offset){
+            return (offset + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+        }
+        void pad_to(std::ofstream& out, uint64_t offset){
+            static const char zeros[COLUMN_ALIGNMENT]{};
+            out.write(zeros, offset - (uint64_t)out.tellp());
+        }
+        template<typename T, typename F>
+        void write_column(std::ofstream& out, size_t n, F get){
+            std::vector<T> column(n);
+            for (size_t i = 0; i < n; i++)
+                column[i] = get(i);
+            out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+        }
+        // every distinct string once, thousands of bodies share a texture path
+        uint32_t intern(std::string& table, std::unordered_map<std::string_view, uint32_t>& seen, const std::string& s){
+            if (s.empty())
+                return NO_STRING;
+            auto [it, inserted] = seen.try_emplace(s, (uint32_t)table.size());
+            if (inserted) {
+                table += s;
+                table += '\0';
+            }
+            return it->second;
+        }
+        // flushes the file out of the page cache, throws when the disk says no
+        void sync_file(const std::filesystem::path& path){
+#ifdef _WIN32
+            auto file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            bool ok = file != INVALID_HANDLE_VALUE && FlushFileBuffers(file);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            bool ok = fd >= 0 && ::fsync(fd) == 0;
+            if (fd >= 0)
+                ::close(fd);
+#endif
+            if (!ok)
+                throw std::runtime_error("Failed to sync " + path.string());
+        }
+        // the rename only survives a power cut once the directory is synced as well, windows has no way to do that
+        void sync_directory(const std::filesystem::path& path){
+#ifndef _WIN32
+            auto dir = path.parent_path().empty() ? std::filesystem::path(".") : path.parent_path();
+            int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+            if (fd >= 0) {
+                ::fsync(fd);
+                ::close(fd);
+            }
+#else
+            (void)path;
+#endif
+        }
+    }
+
+    MappedScene::MappedScene(const std::filesystem::path& path):
+        m_file(path)
+    {
+        auto fail = [&](const std::string& why) {
+            throw std::runtime_error(path.string() + why);
+        };
+        auto size = m_file.size();
+        // as much header as the oldest version has, the flags are only read when the header has them
+        if (size < offsetof(FileHeader, flags))
+            fail(" is not a scene file");
+        m_header = reinterpret_cast<const FileHeader*>(m_file.data());
+        if (std::memcmp(m_header->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+            fail(" is not a scene file");
+        if (m_header->version < OLDEST_FILE_VERSION || m_header->version > FILE_VERSION)
+            fail(" has version " + std::to_string(m_header->version) + ", expected " + std::to_string(OLDEST_FILE_VERSION)
+                + " to " + std::to_string(FILE_VERSION));
+        if (m_header->header_size > size)
+            fail(" is cut short");
+        // checked once here, so the accessors don't have to
+        for (uint32_t c = 0; c < COLUMN_COUNT; c++) {
+            auto offset = m_header->columns[c];
+            if (offset % alignof(float) || offset > size || m_header->bodies > (size - offset) / COLUMN_SIZES[c])
+                fail(" is cut short");
+        }
+        if (m_header->strings > size || m_header->strings_size > size - m_header->strings)
+            fail(" is cut short");
+    }
+    template<typename T>
+    const T* MappedScene::column(Column c) const {
+        return reinterpret_cast<const T*>(m_file.data() + m_header->columns[c]);
+    }
+    std::string_view MappedScene::string(Column c, size_t i) const {
+        auto offset = column<uint32_t>(c)[i];
+        if (offset == NO_STRING || offset >= m_header->strings_size)
+            return {};
+        auto begin = reinterpret_cast<const char*>(m_file.data() + m_header->strings + offset);
+        auto end = static_cast<const char*>(std::memchr(begin, '\0', m_header->strings_size - offset));
+        return end ? std::string_view(begin, end - begin) : std::string_view{};
+    }
+    size_t MappedScene::size() const {
+        return m_header->bodies;
+    }
+    uint64_t MappedScene::get_step() const {
+        return m_header->step;
+    }
+    double MappedScene::get_time() const {
+        return m_header->time;
+    }
+    uint64_t MappedScene::get_flags() const {
+        return m_header->header_size >= sizeof(FileHeader) ? m_header->flags : 0;
+    }
+    const glm::vec3* MappedScene::positions() const {
+        return column<glm::vec3>(Pos);
+    }
+    const glm::vec3* MappedScene::velocities() const {
+        return column<glm::vec3>(Vel);
+    }
+    const float* MappedScene::masses() const {
+        return column<float>(Mass);
+    }
+    const float* MappedScene::radii() const {
+        return column<float>(Radius);
+    }
+    const glm::vec3* MappedScene::colors() const {
+        return column<glm::vec3>(Color);
+    }
+    const uint32_t* MappedScene::flags() const {
+        return column<uint32_t>(Flags);
+    }
+    std::string_view MappedScene::name(size_t i) const {
+        return string(Name, i);
+    }
+    std::string_view MappedScene::texture(size_t i) const {
+        return string(Texture, i);
+    }
+
+    std::filesystem::path step_path(const std::filesystem::path& path, uint64_t step){
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), "_%06llu", (unsigned long long)step);
+        auto numbered = path;
+        numbered.replace_filename(path.stem().string() + suffix + path.extension().string());
+        return numbered;
+    }
+    void save(const std::filesystem::path& path, const SceneData& scene, bool sync, uint64_t flags){
+        auto& bodies = scene.bodies;
+        const size_t n = bodies.size();
+        if ((!scene.colors.empty() && scene.colors.size() != n) || (!scene.names.empty() && scene.names.size() != n)
+            || (!scene.textures.empty() && scene.textures.size() != n))
+            throw std::runtime_error("The scene has colors, names or textures for some bodies only");
+
+        std::string strings{};
+        std::unordered_map<std::string_view, uint32_t> seen{};
+        std::vector<uint32_t> names(n, NO_STRING), textures(n, NO_STRING);
+        for (size_t i = 0; i < n; i++) {
+            if (!scene.names.empty())
+                names[i] = intern(strings, seen, scene.names[i]);
+            if (!scene.textures.empty())
+                textures[i] = intern(strings, seen, scene.textures[i]);
+        }
+
+        FileHeader header{ .version = FILE_VERSION, .header_size = sizeof(FileHeader), .bodies = n, .step = scene.step, .time = scene.time, .flags = flags };
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        uint64_t offset = align_up(sizeof(FileHeader));
+        for (uint32_t c = 0; c < COLUMN_COUNT; c++) {
+            header.columns[c] = offset;
+            offset = align_up(offset + n * COLUMN_SIZES[c]);
+        }
+        if (strings.size() >= NO_STRING)
+            throw std::runtime_error("The names and texture paths don't fit into a scene file");
+        header.strings = offset;
+        header.strings_size = strings.size();
+
+        auto tmp = path;
+        tmp += ".tmp";
+        {
+            auto out = std::ofstream(tmp, std::ios::binary);
+            if (!out)
+                throw std::runtime_error("Failed to open " + tmp.string());
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            auto column = [&](Column c, auto write) {
+                pad_to(out, header.columns[c]);
+                write();
+            };
+            column(Pos, [&] { write_column<glm::vec3>(out, n, [&](size_t i) { return bodies[i].pos; }); });
+            column(Vel, [&] { write_column<glm::vec3>(out, n, [&](size_t i) { return bodies[i].vel; }); });
+            column(Mass, [&] { write_column<float>(out, n, [&](size_t i) { return bodies[i].mass; }); });
+            column(Radius, [&] { write_column<float>(out, n, [&](size_t i) { return bodies[i].radius; }); });
+            column(Color, [&] { write_column<glm::vec3>(out, n, [&](size_t i) { return scene.colors.empty() ? glm::vec3(1.0f) : scene.colors[i]; }); });
+            column(Flags, [&] { write_column<uint32_t>(out, n, [&](size_t i) { return bodies[i].is_star ? FLAG_STAR : 0u; }); });
+            column(Name, [&] { out.write(reinterpret_cast<const char*>(names.data()), n * sizeof(uint32_t)); });
+            column(Texture, [&] { out.write(reinterpret_cast<const char*>(textures.data()), n * sizeof(uint32_t)); });
+            pad_to(out, header.strings);
+            out.write(strings.data(), strings.size());
+            if (!out.flush())
+                throw std::runtime_error("Failed to write " + tmp.string());
+        }
+        if (sync)
+            sync_file(tmp);
+        std::error_code ec{};
+        std::filesystem::rename(tmp, path, ec);
+        if (ec)
+            throw std::runtime_error("Failed to move " + tmp.string() + " to " + path.string() + ": " + ec.message());
+        if (sync)
+            sync_directory(path);
+    }
+    SceneData load(const std::filesystem::path& path){
+        MappedScene mapped(path);
+        const size_t n = mapped.size();
+        SceneData scene{ .bodies = std::vector<gravity::Gravdata>(n), .step = mapped.get_step(), .time = mapped.get_time() };
+        scene.colors.assign(mapped.colors(), mapped.colors() + n);
+        scene.names.resize(n);
+        scene.textures.resize(n);
+        auto pos = mapped.positions();
+        auto vel = mapped.velocities();
+        auto mass = mapped.masses();
+        auto radius = mapped.radii();
+        auto flags = mapped.flags();
+        for (size_t i = 0; i < n; i++) {
+            scene.bodies[i] = gravity::Gravdata {
+                .mass = mass[i],
+                .pos = pos[i],
+                .vel = vel[i],
+                .radius = radius[i],
+                .is_star = (flags[i] & FLAG_STAR) != 0,
+            };
+            scene.names[i] = mapped.name(i);
+            scene.textures[i] = mapped.texture(i);
+        }
+        return scene;
+    }
+    void remove_eaten(SceneData& scene){
+        auto eaten = [](const gravity::Gravdata& b) { return b.mass <= 0.0f; };
+        // nearly every step, and nearly every time nothing got eaten
+        if (std::none_of(scene.bodies.begin(), scene.bodies.end(), eaten))
+            return;
+        size_t kept = 0;
+        for (size_t i = 0; i < scene.bodies.size(); i++) {
+            if (eaten(scene.bodies[i]))
+                continue;
+            scene.bodies[kept] = scene.bodies[i];
+            if (!scene.colors.empty())
+                scene.colors[kept] = scene.colors[i];
+            if (!scene.names.empty())
+                scene.names[kept] = std::move(scene.names[i]);
+            if (!scene.textures.empty())
+                scene.textures[kept] = std::move(scene.textures[i]);
+            kept++;
+        }
+        scene.bodies.resize(kept);
+        if (!scene.colors.empty())
+            scene.colors.resize(kept);
+        if (!scene.names.empty())
+            scene.names.resize(kept);
+        if (!scene.textures.empty())
+            scene.textures.resize(kept);
+    }
+}
@@ -0,0 +1,269 @@
+#include "SceneGen.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+namespace gm::scene {
+    namespace {
+        using gravity::Gravdata;
+        using gravity::SIM_GRAV_CONST;
+        constexpr float TOTAL_MASS = 1000.0f;
+        // not M_PI, that needs _USE_MATH_DEFINES on MSVC and only Object.hpp sets it
+        constexpr float PI = 3.14159265358979323846f;
+
+        // same densities as obj::Planet and obj::Star
+        float body_radius(float mass, bool is_star){
+            return std::pow(mass / ((4.0f / 3.0f) * PI * (is_star ? 1.622f : 5.51f)), 1.0f / 3.0f);
+        }
+        Gravdata make_body(float mass, glm::vec3 pos, glm::vec3 vel, bool is_star = false){
+            return Gravdata {
+                .mass = mass,
+                .pos = pos,
+                .vel = vel,
+                .radius = body_radius(mass, is_star),
+                .is_star = is_star,
+            };
+        }
+        glm::vec3 random_direction(std::mt19937& rng){
+            std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+            float z = u(rng);
+            float phi = (u(rng) + 1.0f) * PI;
+            float s = std::sqrt(1.0f - z * z);
+            return { s * std::cos(phi), z, s * std::sin(phi) };
+        }
+        // moves the center of mass to the origin and stops it from drifting
+        void center(std::vector<Gravdata>& bodies){
+            glm::dvec3 pos(0), vel(0);
+            double mass = 0;
+            for (auto& b : bodies) {
+                pos += glm::dvec3(b.pos) * (double)b.mass;
+                vel += glm::dvec3(b.vel) * (double)b.mass;
+                mass += b.mass;
+            }
+            if (mass <= 0)
+                return;
+            for (auto& b : bodies) {
+                b.pos -= glm::vec3(pos / mass);
+                b.vel -= glm::vec3(vel / mass);
+            }
+        }
+        // a star of STAR_FRACTION of the mass in a disk of n - 1 bodies, scale length SCALE, not centered
+        std::vector<Gravdata> make_exponential_disk(size_t n, float mass, float scale, std::mt19937& rng){
+            constexpr float STAR_FRACTION = 0.3f;
+            // a sixth of the scale length thick, the velocity is off by a few percent so the disk isn't perfectly cold
+            constexpr float SCALE_HEIGHT = 1.0f / 6.0f, VELOCITY_DISPERSION = 0.05f;
+            constexpr float MAX_RADIUS = 6.0f;
+            std::vector<Gravdata> bodies{};
+            if (n == 0)
+                return bodies;
+            bodies.reserve(n);
+            float star_mass = n > 1 ? mass * STAR_FRACTION : mass;
+            float disk_mass = mass - star_mass;
+            bodies.push_back(make_body(star_mass, glm::vec3(0), glm::vec3(0), true));
+            std::uniform_real_distribution<float> u(0.0f, 1.0f);
+            std::normal_distribution<float> normal(0.0f, 1.0f);
+            while (bodies.size() < n) {
+                // the radius of an exponential disk is gamma distributed with k = 2
+                float r = -scale * std::log(std::max(u(rng) * u(rng), 1e-12f));
+                if (r > MAX_RADIUS * scale)
+                    continue;
+                float phi = u(rng) * 2.0f * PI;
+                auto dir = glm::vec3(std::cos(phi), 0.0f, std::sin(phi));
+                auto pos = dir * r + glm::vec3(0.0f, normal(rng) * SCALE_HEIGHT * scale, 0.0f);
+                // the disk mass inside r, treated as if it were spherical
+                float x = r / scale;
+                float enclosed = star_mass + disk_mass * (1.0f - (1.0f + x) * std::exp(-x));
+                float v = std::sqrt(SIM_GRAV_CONST * enclosed / std::max(r, 1e-3f));
+                auto vel = glm::vec3(-dir.z, 0.0f, dir.x) * v + glm::vec3(normal(rng), normal(rng), normal(rng)) * (v * VELOCITY_DISPERSION);
+                bodies.push_back(make_body(disk_mass / (n - 1), pos, vel));
+            }
+            return bodies;
+        }
+        void add_binaries(std::vector<Gravdata>& out, size_t n, float mass, glm::vec3 pos, glm::vec3 vel, float separation, float ratio, std::mt19937& rng){
+            if (n == 1) {
+                out.push_back(make_body(mass, pos, vel));
+                return;
+            }
+            size_t n_1 = n / 2, n_2 = n - n_1;
+            float m_1 = mass * n_1 / n, m_2 = mass * n_2 / n;
+            auto axis = random_direction(rng);
+            // any direction perpendicular to the axis works for a circular orbit
+            auto tangent = glm::normalize(glm::cross(axis, std::abs(axis.y) < 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0)));
+            float v = std::sqrt(SIM_GRAV_CONST * mass / separation);
+            add_binaries(out, n_1, m_1, pos + axis * (separation * m_2 / mass), vel + tangent * (v * m_2 / mass), separation * ratio, ratio, rng);
+            add_binaries(out, n_2, m_2, pos - axis * (separation * m_1 / mass), vel - tangent * (v * m_1 / mass), separation * ratio, ratio, rng);
+        }
+    }
+
+    std::vector<Gravdata> random_cloud(size_t n, uint32_t seed){
+        constexpr float RADIUS = 100.0f;
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        std::vector<Gravdata> bodies{};
+        bodies.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            // cube root keeps the density uniform
+            auto pos = random_direction(rng) * (RADIUS * std::cbrt(u(rng)));
+            bodies.push_back(make_body(TOTAL_MASS / n, pos, glm::vec3(0)));
+        }
+        center(bodies);
+        return bodies;
+    }
+    std::vector<Gravdata> plummer_sphere(size_t n, uint32_t seed){
+        constexpr float SCALE = 20.0f;
+        // nobody further out than this, the tail of the distribution is very long
+        constexpr float MAX_RADIUS = 10.0f * SCALE;
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        std::vector<Gravdata> bodies{};
+        bodies.reserve(n);
+        while (bodies.size() < n) {
+            float x = std::max(u(rng), 1e-6f);
+            float r = SCALE / std::sqrt(std::pow(x, -2.0f / 3.0f) - 1.0f);
+            if (r > MAX_RADIUS)
+                continue;
+            // rejection sampling of v / v_escape from q^2 (1 - q^2)^3.5
+            float q = 0.0f;
+            while (true) {
+                q = u(rng);
+                if (0.1f * u(rng) < q * q * std::pow(1.0f - q * q, 3.5f))
+                    break;
+            }
+            float v_escape = std::sqrt(2.0f * SIM_GRAV_CONST * TOTAL_MASS / SCALE) * std::pow(1.0f + r * r / (SCALE * SCALE), -0.25f);
+            bodies.push_back(make_body(TOTAL_MASS / n, random_direction(rng) * r, random_direction(rng) * (q * v_escape)));
+        }
+        center(bodies);
+        return bodies;
+    }
+    std::vector<Gravdata> disk_with_star(size_t n, uint32_t seed){
+        constexpr float INNER_RADIUS = 20.0f, OUTER_RADIUS = 200.0f;
+        constexpr float PLANET_MASS = 0.01f;
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        std::vector<Gravdata> bodies{};
+        if (n == 0)
+            return bodies;
+        bodies.reserve(n);
+        bodies.push_back(make_body(TOTAL_MASS, glm::vec3(0), glm::vec3(0), true));
+        for (size_t i = 1; i < n; i++) {
+            // uniform over the area of the ring
+            float r = std::sqrt(INNER_RADIUS * INNER_RADIUS + u(rng) * (OUTER_RADIUS * OUTER_RADIUS - INNER_RADIUS * INNER_RADIUS));
+            float phi = u(rng) * 2.0f * PI;
+            auto dir = glm::vec3(std::cos(phi), 0.0f, std::sin(phi));
+            auto pos = dir * r + glm::vec3(0.0f, (u(rng) - 0.5f), 0.0f);
+            auto vel = glm::vec3(-dir.z, 0.0f, dir.x) * std::sqrt(SIM_GRAV_CONST * TOTAL_MASS / r);
+            bodies.push_back(make_body(PLANET_MASS, pos, vel));
+        }
+        center(bodies);
+        return bodies;
+    }
+    std::vector<Gravdata> hierarchical_binaries(size_t n, uint32_t seed){
+        constexpr float SEPARATION = 200.0f, MIN_SEPARATION = 1.0f;
+        std::mt19937 rng(seed);
+        std::vector<Gravdata> bodies{};
+        if (n == 0)
+            return bodies;
+        bodies.reserve(n);
+        // ten times closer per level, unless that would squeeze the deepest pairs below MIN_SEPARATION
+        float depth = std::ceil(std::log2((float)n));
+        float ratio = std::max(0.1f, depth > 0 ? std::pow(MIN_SEPARATION / SEPARATION, 1.0f / depth) : 1.0f);
+        add_binaries(bodies, n, TOTAL_MASS, glm::vec3(0), glm::vec3(0), SEPARATION, ratio, rng);
+        center(bodies);
+        return bodies;
+    }
+    std::vector<Gravdata> exponential_disk(size_t n, uint32_t seed){
+        constexpr float SCALE = 30.0f;
+        std::mt19937 rng(seed);
+        auto bodies = make_exponential_disk(n, TOTAL_MASS, SCALE, rng);
+        center(bodies);
+        return bodies;
+    }
+    std::vector<Gravdata> planetary_ring(size_t n, uint32_t seed){
+        // Saturn's rings reach from about 1.2 to 2.3 planet radii, these are a bit wider so they can be seen
+        constexpr float INNER_RADIUS = 2.0f, OUTER_RADIUS = 4.5f, THICKNESS = 0.02f;
+        constexpr float RING_MASS_FRACTION = 1e-4f;
+        // far enough that its pull barely bends the ring
+        constexpr float STAR_DISTANCE = 300.0f, STAR_MASS_FRACTION = 0.01f;
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        std::vector<Gravdata> bodies{};
+        if (n == 0)
+            return bodies;
+        bodies.reserve(n);
+        auto planet = make_body(TOTAL_MASS, glm::vec3(0), glm::vec3(0));
+        bodies.push_back(planet);
+        if (n > 1) {
+            auto star_mass = TOTAL_MASS * STAR_MASS_FRACTION;
+            auto v = std::sqrt(SIM_GRAV_CONST * (TOTAL_MASS + star_mass) / STAR_DISTANCE);
+            bodies.push_back(make_body(star_mass, glm::vec3(STAR_DISTANCE, 0, 0), glm::vec3(0, 0, v), true));
+        }
+        float particle_mass = TOTAL_MASS * RING_MASS_FRACTION / std::max<size_t>(n - 2, 1);
+        while (bodies.size() < n) {
+            float r = planet.radius * (INNER_RADIUS + u(rng) * (OUTER_RADIUS - INNER_RADIUS));
+            float phi = u(rng) * 2.0f * PI;
+            auto dir = glm::vec3(std::cos(phi), 0.0f, std::sin(phi));
+            auto pos = dir * r + glm::vec3(0.0f, (u(rng) - 0.5f) * THICKNESS * planet.radius, 0.0f);
+            auto vel = glm::vec3(-dir.z, 0.0f, dir.x) * std::sqrt(SIM_GRAV_CONST * TOTAL_MASS / r);
+            bodies.push_back(make_body(particle_mass, pos, vel));
+        }
+        center(bodies);
+        return bodies;
+    }
+    std::vector<Gravdata> colliding_galaxies(size_t n, uint32_t seed){
+        constexpr float SCALE = 20.0f;
+        // they start this far apart and fall in on a parabolic orbit that passes PERICENTER apart
+        constexpr float DISTANCE = 250.0f, PERICENTER = 40.0f;
+        std::mt19937 rng(seed);
+        size_t n_1 = n / 2, n_2 = n - n_1;
+        auto galaxy_1 = make_exponential_disk(n_1, TOTAL_MASS / 2, SCALE, rng);
+        auto galaxy_2 = make_exponential_disk(n_2, TOTAL_MASS / 2, SCALE, rng);
+        // the second one is tilted so the encounter isn't planar
+        constexpr float TILT = PI / 3.0f;
+        for (auto& b : galaxy_2) {
+            auto rotate = [&](glm::vec3 v) {
+                return glm::vec3(v.x, v.y * std::cos(TILT) - v.z * std::sin(TILT), v.y * std::sin(TILT) + v.z * std::cos(TILT));
+            };
+            b.pos = rotate(b.pos);
+            b.vel = rotate(b.vel);
+        }
+        // parabolic relative velocity at DISTANCE, with the angular momentum of one that reaches PERICENTER
+        float v = std::sqrt(2.0f * SIM_GRAV_CONST * TOTAL_MASS / DISTANCE);
+        float v_tangential = std::sqrt(2.0f * SIM_GRAV_CONST * TOTAL_MASS * PERICENTER) / DISTANCE;
+        float v_radial = std::sqrt(std::max(v * v - v_tangential * v_tangential, 0.0f));
+        auto relative_pos = glm::vec3(DISTANCE, 0.0f, 0.0f);
+        auto relative_vel = glm::vec3(-v_radial, 0.0f, v_tangential);
+        std::vector<Gravdata> bodies{};
+        bodies.reserve(n);
+        // equal masses, each moves half of the relative motion
+        for (auto& b : galaxy_1) {
+            b.pos -= relative_pos * 0.5f;
+            b.vel -= relative_vel * 0.5f;
+            bodies.push_back(b);
+        }
+        for (auto& b : galaxy_2) {
+            b.pos += relative_pos * 0.5f;
+            b.vel += relative_vel * 0.5f;
+            bodies.push_back(b);
+        }
+        center(bodies);
+        return bodies;
+    }
+    std::vector<Gravdata> generate(const std::string& name, size_t n, uint32_t seed){
+        if (name == "cloud")
+            return random_cloud(n, seed);
+        if (name == "plummer")
+            return plummer_sphere(n, seed);
+        if (name == "disk")
+            return disk_with_star(n, seed);
+        if (name == "binaries")
+            return hierarchical_binaries(n, seed);
+        if (name == "exp_disk")
+            return exponential_disk(n, seed);
+        if (name == "ring")
+            return planetary_ring(n, seed);
+        if (name == "galaxies")
+            return colliding_galaxies(n, seed);
+        throw std::runtime_error("Unknown scene '" + name + "'");
+    }
+}
@@ -0,0 +1,107 @@
+#include "Simulation.hpp"
+#include "SceneFile.hpp"
+#include "SceneGen.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+namespace gm::sim {
+    namespace {
+        // progress line on stderr at most this often
+        constexpr double REPORT_INTERVAL_S = 1.0;
+
+        void record_frame(record::Recorder& recorder, const scene::SceneData& scene, uint64_t layout){
+            // nobody is watching, so waiting for the disk beats losing steps
+            auto frame = recorder.begin_frame(true);
+            auto& bodies = scene.bodies;
+            frame->step = scene.step;
+            frame->time = scene.time;
+            frame->layout = layout;
+            frame->resize(bodies.size());
+            for (size_t i = 0; i < bodies.size(); i++) {
+                frame->pos[i] = bodies[i].pos;
+                frame->mass[i] = bodies[i].mass;
+                frame->radius[i] = bodies[i].radius;
+                frame->color[i] = scene.colors.empty() ? glm::vec3(1.0f) : scene.colors[i];
+                frame->flags[i] = bodies[i].is_star ? record::FLAG_STAR : 0;
+            }
+            recorder.submit(frame);
+        }
+        scene::SceneData load_scene(const Options& options){
+            if (std::filesystem::is_regular_file(options.scene))
+                return scene::load(options.scene);
+            return scene::SceneData { .bodies = scene::generate(options.scene, options.bodies, options.seed) };
+        }
+    }
+
+    void run(const Options& options){
+        if (options.scene.empty())
+            throw std::runtime_error("The headless simulation needs a --scene (file or generator name)");
+        if (options.output.empty())
+            throw std::runtime_error("The headless simulation needs an --out path");
+        if (options.solver != "pairwise" && options.solver != "leapfrog")
+            throw std::runtime_error("Unknown solver '" + options.solver + "'");
+        if (options.delta_t <= 0.0)
+            throw std::runtime_error("--dt has to be positive");
+        // both number their files with step_path, a checkpoint would overwrite the snapshot of its step
+        if (!options.checkpoint.empty() && options.checkpoint == options.output)
+            throw std::runtime_error("--checkpoint needs another name than --out");
+
+        auto scene = load_scene(options);
+        auto& bodies = scene.bodies;
+        gravity::WorkerPool pool(options.solver == "leapfrog" ? options.threads : 1);
+        std::fprintf(stderr, "simulating %zu bodies for %llu steps of %g s (%s)\n", bodies.size(),
+            (unsigned long long)options.steps, options.delta_t, options.solver.c_str());
+
+        std::unique_ptr<record::Recorder> recorder{};
+        if (!options.record.empty())
+            recorder = std::make_unique<record::Recorder>(options.record, options.record_every);
+        uint64_t layout = 0;
+        std::unique_ptr<scene::CheckpointWriter> checkpoints{};
+        if (!options.checkpoint.empty()) {
+            checkpoints = std::make_unique<scene::CheckpointWriter>(options.checkpoint, options.checkpoint_keep,
+                options.checkpoint_fork ? scene::CheckpointWriter::Mode::Fork : scene::CheckpointWriter::Mode::Thread);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto last_report = start;
+        for (uint64_t s = 1; s <= options.steps; s++) {
+            if (options.solver == "leapfrog") {
+                gravity::step_leapfrog(bodies, options.delta_t, pool, options.softening);
+            } else {
+                gravity::step_pairwise(bodies, options.delta_t, options.collisions);
+                // the game removes the eaten bodies as well
+                auto before = bodies.size();
+                if (options.collisions)
+                    scene::remove_eaten(scene);
+                layout += bodies.size() != before;
+            }
+            scene.step++;
+            scene.time += options.delta_t;
+            if (recorder && recorder->wants(scene.step))
+                record_frame(*recorder, scene, layout);
+            // on the scene's own step, so a resumed run keeps the cadence and the names it had
+            if (options.snapshot_every && scene.step % options.snapshot_every == 0 && s != options.steps)
+                scene::save(scene::step_path(options.output, scene.step), scene);
+            if (checkpoints && options.checkpoint_every && scene.step % options.checkpoint_every == 0)
+                checkpoints->write(scene);
+
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration<double>(now - last_report).count() >= REPORT_INTERVAL_S) {
+                auto elapsed = std::chrono::duration<double>(now - start).count();
+                std::fprintf(stderr, "step %llu/%llu, %zu bodies, %.1f steps/s\n", (unsigned long long)s,
+                    (unsigned long long)options.steps, bodies.size(), s / elapsed);
+                last_report = now;
+            }
+        }
+        scene::save(options.output, scene);
+        if (checkpoints) {
+            auto error = checkpoints->get_error();
+            if (!error.empty())
+                std::fprintf(stderr, "checkpoint failed: %s\n", error.c_str());
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::fprintf(stderr, "done in %.2f s, %zu bodies left, wrote %s\n", elapsed, bodies.size(), options.output.string().c_str());
+    }
+}
@@ -38,7 +38,7 @@
 namespace gm::singl::shader_instances {
     namespace {
         static std::vector<Shader> INSTANCES(static_cast<int>(ShaderInstance::__end));
-        Shader load_shader(const char* vert, const char* frag, const char* geom = nullptr){
+        Shader load_shader(const char* vert, const char* frag, const char* geom = nullptr, const std::string& defines = ""){
 #ifdef DEBUG
             //load directly from source tree -> works without whole project rebuild
             std::string geom_as_str;
@@ -50,13 +50,15 @@ namespace gm::singl::shader_instances {
             auto shader = Shader(
                         std::string(vert),
                         std::string(frag),
-                        geom_ptr
+                        geom_ptr,
+                        defines
                         );
 #else
             auto shader = Shader(
                         vert,
                         frag,
-                        geom
+                        geom,
+                        defines
                         );
 #endif
             return shader;
@@ -64,9 +66,16 @@ namespace gm::singl::shader_instances {
         void load_shader_instance(ShaderInstance instance_name, const char* v, const char* f, const char* g = nullptr){
             INSTANCES[static_cast<int>(instance_name)] = load_shader(v, f, g);
         }
+        // one light pass permutation per shadow quality tier, they only differ in the amount of PCF taps
+        void load_light_pass_instances(){
+            for(int q = 0; q < static_cast<int>(ShadowQuality::__end); q++){
+                auto defines = "#define SHADOW_TAPS " + std::to_string(SHADOW_QUALITY_TAPS[q]) + "\n";
+                INSTANCES[static_cast<int>(ShaderInstance::LightPass) + q] = load_shader(VERT(LIGHT_PASS), FRAG(LIGHT_PASS), nullptr, defines);
+            }
+        }
     }
     void load_all(){
-        load_shader_instance(ShaderInstance::Text3D, VERT(TEXT3D), FRAG(TEXT3D));
+        load_shader_instance(ShaderInstance::TextBatch, VERT(TEXT_BATCH), FRAG(TEXT_BATCH));
         load_shader_instance(ShaderInstance::Star, VERT(STAR), FRAG(STAR));
         load_shader_instance(ShaderInstance::ShadowMap, VERT(SHADOW_MAP), FRAG(SHADOW_MAP), GEOM(SHADOW_MAP));
         load_shader_instance(ShaderInstance::Selected, VERT(SELECTED), FRAG(SELECTED), GEOM(SELECTED));
@@ -75,11 +84,11 @@ namespace gm::singl::shader_instances {
         load_shader_instance(ShaderInstance::PlanetForward, VERT(PLANET_FORWARD), FRAG(PLANET_FORWARD));
         load_shader_instance(ShaderInstance::Trail, VERT(TRAIL), FRAG(TRAIL));
         load_shader_instance(ShaderInstance::Marker, VERT(MARKER), FRAG(MARKER));
-        load_shader_instance(ShaderInstance::Text, VERT(TEXT), FRAG(TEXT));
         load_shader_instance(ShaderInstance::Grid, VERT(GRID), FRAG(GRID));
         load_shader_instance(ShaderInstance::Skybox, VERT(SKYBOX), FRAG(SKYBOX));
-        load_shader_instance(ShaderInstance::LightPass, VERT(LIGHT_PASS), FRAG(LIGHT_PASS));
-        load_shader_instance(ShaderInstance::LightPassSphere, VERT(LIGHT_PASS_SPHERE), FRAG(LIGHT_PASS_SPHERE));
+        load_light_pass_instances();
+        load_shader_instance(ShaderInstance::ImpostorDeferred, VERT(IMPOSTOR), FRAG(IMPOSTOR_DEFERRED));
+        load_shader_instance(ShaderInstance::ImpostorForward, VERT(IMPOSTOR), FRAG(IMPOSTOR_FORWARD));
     };
     void unload_all(){
         INSTANCES.clear();
@@ -87,17 +96,20 @@ namespace gm::singl::shader_instances {
     Shader* get_instance(ShaderInstance ins){
         return &INSTANCES[static_cast<int>(ins)];
     }
+    Shader* light_pass_instance(ShadowQuality quality){
+        return &INSTANCES[static_cast<int>(ShaderInstance::LightPass) + static_cast<int>(quality)];
+    }
 }
 namespace gm::singl::font_instances {
     namespace {
         static font::FontBitmap* INSTANCE = nullptr;
     }
     void load_default_font(){
-        INSTANCE = reinterpret_cast<font::FontBitmap*>(new unsigned char [sizeof(font::FontBitmap)]);
-        *INSTANCE = font::load_font(files::game_data::fonts::ARCADE_TTF, 48);
+        INSTANCE = new font::FontBitmap(font::load_font(files::game_data::fonts::ARCADE_TTF, 48));
     }
     void unload_default_font(){
         delete INSTANCE;
+        INSTANCE = nullptr;
     }
     font::FontBitmap* get_default_font_instance(){
         return INSTANCE;
@@ -113,10 +125,14 @@ namespace gm::singl::buffer_instances {
         load_buffer_instance(BufferInstance::SelectedMarker, static_cast<VertexArrrayObject*>(new obj::SelectedMarkerVAO()));
         load_buffer_instance(BufferInstance::UnitSphere, static_cast<VertexArrrayObject*>(new obj::UnitSphereVAO()));
         load_buffer_instance(BufferInstance::MoveVector, static_cast<VertexArrrayObject*>(new obj::MoveVectorVAO()));
+        load_buffer_instance(BufferInstance::Impostors, static_cast<VertexArrrayObject*>(new obj::ImpostorBatchVAO()));
+        load_buffer_instance(BufferInstance::TrailPool, static_cast<VertexArrrayObject*>(new obj::TrailPool()));
     }
     void unload_all(){
         for(size_t i = 0; i < sizeof(BUFFERS) / sizeof(VertexArrrayObject*); i++){
             delete BUFFERS[i];
+            // things like trails may still outlive the buffers and check for them
+            BUFFERS[i] = nullptr;
         }
     }
 }
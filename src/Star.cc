@@ -1,5 +1,6 @@
 #include "Object.hpp"
 #include "Singletons.hpp"
+#include <algorithm>
 #include <cstddef>
 
 using namespace gm::singl;
@@ -25,11 +26,11 @@ namespace obj {
         } else {
             m_shader->set_int("has_texture", false);
         }
-        m_sphere->draw();
+        m_sphere->draw(m_lod);
         if(render_normals){
             m_normals_shader->use_shader();
             m_normals_shader->set_mat4(name_of(model), model);
-            m_sphere->draw();
+            m_sphere->draw(m_lod);
         }
     }
     void Star::deferred_render() {
@@ -48,13 +49,55 @@ namespace obj {
                          glm::lookAt(m_pos, m_pos + glm::vec3( 0.0, 0.0, 1.0), glm::vec3(0.0,-1.0, 0.0)));
         m_shadow_transforms[5] = (s_shadow_projection *
                          glm::lookAt(m_pos, m_pos + glm::vec3( 0.0, 0.0,-1.0), glm::vec3(0.0,-1.0, 0.0)));
-        auto sh = shader_instances::get_instance(shader_instances::ShaderInstance::ShadowMap);        sh->use_shader();
+        for(size_t i = 0; i < 6; i++){
+            m_shadow_frusta[i] = Frustum::from_matrix(m_shadow_transforms[i]);
+        }
+        auto sh = shader_instances::get_instance(shader_instances::ShaderInstance::ShadowMap);
+        sh->use_shader();
         for(size_t i = 0; i < 6; i++){
             auto name = "shadow_trans[" + std::to_string(i) + "]";
             sh->set_mat4(name.c_str(), m_shadow_transforms[i]);
         }
         sh->set_vec3("current_light_pos", m_pos);
         sh->set_float("far_plane", s_shadow_far_plane);
+        sh->set_int("layer_base", m_shadow_layer * 6);
+    }
+    uint32_t Star::shadow_face_mask(const glm::vec3& center, float radius) const {
+        // the whole sphere is past the far plane of every face
+        if(glm::distance(center, m_pos) - radius > s_shadow_far_plane)
+            return 0;
+        uint32_t mask = 0;
+        for(uint32_t i = 0; i < 6; i++){
+            if(m_shadow_frusta[i].intersects_sphere(center, radius))
+                mask |= 1u << i;
+        }
+        return mask;
+    }
+    uint32_t Star::shadow_lod(const glm::vec3& center, float radius) const {
+        // every face has a 90 degree fov, so one unit at distance 1 spans half of the shadow map
+        auto distance = std::max(glm::distance(center, m_pos) - radius, 1.0f);
+        auto radius_texels = radius / distance * (s_shadow_map_height * 0.5f);
+        return UnitSphereVAO::lod_for_screen_radius(radius_texels);
+    }
+    void Star::reset_shadow_cull_stats() {
+        m_shadow_cull_stats = {};
+    }
+    void Star::record_shadow_caster(uint32_t face_mask) {
+        m_shadow_cull_stats.casters++;
+        if(!face_mask){
+            return;
+        }
+        m_shadow_cull_stats.submitted++;
+        for(uint32_t i = 0; i < 6; i++){
+            if(!(face_mask & (1u << i)))
+                m_shadow_cull_stats.faces_culled++;
+        }
+    }
+    const Star::ShadowCullStats& Star::get_shadow_cull_stats() const {
+        return m_shadow_cull_stats;
+    }
+    gm::GpuTimer& Star::get_shadow_timer() {
+        return m_shadow_timer;
     }
     void Star::update(double& delta_t) {
         CelestialBody::update(delta_t);
@@ -77,8 +120,11 @@ namespace obj {
     float Star::get_attenuation_quadratic() const {
         return m_attenuation_quadratic;
     }
-    uint32_t Star::get_shadow_map_id() const {
-        return m_shadow_cube_map_id;
+    int32_t Star::get_shadow_layer() const {
+        return m_shadow_layer;
+    }
+    void Star::set_shadow_layer(int32_t layer) {
+        m_shadow_layer = layer;
     }
     float Star::get_light_source_radius() const {
         return m_light_source_radius;
@@ -86,9 +132,6 @@ namespace obj {
     const glm::mat4* Star::get_shadow_transforms_ptr() const {
         return &m_shadow_transforms[0];
     }
-    uint32_t Star::get_shadow_map_fbo() const {
-        return m_shadow_map_fbo;
-    }
     float Star::calc_attenuation_linear(float mass) {
         return 1.0 / std::pow(mass + 2.0, 1);
     }
@@ -1,34 +1,147 @@
 #include "Object.hpp"
 #include <algorithm>
+#include <stdexcept>
 #include <Singletons.hpp>
 
 using namespace gm::singl;
 namespace obj{
-    void Trail::fill(glm::vec3 val){
+    TrailPool* TrailPool::instance(){
+        return buffer_instances::get_instance<TrailPool>(buffer_instances::BufferInstance::TrailPool);
+    }
+    TrailPool& TrailPool::get(){
+        auto pool = instance();
+        if (!pool)
+            throw std::runtime_error("The trail pool is used before the buffer instances are loaded or after they were unloaded");
+        return *pool;
+    }
+    void TrailPool::grow(uint32_t min_capacity){
+        auto capacity = std::max(m_capacity * 2, min_capacity);
+        uint32_t buffer{};
+        ::glGenBuffers(1, &buffer);
+        ::glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        ::glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(glm::vec3), NULL, GL_DYNAMIC_DRAW);
+        if(m_vbo){
+            ::glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+            ::glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_used * sizeof(glm::vec3));
+            ::glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            ::glDeleteBuffers(1, &m_vbo);
+        }
+        ::glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_vbo = buffer;
+        m_capacity = capacity;
+    }
+    uint32_t TrailPool::allocate(uint32_t points){
+        // first fit from the released ranges
+        for(auto it = m_free.begin(); it != m_free.end(); it++){
+            if(it->size < points)
+                continue;
+            auto offset = it->offset;
+            it->offset += points;
+            it->size -= points;
+            if(it->size == 0)
+                m_free.erase(it);
+            return offset;
+        }
+        if(m_used + points > m_capacity)
+            grow(m_used + points);
+        auto offset = m_used;
+        m_used += points;
+        return offset;
+    }
+    void TrailPool::release(uint32_t offset, uint32_t points){
+        if(points == 0)
+            return;
+        auto it = std::lower_bound(m_free.begin(), m_free.end(), offset,
+                [](const Range& r, uint32_t o){ return r.offset < o; });
+        it = m_free.insert(it, { offset, points });
+        // merge with the neighbours
+        if(auto next = it + 1; next != m_free.end() && it->offset + it->size == next->offset){
+            it->size += next->size;
+            m_free.erase(next);
+        }
+        if(it != m_free.begin()){
+            auto prev = it - 1;
+            if(prev->offset + prev->size == it->offset){
+                prev->size += it->size;
+                it = m_free.erase(it) - 1;
+            }
+        }
+        // give the tail back so the pool doesn't fragment
+        if(it->offset + it->size == m_used){
+            m_used = it->offset;
+            m_free.erase(it);
+        }
+    }
+    void TrailPool::write(uint32_t offset, const glm::vec3* points, uint32_t count){
         ::glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        ::glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(glm::vec3), count * sizeof(glm::vec3), points);
+        ::glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    void TrailPool::bind() const{
+        VertexArrrayObject::bind();
+        ::glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MOUNT_POINT, m_vbo);
+    }
 
+    void Trail::fill(glm::vec3 val){
         std::fill(m_data.begin(), m_data.end(), val);
-
-        ::glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * m_size, m_data.data(), GL_STATIC_DRAW);
-        ::glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_bounds_min = val;
+        m_bounds_max = val;
+        if(m_size)
+            TrailPool::get().write(m_offset, m_data.data(), m_size);
     }
     void Trail::forward_render() {
+        if(m_size < 2)
+            return;
         auto sh = shader_instances::get_instance(shader_instances::ShaderInstance::Trail);
         sh->use_shader();
         sh->set_vec4("color", m_color);
-        ::glBindVertexArray(m_vao);
-        ::glDrawElements(GL_LINES, (m_size - 1) * 2, GL_UNSIGNED_INT, NULL);
-        ::glBindVertexArray(0);
+        sh->set_uint("trail_offset", m_offset);
+        sh->set_uint("trail_size", m_size);
+        sh->set_uint("trail_head", m_head);
+        auto& pool = TrailPool::get();
+        pool.bind();
+        gm::gl_state::draw_arrays(GL_LINE_STRIP, 0, m_size);
+        pool.unbind();
     }
     void Trail::push_point(glm::vec3 point){
-        for(size_t i = 1; i < m_data.size(); i++){
-            m_data[i - 1] = m_data[i];
-        }
-        m_data.back() = point;
+        if(m_data.empty())
+            return;
+        auto dropped = m_data[m_head];
+        m_data[m_head] = point;
+        TrailPool::get().write(m_offset + m_head, &point, 1);
+        m_head = (m_head + 1) % m_size;
 
-        ::glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        ::glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * m_size, m_data.data(), GL_STATIC_DRAW);
-        ::glBindBuffer(GL_ARRAY_BUFFER, 0);
+        // the bounds only need a rebuild when the dropped point was holding them up
+        auto on_bounds = [&](const glm::vec3& p) {
+            return p.x == m_bounds_min.x || p.y == m_bounds_min.y || p.z == m_bounds_min.z
+                || p.x == m_bounds_max.x || p.y == m_bounds_max.y || p.z == m_bounds_max.z;
+        };
+        if(on_bounds(dropped)){
+            recalculate_bounds();
+        } else {
+            m_bounds_min = glm::min(m_bounds_min, point);
+            m_bounds_max = glm::max(m_bounds_max, point);
+        }
+    }
+    void Trail::recalculate_bounds(){
+        if(m_data.empty())
+            return;
+        m_bounds_min = m_data.front();
+        m_bounds_max = m_data.front();
+        for(auto& p : m_data){
+            m_bounds_min = glm::min(m_bounds_min, p);
+            m_bounds_max = glm::max(m_bounds_max, p);
+        }
+    }
+    void Trail::release(){
+        // the only place that may run after unload_all, see TrailPool::get
+        if(m_size)
+            if(auto pool = TrailPool::instance(); pool)
+                pool->release(m_offset, m_size);
+        m_size = 0;
+        m_offset = 0;
+        m_head = 0;
+        m_data.clear();
     }
     glm::vec4 Trail::get_color() const{
         return m_color;
@@ -37,24 +150,23 @@ namespace obj{
         m_color = color;
     }
     void Trail::copy_from_vector(const std::vector<glm::vec3>& vec){
-        m_size = vec.size();
-        ::glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-
-        ::glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * m_size, vec.data(), GL_STATIC_DRAW);
-
-        ::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-
-        std::vector<uint32_t> ebo_data;
-
-        for(size_t i = 0; i < m_size - 1; i++){
-            ebo_data.push_back(i);
-            ebo_data.push_back(i + 1);
+        if(vec.size() != m_size){
+            release();
+            m_size = vec.size();
+            m_offset = TrailPool::get().allocate(m_size);
         }
-
-        ::glBufferData(GL_ELEMENT_ARRAY_BUFFER, ebo_data.size() * sizeof(uint32_t), ebo_data.data(), GL_STATIC_DRAW);
+        m_data = vec;
+        m_head = 0;
+        recalculate_bounds();
+        if(m_size)
+            TrailPool::get().write(m_offset, m_data.data(), m_size);
     }
 
     std::size_t Trail::size() const {
         return m_size;
     };
+    std::tuple<glm::vec3, float> Trail::get_bounding_sphere() const {
+        auto center = (m_bounds_min + m_bounds_max) * 0.5f;
+        return {center, glm::length(m_bounds_max - center)};
+    }
 }
@@ -1,77 +1,67 @@
 #include "Font.hpp"
 #include "Object.hpp"
+#include <utility>
 
 namespace obj{
 
+    TrailPool::TrailPool(){
+        // the points are pulled from the storage buffer in the vertex shader, no attributes needed
+        ::glGenVertexArrays(1, &m_vao);
+        grow(INITIAL_CAPACITY);
+    }
+    TrailPool::TrailPool(TrailPool&& other): VertexArrrayObject(std::move(other))
+        , m_capacity(other.m_capacity)
+        , m_used(other.m_used)
+        , m_free(std::move(other.m_free))
+    {
+        other.m_capacity = 0;
+        other.m_used = 0;
+    }
+    TrailPool& TrailPool::operator=(TrailPool&& other){
+        VertexArrrayObject::operator=(std::move(other));
+        m_capacity = std::exchange(other.m_capacity, 0);
+        m_used = std::exchange(other.m_used, 0);
+        m_free = std::move(other.m_free);
+        return *this;
+    }
+    TrailPool::~TrailPool(){}
+
     Trail::Trail(){}
 
     Trail::Trail(uint32_t points):
+        m_offset(TrailPool::get().allocate(points)),
         m_size(points),
         m_data(m_size)
     {
-        ::glGenVertexArrays(1, &m_vao);
-
-        ::glGenBuffers(1, &m_vbo);
-        ::glGenBuffers(1, &m_ebo);
-
-        ::glBindVertexArray(m_vao);
-
-        ::glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        ::glBufferData(GL_ARRAY_BUFFER, m_size * sizeof(glm::vec3), NULL, GL_STATIC_DRAW);
-        ::glEnableVertexAttribArray(0);
-        ::glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-
-        ::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-
-        std::vector<uint32_t> ebo_data;
-
-        for(size_t i = 0; i < m_size - 1; i++){
-            ebo_data.push_back(i);
-            ebo_data.push_back(i + 1);
-        }
-
-        ::glBufferData(GL_ELEMENT_ARRAY_BUFFER, ebo_data.size() * sizeof(uint32_t), ebo_data.data(), GL_STATIC_DRAW);
-
-
-        ::glBindVertexArray(0);
-        ::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
     Trail::Trail(Trail&& other):
-        m_vao(other.m_vao)
-        , m_vbo(other.m_vbo)
-        , m_ebo(other.m_ebo)
+        m_offset(other.m_offset)
+        , m_head(other.m_head)
         , m_size(other.m_size)
-        , m_data(other.m_data)
+        , m_data(std::move(other.m_data))
+        , m_color(other.m_color)
+        , m_bounds_min(other.m_bounds_min)
+        , m_bounds_max(other.m_bounds_max)
     {
-        other.m_vao = 0;
-        other.m_vbo = 0;
-        other.m_ebo = 0;
+        other.m_size = 0;
+        other.m_data.clear();
     }
     Trail& Trail::operator=(Trail&& other){
-        m_vao = other.m_vao;
-        m_vbo = other.m_vbo;
-        m_ebo = other.m_ebo;
+        release();
+        m_offset = other.m_offset;
+        m_head = other.m_head;
         m_size = other.m_size;
-        m_data = other.m_data;
+        m_data = std::move(other.m_data);
+        m_color = other.m_color;
+        m_bounds_min = other.m_bounds_min;
+        m_bounds_max = other.m_bounds_max;
 
-        other.m_vao = 0;
-        other.m_vbo = 0;
-        other.m_ebo = 0;
+        other.m_size = 0;
+        other.m_data.clear();
 
         return *this;
     }
     Trail::~Trail(){
-        if(m_vao){
-            ::glDeleteVertexArrays(1, &m_vao);
-            m_vao = 0;
-        }
-        if(m_vbo){
-            ::glDeleteBuffers(1, &m_vbo);
-            m_vbo = 0;
-        }
-        if(m_ebo){
-            ::glDeleteBuffers(1, &m_ebo);
-            m_ebo = 0;
-        }
+        release();
     }
 }
@@ -1,4 +1,5 @@
 #include "Object.hpp"
+#include <cstddef>
 #include <cstdio>
 #include <glm/fwd.hpp>
 
@@ -46,4 +47,28 @@ namespace obj {
     }
     SelectedMarkerVAO::~SelectedMarkerVAO() {
     }
+    ImpostorBatchVAO::ImpostorBatchVAO() {
+        ::glGenVertexArrays(1, &m_vao);
+        ::glGenBuffers(1, &m_vbo);
+
+        ::glBindVertexArray(m_vao);
+        ::glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+        // center and radius packed into one vec4, then the color
+        ::glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ImpostorData), (void*)offsetof(ImpostorData, center));
+        ::glEnableVertexAttribArray(0);
+        ::glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ImpostorData), (void*)offsetof(ImpostorData, color));
+        ::glEnableVertexAttribArray(1);
+
+        ::glBindBuffer(GL_ARRAY_BUFFER, 0);
+        ::glBindVertexArray(0);
+    }
+    ImpostorBatchVAO::ImpostorBatchVAO(ImpostorBatchVAO&& other): VertexArrrayObject(std::move(other)) {
+    }
+    ImpostorBatchVAO& ImpostorBatchVAO::operator=(ImpostorBatchVAO&& other){
+        VertexArrrayObject::operator=(std::move(other));
+        return *this;
+    }
+    ImpostorBatchVAO::~ImpostorBatchVAO() {
+    }
 }
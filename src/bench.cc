@@ -0,0 +1,306 @@
+// islands_bench: runs the gravity kernels over the generated scenes without a window and
+// prints the results as JSON, one object per scene/solver/body count/thread count
+#include "Gravity.hpp"
+#include "SceneGen.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace gm;
+
+namespace {
+    constexpr double DELTA_T = 1.0 / 60.0;
+    constexpr float SOFTENING = 0.5f;
+    // the energy is O(N^2) as well, above this it would take longer than the run itself
+    constexpr size_t ENERGY_MAX_BODIES = 50000;
+    // predictor is the game kernel with collisions, like the selected body's trajectory prediction runs it
+    const char* SOLVER_NAMES[] = { "pairwise", "predictor", "leapfrog" };
+
+    struct Options {
+        std::vector<std::string> scenes{ std::begin(scene::SCENE_NAMES), std::end(scene::SCENE_NAMES) };
+        std::vector<std::string> solvers{ std::begin(SOLVER_NAMES), std::end(SOLVER_NAMES) };
+        size_t min_bodies{ 10 };
+        size_t max_bodies{ 1000000 };
+        uint32_t max_threads{ std::max(1u, std::thread::hardware_concurrency()) };
+        // pair interactions to aim for per run, small scenes get more steps
+        double target_interactions{ 2e8 };
+        uint32_t max_steps{ 1000 };
+        // every run is timed this often from a fresh scene, the fastest one is reported
+        uint32_t repeat{ 1 };
+        // configurations predicted to take longer per step than this are skipped
+        double max_step_seconds{ 5.0 };
+        uint32_t seed{ 1 };
+        std::string output{};
+    };
+    struct Result {
+        std::string scene{}, solver{};
+        size_t bodies{};
+        uint32_t threads{}, steps{};
+        double seconds{};
+        double interactions_per_second{};
+        double ns_per_body_step{};
+        // relative like in gravity::DriftMonitor, not measured when measured is false
+        bool measured{};
+        double energy_drift{}, momentum_drift{}, angular_momentum_drift{};
+        double virial_start{}, virial_end{};
+        bool skipped{};
+    };
+
+    std::vector<std::string> split_list(const std::string& s){
+        std::vector<std::string> out{};
+        std::stringstream ss(s);
+        for (std::string item; std::getline(ss, item, ',');)
+            if (!item.empty())
+                out.push_back(item);
+        return out;
+    }
+    void print_usage(){
+        std::printf(
+            "usage: islands_bench [options]\n"
+            "  --scenes a,b          cloud, plummer, disk, binaries, exp_disk, ring, galaxies (default: all)\n"
+            "  --solvers a,b         pairwise (the game kernel, single threaded), predictor (the game kernel with\n"
+            "                        collisions, as the trajectory prediction runs it), leapfrog (default: all)\n"
+            "  --min-bodies N        smallest body count, grows 10x per run (default: 10)\n"
+            "  --max-bodies N        largest body count (default: 1000000)\n"
+            "  --max-threads N       thread counts go 1, 2, 4 ... up to this (default: all cores)\n"
+            "  --max-step-seconds S  skip runs predicted to take longer per step (default: 5)\n"
+            "  --max-steps N         cap on steps per run (default: 1000)\n"
+            "  --repeat N            time every run N times and report the fastest (default: 1)\n"
+            "  --seed N              scene seed (default: 1)\n"
+            "  --output PATH         write the JSON here instead of stdout\n"
+            "interactions are unordered body pairs per second, energy drift is |E_end - E_start| / |E_start|,\n"
+            "momentum drifts are |P_end - P_start| / sum |m v| (the larger sum of start and end, so a scene at rest\n"
+            "still gets a scale) and the same for the angular momentum\n");
+    }
+    [[noreturn]] void usage_error(const std::string& message){
+        std::fprintf(stderr, "islands_bench: %s\n", message.c_str());
+        print_usage();
+        std::exit(1);
+    }
+    Options parse_options(int argc, char** argv){
+        Options o{};
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--scenes")
+                o.scenes = split_list(value());
+            else if (arg == "--solvers")
+                o.solvers = split_list(value());
+            else if (arg == "--min-bodies")
+                o.min_bodies = std::max<size_t>(std::stoull(value()), 2);
+            else if (arg == "--max-bodies")
+                o.max_bodies = std::stoull(value());
+            else if (arg == "--max-threads")
+                o.max_threads = std::max<uint32_t>(std::stoul(value()), 1);
+            else if (arg == "--max-step-seconds")
+                o.max_step_seconds = std::stod(value());
+            else if (arg == "--max-steps")
+                o.max_steps = std::max<uint32_t>(std::stoul(value()), 1);
+            else if (arg == "--repeat")
+                o.repeat = std::max<uint32_t>(std::stoul(value()), 1);
+            else if (arg == "--seed")
+                o.seed = std::stoul(value());
+            else if (arg == "--output")
+                o.output = value();
+            else if (arg == "--help" || arg == "-h") {
+                print_usage();
+                std::exit(0);
+            } else
+                throw std::runtime_error("Unknown option " + arg);
+        }
+        // checked before anything runs, a typo would otherwise only show after the sweeps before it
+        auto known = [](const std::string& name, auto& names) {
+            return std::find(std::begin(names), std::end(names), name) != std::end(names);
+        };
+        for (auto& s : o.scenes)
+            if (!known(s, scene::SCENE_NAMES))
+                usage_error("Unknown scene '" + s + "'");
+        for (auto& s : o.solvers)
+            if (!known(s, SOLVER_NAMES))
+                usage_error("Unknown solver '" + s + "'");
+        return o;
+    }
+    std::vector<uint32_t> thread_counts(uint32_t max){
+        std::vector<uint32_t> counts{};
+        for (uint32_t t = 1; t < max; t *= 2)
+            counts.push_back(t);
+        counts.push_back(max);
+        return counts;
+    }
+    double pair_count(size_t n){
+        return (double)n * (double)(n - 1) / 2.0;
+    }
+
+    Result run(const Options& o, const std::string& scene_name, const std::string& solver, size_t n, uint32_t threads, double predicted_step_s){
+        Result r{ .scene = scene_name, .solver = solver, .bodies = n, .threads = threads };
+        if (predicted_step_s > o.max_step_seconds) {
+            r.skipped = true;
+            return r;
+        }
+        r.measured = n <= ENERGY_MAX_BODIES;
+        r.steps = (uint32_t)std::clamp(o.target_interactions / pair_count(n), 1.0, (double)o.max_steps);
+        gravity::WorkerPool pool(threads);
+        std::vector<gravity::Gravdata> bodies{};
+        gravity::DriftMonitor monitor{};
+        // every kernel against what it conserves, see gravity::measure_pairwise
+        auto measure = [&]() {
+            return solver == "leapfrog" ? gravity::measure(bodies, pool, SOFTENING) : gravity::measure_pairwise(bodies, pool, DELTA_T);
+        };
+        for (uint32_t rep = 0; rep < o.repeat; rep++) {
+            bodies = scene::generate(scene_name, n, o.seed);
+            monitor.reset();
+            if (r.measured)
+                monitor.add(measure());
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t s = 0; s < r.steps; s++) {
+                if (solver == "leapfrog")
+                    gravity::step_leapfrog(bodies, DELTA_T, pool, SOFTENING);
+                else
+                    gravity::step_pairwise(bodies, DELTA_T, solver == "predictor");
+            }
+            auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            r.seconds = rep ? std::min(r.seconds, seconds) : seconds;
+        }
+        r.interactions_per_second = pair_count(n) * r.steps / r.seconds;
+        r.ns_per_body_step = r.seconds * 1e9 / ((double)n * r.steps);
+        if (r.measured) {
+            r.virial_start = monitor.get_last_invariants().virial_ratio();
+            monitor.add(measure());
+            r.energy_drift = std::abs(monitor.get_last(gravity::DriftMonitor::Energy));
+            r.momentum_drift = monitor.get_last(gravity::DriftMonitor::Momentum);
+            r.angular_momentum_drift = monitor.get_last(gravity::DriftMonitor::AngularMomentum);
+            r.virial_end = monitor.get_last(gravity::DriftMonitor::VirialRatio);
+        }
+        return r;
+    }
+    // timings are only comparable between runs of the same build on the same machine, so the
+    // report says which one it came from and the perf gate checks it
+    std::string build_type(){
+#ifdef ISLANDS_BUILD_TYPE
+        return *ISLANDS_BUILD_TYPE ? ISLANDS_BUILD_TYPE : "unknown";
+#else
+        return "unknown";
+#endif
+    }
+    std::string compiler(){
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+        return "unknown";
+#endif
+    }
+    std::string cpu(){
+#ifdef _WIN32
+        if (auto id = std::getenv("PROCESSOR_IDENTIFIER"))
+            return id;
+#else
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        for (std::string line; std::getline(cpuinfo, line);) {
+            if (line.rfind("model name", 0) == 0) {
+                auto value = line.find_first_not_of(" \t:", line.find(':'));
+                if (value != std::string::npos)
+                    return line.substr(value);
+            }
+        }
+#endif
+        return "unknown";
+    }
+    std::string json_string(const std::string& s){
+        std::string out = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if ((unsigned char)c >= 0x20)
+                out += c;
+        }
+        return out + "\"";
+    }
+    void write_json(std::ostream& os, const std::vector<Result>& results){
+        os << "{\n  \"benchmark\": \"islands_bench\",\n"
+           << "  \"build_type\": " << json_string(build_type()) << ",\n"
+           << "  \"compiler\": " << json_string(compiler()) << ",\n"
+           << "  \"cpu\": " << json_string(cpu()) << ",\n"
+           << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+           << "  \"delta_t\": " << DELTA_T << ",\n"
+           << "  \"leapfrog_softening\": " << SOFTENING << ",\n"
+           << "  \"results\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            auto& r = results[i];
+            os << (i ? ",\n" : "\n") << "    {\"scene\": \"" << r.scene << "\", \"solver\": \"" << r.solver
+               << "\", \"bodies\": " << r.bodies << ", \"threads\": " << r.threads;
+            if (r.skipped) {
+                os << ", \"skipped\": true}";
+                continue;
+            }
+            os << ", \"steps\": " << r.steps << ", \"seconds\": " << r.seconds
+               << ", \"interactions_per_second\": " << r.interactions_per_second
+               << ", \"ns_per_body_step\": " << r.ns_per_body_step;
+            if (!r.measured) {
+                os << ", \"energy_drift\": null}";
+                continue;
+            }
+            // leapfrog keeps the Newtonian invariants of softened gravity, the game kernel those of bodies
+            // with unit inertia in an unsoftened potential scaled by 1 / delta_t
+            os << ", \"invariants\": \"" << (r.solver == "leapfrog" ? "newtonian softened" : "unit inertia, potential / delta_t") << "\""
+               << ", \"energy_drift\": " << r.energy_drift << ", \"momentum_drift\": " << r.momentum_drift
+               << ", \"angular_momentum_drift\": " << r.angular_momentum_drift
+               << ", \"virial_ratio_start\": " << r.virial_start << ", \"virial_ratio_end\": " << r.virial_end << "}";
+        }
+        os << "\n  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try {
+        auto o = parse_options(argc, argv);
+        std::vector<Result> results{};
+        for (auto& scene_name : o.scenes) {
+            for (auto& solver : o.solvers) {
+                // the game kernel is serial
+                auto threads = solver != "leapfrog" ? std::vector<uint32_t> { 1 } : thread_counts(o.max_threads);
+                for (auto t : threads) {
+                    // seconds per pair interaction of the last finished run, for predicting the next one
+                    double pair_cost = 0.0;
+                    for (size_t n = o.min_bodies; n <= o.max_bodies; n *= 10) {
+                        auto r = run(o, scene_name, solver, n, t, pair_cost * pair_count(n));
+                        if (!r.skipped)
+                            pair_cost = 1.0 / r.interactions_per_second;
+                        std::fprintf(stderr, "%s %s N=%zu threads=%u: %s\n", scene_name.c_str(), solver.c_str(), n, t,
+                            r.skipped ? "skipped" : (std::to_string(r.ns_per_body_step) + " ns/body-step").c_str());
+                        results.push_back(std::move(r));
+                    }
+                }
+            }
+        }
+        if (o.output.empty()) {
+            write_json(std::cout, results);
+        } else {
+            auto out = std::ofstream(o.output);
+            if (!out)
+                throw std::runtime_error("Failed to open " + o.output);
+            write_json(out, results);
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "islands_bench: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
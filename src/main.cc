@@ -1,12 +1,171 @@
 #include "Game.hpp"
+#include "Simulation.hpp"
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
-int main(void) {
+namespace {
+    const char* USAGE =
+        "usage: islands [--scene FILE|NAME [--bodies N] [--seed N]] [--save-scene PATH] [--frame-csv PATH]\n"
+        "               [--record PATH [--record-every N]] [--replay PATH] [--checkpoint PATH [--checkpoint-every N] [--checkpoint-keep N]]\n"
+        "       islands --headless SCRIPT [--frames N] [--output PATH] [--trace PATH] [--frame-csv PATH] [--replay PATH]\n"
+        "       islands --headless --scene FILE|NAME [--bodies N] [--seed N] --steps N --dt X --out PATH\n"
+        "               [--snapshot-every N] [--solver pairwise|leapfrog] [--threads N] [--collisions 0|1]\n"
+        "               [--record PATH [--record-every N]] [--checkpoint PATH [--checkpoint-every N] [--checkpoint-keep N] [--checkpoint-fork 0|1]]";
+
+    struct Options {
+        std::optional<gm::HeadlessOptions> headless{};
+        // --headless without a script, only the simulation runs
+        bool simulate{};
+        gm::sim::Options sim{};
+        std::filesystem::path frame_csv{};
+        // scene file or generated scene replacing the starting one, see gm::scene::SCENE_NAMES
+        std::string scene{};
+        // written when the game exits
+        std::filesystem::path save_scene{};
+        std::filesystem::path record{};
+        uint32_t record_every{ gm::record::Recorder::DEFAULT_INTERVAL };
+        // plays the recording instead of the scene
+        std::filesystem::path replay{};
+        std::filesystem::path checkpoint{};
+        uint64_t checkpoint_every{ 1000 };
+        uint32_t checkpoint_keep{ gm::scene::CheckpointWriter::DEFAULT_KEEP };
+        size_t scene_bodies{ 1000 };
+        uint32_t scene_seed{ 1 };
+    };
+    Options parse_options(int argc, char** argv){
+        Options options{};
+        // the mode can come after its options, so they are all taken first and checked against it below
+        gm::HeadlessOptions script{};
+        bool has_script = false;
+        std::vector<std::string> given{};
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--headless" && (i + 1 >= argc || std::string(argv[i + 1]).rfind("--", 0) == 0)) {
+                options.simulate = true;
+                continue;
+            }
+            if (i + 1 >= argc)
+                throw std::runtime_error(std::string("Missing value for ") + arg + "\n" + USAGE);
+            std::string value = argv[++i];
+            given.push_back(arg);
+            if (arg == "--headless") {
+                script.script = value;
+                has_script = true;
+            } else if (arg == "--steps") {
+                options.sim.steps = std::stoull(value);
+            } else if (arg == "--dt") {
+                options.sim.delta_t = std::stod(value);
+            } else if (arg == "--out") {
+                options.sim.output = value;
+            } else if (arg == "--snapshot-every") {
+                options.sim.snapshot_every = std::stoull(value);
+            } else if (arg == "--solver") {
+                options.sim.solver = value;
+            } else if (arg == "--threads") {
+                options.sim.threads = (uint32_t)std::max(1ul, std::stoul(value));
+            } else if (arg == "--collisions") {
+                options.sim.collisions = value != "0";
+            } else if (arg == "--checkpoint-fork") {
+                options.sim.checkpoint_fork = value != "0";
+            } else if (arg == "--frame-csv") {
+                options.frame_csv = value;
+            } else if (arg == "--scene") {
+                options.scene = value;
+            } else if (arg == "--save-scene") {
+                options.save_scene = value;
+            } else if (arg == "--record") {
+                options.record = value;
+            } else if (arg == "--record-every") {
+                options.record_every = std::stoul(value);
+            } else if (arg == "--replay") {
+                options.replay = value;
+            } else if (arg == "--checkpoint") {
+                options.checkpoint = value;
+            } else if (arg == "--checkpoint-every") {
+                options.checkpoint_every = std::stoull(value);
+            } else if (arg == "--checkpoint-keep") {
+                options.checkpoint_keep = std::stoul(value);
+            } else if (arg == "--bodies") {
+                options.scene_bodies = std::stoull(value);
+            } else if (arg == "--seed") {
+                options.scene_seed = std::stoul(value);
+            } else if (arg == "--frames") {
+                script.frames = std::stoul(value);
+            } else if (arg == "--output") {
+                script.output = value;
+            } else if (arg == "--trace") {
+                script.trace = value;
+            } else {
+                throw std::runtime_error("Unknown option " + arg + "\n" + USAGE);
+            }
+        }
+        if (has_script)
+            options.headless = script;
+
+        auto reject = [&](bool mode, std::initializer_list<const char*> args, const char* reason) {
+            if (!mode)
+                return;
+            for (auto arg : args)
+                if (std::find(given.begin(), given.end(), arg) != given.end())
+                    throw std::runtime_error(std::string(arg) + reason + "\n" + USAGE);
+        };
+        reject(!options.simulate, { "--steps", "--dt", "--out", "--snapshot-every", "--solver", "--threads",
+            "--collisions", "--checkpoint-fork" }, " only works with --headless without a script");
+        reject(!has_script, { "--frames", "--output", "--trace" }, " only works with --headless SCRIPT");
+        // the simulation has no game to replay into, save from or time frames of
+        reject(options.simulate, { "--replay", "--save-scene", "--frame-csv" }, " can't be used with --headless without a script");
+        return options;
+    }
+    void run(gm::Game& game, const Options& options){
+        if (!options.frame_csv.empty())
+            game.stream_frame_times(options.frame_csv);
+        if (std::filesystem::is_regular_file(options.scene))
+            game.load_scene(options.scene, true);
+        else if (!options.scene.empty())
+            game.generate_scene(options.scene, options.scene_bodies, options.scene_seed, true);
+        if (!options.replay.empty())
+            game.start_replay(options.replay);
+        if (!options.record.empty())
+            game.start_recording(options.record, options.record_every);
+        if (!options.checkpoint.empty())
+            game.start_checkpoints(options.checkpoint, options.checkpoint_every, options.checkpoint_keep);
+        game.run();
+        game.stop_recording();
+        game.stop_checkpoints();
+        if (!options.save_scene.empty())
+            game.save_scene(options.save_scene);
+    }
+}
+
+int main(int argc, char** argv) {
     try{
+        auto options = parse_options(argc, argv);
+        if (options.simulate) {
+            // no Game, so no window, GL context or monitor needed
+            options.sim.scene = options.scene;
+            options.sim.bodies = options.scene_bodies;
+            options.sim.seed = options.scene_seed;
+            options.sim.record = options.record;
+            options.sim.record_every = options.record_every;
+            options.sim.checkpoint = options.checkpoint;
+            options.sim.checkpoint_every = options.checkpoint_every;
+            options.sim.checkpoint_keep = options.checkpoint_keep;
+            gm::sim::run(options.sim);
+            return 0;
+        }
+        if (options.headless) {
+            gm::Game game(*options.headless);
+            run(game, options);
+            return 0;
+        }
         gm::Game game;
-        game.run();
-    } catch(const std::runtime_error& e){
+        run(game, options);
+    } catch(const std::exception& e){
         std::cerr << e.what() << std::endl;
         return 1;
     }
@@ -1,10 +1,26 @@
 #include "Font.hpp"
+#include "GlState.hpp"
 #include <cstdio>
 #include <glm/gtc/type_ptr.hpp>
 #include <shader/Shader.hpp>
 #include <sstream>
 
 constexpr const char* SHADER_DIR_PREFIX = "./game_data/shaders/";
+namespace {
+    std::string with_defines(std::string src, const std::string& defines){
+        if(defines.empty())
+            return src;
+        // #version has to stay the very first statement
+        auto pos = src.find("#version");
+        pos = pos == std::string::npos ? 0 : src.find('\n', pos);
+        if(pos == std::string::npos){
+            src += '\n';
+            pos = src.size() - 1;
+        }
+        src.insert(pos + 1, defines);
+        return src;
+    }
+}
 Shader::Shader() {
 
 }
@@ -29,14 +45,18 @@ Shader& Shader::operator=(Shader&& other){
 }
 Shader::~Shader(){
     if(m_shader_id){
-        glDeleteShader(m_shader_id);
+        gm::gl_state::forget_program(m_shader_id);
+        glDeleteProgram(m_shader_id);
         m_shader_id = 0;
     }
 }
-Shader::Shader(const char* vert, const char* frag, const char* geom) try {
-    const char* vert_char_ptr = vert;
-    const char* frag_char_ptr = frag;
-    const char* geom_char_ptr = geom;
+Shader::Shader(const char* vert, const char* frag, const char* geom, const std::string& defines) try {
+    std::string vert_src = with_defines(vert, defines);
+    std::string frag_src = with_defines(frag, defines);
+    std::string geom_src = geom ? with_defines(geom, defines) : std::string();
+    const char* vert_char_ptr = vert_src.c_str();
+    const char* frag_char_ptr = frag_src.c_str();
+    const char* geom_char_ptr = geom_src.c_str();
 
     std::uint32_t vert_id, frag_id, geom_id{};
     int succ;
@@ -109,7 +129,7 @@ Shader::Shader(const char* vert, const char* frag, const char* geom) try {
     throw std::runtime_error{std::move(err_msg)};
 }
 
-Shader::Shader(const std::string& vert_path, const std::string& frag_path, const std::string* geom_path) try {
+Shader::Shader(const std::string& vert_path, const std::string& frag_path, const std::string* geom_path, const std::string& defines) try {
     /*std::cout << "vert_path: " << vert_path << "\nfrag_path: " << frag_path << '\n';*/
     std::ifstream vert_file;
     std::ifstream frag_file;
@@ -135,8 +155,10 @@ Shader::Shader(const std::string& vert_path, const std::string& frag_path, const
         geom_src = geom_stream.str();
     }
 
-    std::string vert_src = vert_stream.str();
-    std::string frag_src = frag_stream.str();
+    std::string vert_src = with_defines(vert_stream.str(), defines);
+    std::string frag_src = with_defines(frag_stream.str(), defines);
+    if(geom_path != nullptr)
+        geom_src = with_defines(std::move(geom_src), defines);
 
     const char* vert_char_ptr = vert_src.c_str();
     const char* frag_char_ptr = frag_src.c_str();
@@ -230,7 +252,7 @@ Shader Shader::from_shader_dir(const std::string& name) {
     return Shader(vert, frag);
 }
 void Shader::use_shader() const {
-    glUseProgram(m_shader_id);
+    gm::gl_state::use_program(m_shader_id);
 }
 void Shader::set_vec2(const char* uniform_name, const glm::vec2& v) {
     int loc = glGetUniformLocation(m_shader_id, uniform_name);
@@ -256,6 +278,10 @@ void Shader::set_int(const char* uniform_name, int i) {
     int loc = glGetUniformLocation(m_shader_id, uniform_name);
     glUniform1i(loc, i);
 }
+void Shader::set_uint(const char* uniform_name, uint32_t u) {
+    int loc = glGetUniformLocation(m_shader_id, uniform_name);
+    glUniform1ui(loc, u);
+}
 void Shader::set_float(const char* uniform_name, float f) {
     int loc = glGetUniformLocation(m_shader_id, uniform_name);
     glUniform1f(loc, f);
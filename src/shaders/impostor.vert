@@ -0,0 +1,31 @@
+#version 460 core
+
+layout (location = 0) in vec4 center_radius;
+layout (location = 1) in vec3 color;
+
+uniform float viewport_height;
+
+layout(std140, binding = 0) uniform Matrices {
+    mat4 view;
+    mat4 projection;
+};
+
+out Impostor {
+    flat vec3 Center;
+    flat float Radius;
+    flat vec3 Color;
+} impostor;
+
+void main() {
+    vec4 view_pos = view * vec4(center_radius.xyz, 1.0);
+    float depth = max(-view_pos.z, 1e-4);
+    // world size of one pixel at this depth
+    float pixel = depth / (projection[1][1] * viewport_height * 0.5);
+    // sub pixel bodies are grown so the ray through the pixel center still hits them
+    impostor.Radius = max(center_radius.w, pixel * 0.75);
+    impostor.Center = center_radius.xyz;
+    impostor.Color = color;
+    gl_Position = projection * view_pos;
+    // +2 pixels so the silhouette never gets clipped by the sprite
+    gl_PointSize = 2.0 * impostor.Radius / pixel + 2.0;
+}
@@ -0,0 +1,53 @@
+#version 460 core
+
+#define SPECULAR_SCALE 64.0
+
+layout (location = 0) out vec2 g_normal;
+layout (location = 1) out vec4 g_albedo_spec;
+
+uniform vec2 viewport_size;
+uniform mat4 inverse_view_projection;
+
+layout(std140, binding = 0) uniform Matrices {
+    mat4 view;
+    mat4 projection;
+};
+
+layout(std140, binding = 1) uniform LightingGlobals {
+    float ambient_strength;
+    vec3 camera_pos;
+};
+
+in Impostor {
+    flat vec3 Center;
+    flat float Radius;
+    flat vec3 Color;
+} impostor;
+
+// octahedral normal encoding, the gbuffer only keeps two signed 16 bit channels
+vec2 oct_wrap(vec2 v){
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+vec2 encode_normal(vec3 n){
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    return n.z >= 0.0 ? n.xy : oct_wrap(n.xy);
+}
+
+void main() {
+    vec2 ndc = gl_FragCoord.xy / viewport_size * 2.0 - 1.0;
+    vec4 far_point = inverse_view_projection * vec4(ndc, 1.0, 1.0);
+    vec3 dir = normalize(far_point.xyz / far_point.w - camera_pos);
+
+    vec3 oc = camera_pos - impostor.Center;
+    float b = dot(oc, dir);
+    float h = b * b - (dot(oc, oc) - impostor.Radius * impostor.Radius);
+    if(h < 0.0)
+        discard;
+    vec3 hit = camera_pos + dir * (-b - sqrt(h));
+
+    g_normal = encode_normal(normalize(hit - impostor.Center));
+    g_albedo_spec = vec4(impostor.Color, 8.0 / SPECULAR_SCALE);
+
+    vec4 clip = projection * view * vec4(hit, 1.0);
+    gl_FragDepth = (clip.z / clip.w) * 0.5 + 0.5;
+}
@@ -4,9 +4,28 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D g_position;
+#define SPECULAR_SCALE 64.0
+
+uniform sampler2D g_depth;
 uniform sampler2D g_normal;
 uniform sampler2D g_albedo_spec;
+uniform mat4 inverse_view_projection;
+uniform samplerCubeArray shadow_maps;
+uniform float far_plane;
+
+uniform uint clusters_x;
+uniform uint clusters_y;
+uniform uint clusters_z;
+uniform float cluster_near;
+// clusters_z / log(far / near)
+uniform float cluster_depth_scale;
+uniform vec2 screen_size;
+
+layout(std140, binding = 0) uniform Matrices {
+    mat4 view;
+    mat4 projection;
+    mat4 text_projection;
+};
 
 layout(std140, binding = 1) uniform LightingGlobals {
     float ambient_strength;
@@ -18,28 +37,129 @@ struct LightSource {
     vec4 color;
     float att_linear;
     float att_quadratic;
+    float radius;
+    float __att_pad;
+    int shadow_layer;
 };
 
-layout(std140, binding = 2) restrict readonly buffer LightSources {
+layout(std430, binding = 2) restrict readonly buffer LightSources {
     LightSource light_sources[];
 };
 
-void main(){
-    vec3 frag_pos = texture(g_position, TexCoords).rgb;
-    vec3 norm = texture(g_normal, TexCoords).rgb;
-    vec3 albedo = texture(g_albedo_spec, TexCoords).rgb;
-    float specular = texture(g_albedo_spec, TexCoords).a;
+struct Cluster {
+    uint offset;
+    uint count;
+};
+
+layout(std430, binding = 3) restrict readonly buffer LightClusters {
+    Cluster clusters[];
+};
+
+layout(std430, binding = 4) restrict readonly buffer LightIndices {
+    uint light_indices[];
+};
+
+// PCF kernel size, the light pass gets compiled once per shadow quality tier
+#ifndef SHADOW_TAPS
+#define SHADOW_TAPS 20
+#endif
+// taps checked before the rest of the kernel, if they all agree the fragment is fully lit or fully in shadow
+#define SHADOW_PROBE_TAPS 4
+
+// ordered so that every prefix is spread out evenly: a tetrahedron, the rest of the cube corners, then the edges
+const vec3 sample_offset_directions[20] = vec3[]
+(
+   vec3( 1,  1,  1), vec3(-1, -1,  1), vec3( 1, -1, -1), vec3(-1,  1, -1),
+   vec3( 1, -1,  1), vec3(-1,  1,  1), vec3( 1,  1, -1), vec3(-1, -1, -1),
+   vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
+   vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
+   vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
+);
+
+float shadow_tap(vec3 dir, float current_depth, float bias, int layer){
+    float closest_depth = texture(shadow_maps, vec4(dir, float(layer))).r * far_plane;
+    return current_depth - bias > closest_depth ? 1.0 : 0.0;
+}
+
+float calculate_shadow(vec3 frag_pos, vec3 normal, vec3 light_dir, vec3 light_source_pos, int layer){
+    if(layer < 0)
+        return 0.0;
+    vec3 frag_to_light = frag_pos - light_source_pos;
+    float current_depth = length(frag_to_light);
+    //in case we are too far from the lightsource
+    if(current_depth > far_plane)
+        return 0.0;
+    float bias = max(0.05 * (1.0 - dot(normal, light_dir)), 0.005);
+#if SHADOW_TAPS == 1
+    return shadow_tap(frag_to_light, current_depth, bias, layer);
+#else
+    float view_distance = length(camera_pos - frag_pos);
+    float disk_radius = (1.0 + (view_distance / far_plane)) / 25.0;
+    float shadow = 0.0;
+    for(int i = 0; i < min(SHADOW_PROBE_TAPS, SHADOW_TAPS); i++){
+        shadow += shadow_tap(frag_to_light + sample_offset_directions[i] * disk_radius, current_depth, bias, layer);
+    }
+#if SHADOW_TAPS > SHADOW_PROBE_TAPS
+    if(shadow == 0.0 || shadow == float(SHADOW_PROBE_TAPS))
+        return shadow / float(SHADOW_PROBE_TAPS);
+    for(int i = SHADOW_PROBE_TAPS; i < SHADOW_TAPS; i++){
+        shadow += shadow_tap(frag_to_light + sample_offset_directions[i] * disk_radius, current_depth, bias, layer);
+    }
+#endif
+    return shadow / float(SHADOW_TAPS);
+#endif
+}
 
-    vec3 result = vec3(0);
+vec3 decode_normal(vec2 e){
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
-    vec3 ambient = ambient_strength * albedo;
-    result += ambient;
+vec3 world_pos_from_depth(vec2 uv, float depth){
+    vec4 world = inverse_view_projection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
+uint cluster_index(vec3 frag_pos){
+    float view_depth = -(view * vec4(frag_pos, 1.0)).z;
+    uvec2 tile = uvec2(gl_FragCoord.xy / screen_size * vec2(clusters_x, clusters_y));
+    tile = min(tile, uvec2(clusters_x - 1u, clusters_y - 1u));
+    float slice_f = log(max(view_depth, cluster_near) / cluster_near) * cluster_depth_scale;
+    uint slice = min(uint(slice_f), clusters_z - 1u);
+    return tile.x + tile.y * clusters_x + slice * clusters_x * clusters_y;
+}
+
+void main(){
+    float depth = texture(g_depth, TexCoords).r;
+    // the forward pass depth tests against this
+    gl_FragDepth = depth;
+    // nothing was rendered into the gbuffer here
+    if(depth >= 1.0){
+        FragColor = vec4(0.0);
+        return;
+    }
+    vec3 frag_pos = world_pos_from_depth(TexCoords, depth);
+    vec3 norm = decode_normal(texture(g_normal, TexCoords).rg);
+    vec4 albedo_spec = texture(g_albedo_spec, TexCoords);
+    vec3 albedo = albedo_spec.rgb;
+    float specular_v = albedo_spec.a * SPECULAR_SCALE;
+
+    vec3 result = ambient_strength * albedo;
 
     vec3 view_dir = normalize(camera_pos - frag_pos);
 
-    for(int i = 0; i < light_sources.length(); i++) {
-        vec3 light_source_color = vec3(light_sources[i].color);
-        vec3 light_source_pos = vec3(light_sources[i].position);
+    Cluster cluster = clusters[cluster_index(frag_pos)];
+    for(uint i = 0u; i < cluster.count; i++) {
+        LightSource ls = light_sources[light_indices[cluster.offset + i]];
+        vec3 light_source_color = ls.color.rgb;
+        vec3 light_source_pos = ls.position.xyz;
+
+        float distance = length(light_source_pos - frag_pos);
+        if(distance > ls.radius)
+            continue;
 
         vec3 light_dir = normalize(light_source_pos - frag_pos);
         float diff = max(dot(norm, light_dir), 0.0);
@@ -47,20 +167,19 @@ void main(){
 
         vec3 halfway_dir = normalize(light_dir + view_dir);
 
-        vec3 reflect_dir = reflect(-light_dir, norm);
-        float spec = pow(max(dot(norm, halfway_dir), 0.0), 8.0); // 4 <- shininess value
+        float spec = pow(max(dot(norm, halfway_dir), 0.0), specular_v);
         vec3 specular = 0.25 * light_source_color * spec;
 
-        float distance = length(light_source_pos - frag_pos);
         float attenuation = 1.0 / (1.0 +
-                light_sources[i].att_linear * distance
-                + light_sources[i].att_quadratic * (distance * distance));
+                ls.att_linear * distance
+                + ls.att_quadratic * (distance * distance));
 
         diffuse *= attenuation;
         specular *= attenuation;
 
-        result += (diffuse + specular);
+        float shadow = calculate_shadow(frag_pos, norm, light_dir, light_source_pos, ls.shadow_layer);
+
+        result += (1.0 - shadow) * specular + min(1.2 - shadow, 1.0) * diffuse;
     }
-    // FragColor = vec4(result, 1.0f);
     FragColor = vec4(result, 1.0f);
 }
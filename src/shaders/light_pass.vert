@@ -1,10 +1,9 @@
 #version 460 core
 
-layout(location = 0) in vec2 pos;
-layout(location = 1) in vec2 tex_coords;
-
 out vec2 TexCoords;
+// a single triangle covering the whole screen, no vertex buffer needed
 void main(){
-    TexCoords = tex_coords;
-    gl_Position = vec4(pos, 0.0, 1.0);
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoords = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
 }
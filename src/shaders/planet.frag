@@ -2,9 +2,11 @@
 
 #define M_PI 3.1415926535897932384626433832795
 
-layout (location = 0) out vec3 g_position;
-layout (location = 1) out vec3 g_normal;
-layout (location = 2) out vec4 g_albedo_spec;
+// the light pass divides the specular exponent back out of the 8 bit alpha channel
+#define SPECULAR_SCALE 64.0
+
+layout (location = 0) out vec2 g_normal;
+layout (location = 1) out vec4 g_albedo_spec;
 
 uniform bool has_texture = false;
 uniform sampler2D body_texture;
@@ -23,9 +25,17 @@ layout(std140, binding = 1) uniform LightingGlobals {
     vec3 camera_pos;
 };
 
+// octahedral normal encoding, the gbuffer only keeps two signed 16 bit channels
+vec2 oct_wrap(vec2 v){
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+vec2 encode_normal(vec3 n){
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    return n.z >= 0.0 ? n.xy : oct_wrap(n.xy);
+}
+
 void main() {
-    g_position = light_data.FragPos;
-    g_normal = normalize(light_data.Normal);
+    g_normal = encode_normal(normalize(light_data.Normal));
     if(has_texture){
         vec2 tex_coord = vec2((atan(light_data.ModelVertPos.y, light_data.ModelVertPos.x) / M_PI + 1.0) * 0.5,
                 (asin(light_data.ModelVertPos.z) / M_PI + 0.5));
@@ -33,5 +43,5 @@ void main() {
     } else {
         g_albedo_spec.rgb = light_data.VertColor;
     }
-    g_albedo_spec.a = 8.0;
+    g_albedo_spec.a = 8.0 / SPECULAR_SCALE;
 }
@@ -0,0 +1,12 @@
+#version 460 core
+
+out vec4 FragColor;
+
+in vec2 glyph_coord;
+in vec3 glyph_color;
+
+uniform sampler2D font_bitmap;
+
+void main() {
+    FragColor = vec4(glyph_color, texture(font_bitmap, glyph_coord).r);
+}
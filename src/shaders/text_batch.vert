@@ -0,0 +1,38 @@
+#version 460 core
+
+// one instance per glyph, see font::GlyphInstance
+layout (location = 0) in vec4 anchor;
+layout (location = 1) in vec4 rect;
+layout (location = 2) in vec4 uv;
+layout (location = 3) in vec4 color;
+
+layout(std140, binding = 0) uniform Matrices {
+    mat4 view;
+    mat4 projection;
+    mat4 text_projection;
+};
+
+out vec2 glyph_coord;
+out vec3 glyph_color;
+
+const vec2 corners[6] = vec2[](
+    vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+    vec2(1.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 0.0)
+);
+
+void main() {
+    vec2 corner = corners[gl_VertexID];
+    vec2 local = rect.xy + corner * rect.zw;
+    glyph_coord = mix(uv.xy, uv.zw, corner);
+    glyph_color = color.rgb;
+
+    if (color.a > 0.5) {
+        // labels always face the camera, so the quad is offset in view space
+        // (font pixels grow downwards, view space y grows upwards)
+        vec4 view_pos = view * vec4(anchor.xyz, 1.0);
+        view_pos.xy += vec2(local.x, -local.y) * anchor.w;
+        gl_Position = projection * view_pos;
+    } else {
+        gl_Position = text_projection * vec4(anchor.xy + local * anchor.w, 0.0, 1.0);
+    }
+}
@@ -1,13 +1,23 @@
 #version 460 core
 
-layout(location = 0) in vec3 pos;
-
 layout(std140, binding = 0) uniform Matrices {
     mat4 view;
     mat4 projection;
     mat4 text_projection;
 };
 
+// every trail in the game lives in this buffer, as tightly packed vec3s
+layout(std430, binding = 5) restrict readonly buffer TrailPoints {
+    float points[];
+};
+
+uniform uint trail_offset;
+uniform uint trail_size;
+// ring slot of the oldest point
+uniform uint trail_head;
+
 void main(){
+    uint i = trail_offset + (trail_head + uint(gl_VertexID)) % trail_size;
+    vec3 pos = vec3(points[3 * i], points[3 * i + 1], points[3 * i + 2]);
     gl_Position = projection * view * vec4(pos, 1.0);
 }
@@ -0,0 +1,34 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+#include <cmath>
+#include <cstdio>
+#include <exception>
+
+// Just enough for the unit tests: a failed check prints where it failed and the test keeps going,
+// main returns check::result() so ctest sees the failure.
+namespace check {
+    inline int failures = 0;
+
+    inline void fail(const char* file, int line, const char* what){
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+        failures++;
+    }
+    inline int result(){
+        if (failures)
+            std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return failures ? 1 : 0;
+    }
+}
+
+#define CHECK(cond) \
+    do { if (!(cond)) check::fail(__FILE__, __LINE__, #cond); } while (0)
+#define CHECK_NEAR(a, b, eps) \
+    do { if (!(std::abs((double)(a) - (double)(b)) <= (eps))) check::fail(__FILE__, __LINE__, #a " near " #b); } while (0)
+#define CHECK_THROWS(expr) \
+    do { \
+        bool thrown = false; \
+        try { expr; } catch (const std::exception&) { thrown = true; } \
+        if (!thrown) check::fail(__FILE__, __LINE__, #expr " throws"); \
+    } while (0)
+
+#endif
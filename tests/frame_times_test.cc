@@ -0,0 +1,72 @@
+// FrameTimes: bucket edges and nearest rank percentiles over known frame sets
+#include "FrameTimes.hpp"
+#include "Check.hpp"
+
+using namespace gm;
+
+namespace {
+    void bucket_edges(){
+        // linear up to SUB_BUCKETS us, then SUB_BUCKETS / 2 buckets per power of two
+        CHECK(FrameTimes::bucket_for(0.0) == 0);
+        CHECK(FrameTimes::bucket_for(0.063) == 63);
+        CHECK(FrameTimes::bucket_for(0.064) == 64);
+        CHECK(FrameTimes::bucket_for(0.065) == 64);
+        CHECK(FrameTimes::bucket_for(0.066) == 65);
+        CHECK(FrameTimes::bucket_for(0.128) == 96);
+        CHECK_NEAR(FrameTimes::bucket_upper_ms(63), 0.064, 1e-12);
+        CHECK_NEAR(FrameTimes::bucket_upper_ms(64), 0.066, 1e-12);
+        CHECK_NEAR(FrameTimes::bucket_upper_ms(96), 0.132, 1e-12);
+        CHECK(FrameTimes::bucket_for(1e6) == FrameTimes::BUCKET_COUNT - 1);
+        // every bucket ends where the next one starts
+        for (uint32_t b = 0; b + 1 < FrameTimes::BUCKET_COUNT; b++) {
+            double upper_us = FrameTimes::bucket_upper_ms(b) * 1000.0;
+            CHECK(FrameTimes::bucket_for((upper_us - 0.5) / 1000.0) == b);
+            CHECK(FrameTimes::bucket_for((upper_us + 0.5) / 1000.0) == b + 1);
+        }
+    }
+    void percentiles(){
+        // 90 frames at 60 Hz, 9 at 30 Hz and one hitch
+        FrameTimes times{};
+        for (int i = 0; i < 90; i++)
+            times.add(16.0);
+        for (int i = 0; i < 9; i++)
+            times.add(33.0);
+        times.add(100.0);
+        auto s = times.summary();
+        CHECK(s.frames == 100);
+        CHECK_NEAR(s.mean_ms, 18.37, 1e-4);
+        // 16000 us is in [15872, 16128), 33000 in [32768, 33792), 100000 in [98304, 100352)
+        CHECK_NEAR(s.p50_ms, 16.128, 1e-9);
+        CHECK_NEAR(s.p95_ms, 33.792, 1e-9);
+        CHECK_NEAR(s.p99_ms, 33.792, 1e-9);
+        CHECK_NEAR(times.percentile(1.0), 100.352, 1e-9);
+        CHECK_NEAR(s.max_ms, 100.0, 1e-9);
+        // rank 90 is still a 16 ms frame, rank 91 the first 33 ms one
+        CHECK_NEAR(times.percentile(0.90), 16.128, 1e-9);
+        CHECK_NEAR(times.percentile(0.91), 33.792, 1e-9);
+    }
+    void sliding_window(){
+        FrameTimes times{};
+        times.set_window(10);
+        for (int i = 0; i < 10; i++)
+            times.add(50.0);
+        for (int i = 0; i < 10; i++)
+            times.add(1.0);
+        // the 50 ms frames left the histogram with the window
+        auto s = times.summary();
+        CHECK(s.frames == 10);
+        CHECK(times.get_count(FrameTimes::bucket_for(50.0)) == 0);
+        CHECK_NEAR(s.mean_ms, 1.0, 1e-6);
+        CHECK_NEAR(s.p99_ms, 1.008, 1e-9);
+        CHECK_NEAR(s.max_ms, 1.0, 1e-9);
+        CHECK(FrameTimes().percentile(0.5) == 0.0);
+        CHECK_THROWS(times.set_window(0));
+    }
+}
+
+int main(){
+    bucket_edges();
+    percentiles();
+    sliding_window();
+    return check::result();
+}
@@ -0,0 +1,145 @@
+// Recording: positions come back within a quantization step, seeking decodes the same frame as
+// playing from the start, a recording without its index still plays
+#include "Recording.hpp"
+#include "SceneGen.hpp"
+#include "Check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <vector>
+
+using namespace gm;
+
+namespace {
+    const std::filesystem::path DIR = std::filesystem::temp_directory_path() / "islands_recording_test";
+    constexpr uint32_t KEYFRAME_INTERVAL = 8;
+    constexpr uint32_t RECORDS = 60;
+    // a body gets removed here, the layout change forces a keyframe in the middle of a delta run
+    constexpr uint32_t REMOVED_AT = 37;
+
+    struct Expected {
+        uint64_t step{};
+        double time{};
+        std::vector<glm::vec3> pos{};
+        std::vector<float> mass{};
+    };
+
+    // the bodies only drift, the recording doesn't care where the positions come from
+    std::vector<Expected> record_run(const std::filesystem::path& path, float& extent){
+        auto bodies = scene::generate("plummer", 200, 3);
+        std::vector<Expected> expected{};
+        extent = 1.0f;
+        record::Recorder recorder(path, 1, KEYFRAME_INTERVAL);
+        uint64_t layout = 0;
+        for (uint32_t r = 0; r < RECORDS; r++) {
+            if (r == REMOVED_AT) {
+                bodies.erase(bodies.begin() + 17);
+                layout++;
+            }
+            for (auto& b : bodies)
+                b.pos += b.vel * 0.05f;
+            auto frame = recorder.begin_frame(true);
+            frame->step = 10 * r;
+            frame->time = 0.5 * r;
+            frame->layout = layout;
+            frame->resize(bodies.size());
+            auto& e = expected.emplace_back(Expected { .step = frame->step, .time = frame->time });
+            for (size_t i = 0; i < bodies.size(); i++) {
+                frame->pos[i] = bodies[i].pos;
+                frame->mass[i] = bodies[i].mass;
+                frame->radius[i] = bodies[i].radius;
+                frame->color[i] = glm::vec3((float)i / bodies.size(), 0.5f, 1.0f);
+                frame->flags[i] = bodies[i].is_star ? record::FLAG_STAR : 0;
+                e.pos.push_back(bodies[i].pos);
+                e.mass.push_back(bodies[i].mass);
+                extent = std::max({ extent, std::abs(bodies[i].pos.x), std::abs(bodies[i].pos.y), std::abs(bodies[i].pos.z) });
+            }
+            recorder.submit(frame);
+        }
+        CHECK(recorder.get_dropped() == 0);
+        return expected;
+    }
+    bool same(const record::Frame& a, const record::Frame& b){
+        return a.step == b.step && a.time == b.time && a.layout == b.layout && a.pos == b.pos && a.mass == b.mass
+            && a.radius == b.radius && a.color == b.color && a.flags == b.flags;
+    }
+
+    void decode_all(record::Replay& replay, const std::vector<Expected>& expected, float extent){
+        CHECK(replay.size() == expected.size());
+        if (replay.size() != expected.size())
+            return;
+        // no keyframe grid is finer than the one spanning the whole run
+        const double step = (double)extent / (1 << record::QUANT_BITS);
+        for (size_t r = 0; r < expected.size(); r++) {
+            auto& frame = replay.decode(r);
+            auto& e = expected[r];
+            CHECK(frame.step == e.step && frame.time == e.time);
+            CHECK(frame.pos.size() == e.pos.size());
+            if (frame.pos.size() != e.pos.size())
+                continue;
+            double worst = 0.0;
+            for (size_t i = 0; i < e.pos.size(); i++)
+                for (int axis = 0; axis < 3; axis++)
+                    worst = std::max(worst, std::abs((double)frame.pos[i][axis] - e.pos[i][axis]));
+            CHECK(worst <= step);
+            CHECK(frame.mass == e.mass);
+            CHECK(frame.color[3] == glm::vec3(3.0f / e.pos.size(), 0.5f, 1.0f));
+        }
+    }
+    void round_trip(const std::filesystem::path& path, const std::vector<Expected>& expected, float extent){
+        record::Replay replay(path);
+        CHECK(replay.get_interval() == 1);
+        decode_all(replay, expected, extent);
+        CHECK(replay.find(expected[5].time) == 5);
+        CHECK(replay.find(expected[5].time + 0.25) == 5);
+        CHECK(replay.find(-1.0) == 0);
+        CHECK(replay.find(1e9) == expected.size() - 1);
+    }
+    void seeking(const std::filesystem::path& path){
+        std::vector<record::Frame> sequential{};
+        {
+            record::Replay replay(path);
+            for (size_t r = 0; r < replay.size(); r++)
+                sequential.push_back(replay.decode(r));
+        }
+        // into the middle of delta runs, backwards within one, across a keyframe and across the layout change
+        record::Replay replay(path);
+        for (size_t r : std::initializer_list<size_t>{ 13, 11, 12, 29, 3, REMOVED_AT + 2, REMOVED_AT - 2, RECORDS - 1, 0, 21 }) {
+            CHECK(same(replay.decode(r), sequential[r]));
+            // a fresh replay has nothing to build on and has to start at the keyframe
+            record::Replay fresh(path);
+            CHECK(same(fresh.decode(r), sequential[r]));
+        }
+    }
+    void without_index(const std::filesystem::path& path, const std::vector<Expected>& expected, float extent){
+        // what a crash leaves behind: every chunk but no index and no trailer
+        record::Trailer trailer{};
+        {
+            std::ifstream in(path, std::ios::binary);
+            in.seekg(-(std::streamoff)sizeof(trailer), std::ios::end);
+            in.read(reinterpret_cast<char*>(&trailer), sizeof(trailer));
+        }
+        CHECK(std::equal(std::begin(trailer.magic), std::end(trailer.magic), record::FILE_MAGIC));
+        auto cut = DIR / "crashed.islrec";
+        std::filesystem::copy_file(path, cut, std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::resize_file(cut, trailer.index_offset);
+        record::Replay replay(cut);
+        decode_all(replay, expected, extent);
+    }
+}
+
+int main(){
+    std::filesystem::remove_all(DIR);
+    std::filesystem::create_directories(DIR);
+    auto path = DIR / "run.islrec";
+    float extent{};
+    auto expected = record_run(path, extent);
+    round_trip(path, expected, extent);
+    seeking(path);
+    without_index(path, expected, extent);
+    CHECK_THROWS(record::Replay(DIR / "missing.islrec"));
+    std::filesystem::remove_all(DIR);
+    return check::result();
+}
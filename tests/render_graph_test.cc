@@ -0,0 +1,97 @@
+// RenderGraph::plan: culling, RAW/WAW/WAR ordering and transient reuse by lifetime, no GL context needed
+#include "RenderGraph.hpp"
+#include "Check.hpp"
+#include <vector>
+
+using namespace gm;
+
+namespace {
+    const RenderGraph::TextureDesc COLOR{ .internal_format = GL_RGBA16F, .format = GL_RGBA, .type = GL_FLOAT };
+    const RenderGraph::TextureDesc DEPTH{ .internal_format = GL_DEPTH24_STENCIL8, .format = GL_DEPTH_STENCIL,
+        .type = GL_UNSIGNED_INT_24_8, .depth = true };
+
+    RenderGraph::Pass pass(const char* name, std::vector<RenderGraph::Resource> reads, std::vector<RenderGraph::Resource> writes){
+        return RenderGraph::Pass{ .name = name, .reads = std::move(reads), .writes = std::move(writes) };
+    }
+
+    void culling_and_reuse(){
+        RenderGraph graph{};
+        graph.begin_frame(640, 480);
+        auto first = graph.create_texture("first", COLOR);
+        auto second = graph.create_texture("second", COLOR);
+        auto unused = graph.create_texture("unused", COLOR);
+        graph.add_pass(pass("draw first", {}, { first }));
+        graph.add_pass(pass("show first", { first }, { RenderGraph::BACKBUFFER }));
+        // nothing reads what it draws, so it goes
+        graph.add_pass(pass("dead", {}, { unused }));
+        graph.add_pass(pass("draw second", {}, { second }));
+        graph.add_pass(pass("show second", { second }, { RenderGraph::BACKBUFFER }));
+        graph.plan();
+
+        CHECK((graph.get_schedule() == std::vector<uint32_t>{ 0, 1, 3, 4 }));
+        auto& stats = graph.get_stats();
+        CHECK(stats.passes == 4);
+        CHECK(stats.culled_passes == 1);
+        // first lives in [0, 1] and second in [2, 3] of the schedule, one texture backs both
+        CHECK(stats.transient_textures == 1);
+    }
+    void overlapping_lifetimes(){
+        RenderGraph graph{};
+        graph.begin_frame(640, 480);
+        auto albedo = graph.create_texture("albedo", COLOR);
+        auto normals = graph.create_texture("normals", COLOR);
+        auto depth = graph.create_texture("depth", DEPTH);
+        auto lit = graph.create_texture("lit", COLOR);
+        graph.add_pass(pass("gbuffer", {}, { albedo, normals, depth }));
+        graph.add_pass(pass("lighting", { albedo, normals, depth }, { lit }));
+        graph.add_pass(pass("present", { lit }, { RenderGraph::BACKBUFFER }));
+        graph.plan();
+
+        CHECK((graph.get_schedule() == std::vector<uint32_t>{ 0, 1, 2 }));
+        // lit starts while the gbuffer is still read, so all three color targets are alive at once,
+        // and the depth buffer never shares with a color one
+        CHECK(graph.get_stats().transient_textures == 4);
+    }
+    void ordering(){
+        RenderGraph graph{};
+        graph.begin_frame(640, 480);
+        auto scene = graph.create_texture("scene", COLOR);
+        auto overlay = graph.create_texture("overlay", COLOR);
+        graph.add_pass(pass("scene", {}, { scene }));
+        graph.add_pass(pass("overlay", {}, { overlay }));
+        // write after write on scene, and it draws into the same target as the pass before
+        graph.add_pass(pass("scene decals", {}, { scene }));
+        graph.add_pass(pass("compose", { scene, overlay }, { RenderGraph::BACKBUFFER }));
+        // write after read: may only touch scene once compose has read it
+        graph.add_pass(pass("scene again", {}, { scene }));
+        graph.add_pass(pass("present", { scene }, { RenderGraph::BACKBUFFER }));
+        graph.plan();
+
+        // decals are pulled in front of the independent overlay pass to stay on the same framebuffer
+        CHECK((graph.get_schedule() == std::vector<uint32_t>{ 0, 2, 1, 3, 4, 5 }));
+        CHECK(graph.get_stats().culled_passes == 0);
+    }
+    void replanning(){
+        // the pool survives between frames of the same size and isn't grown by the same graph again
+        RenderGraph graph{};
+        for (int frame = 0; frame < 3; frame++) {
+            graph.begin_frame(640, 480);
+            auto a = graph.create_texture("a", COLOR);
+            auto b = graph.create_texture("b", COLOR);
+            graph.add_pass(pass("a", {}, { a }));
+            graph.add_pass(pass("b", { a }, { b }));
+            graph.add_pass(pass("present", { b }, { RenderGraph::BACKBUFFER }));
+            graph.plan();
+            CHECK(graph.get_stats().transient_textures == 2);
+        }
+        CHECK_THROWS(graph.add_pass(pass("bad", {}, { 42 })));
+    }
+}
+
+int main(){
+    culling_and_reuse();
+    overlapping_lifetimes();
+    ordering();
+    replanning();
+    return check::result();
+}
@@ -0,0 +1,155 @@
+// SceneFile: every field survives a save and load, broken files throw instead of being read
+#include "SceneFile.hpp"
+#include "Check.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace gm;
+
+namespace {
+    const std::filesystem::path DIR = std::filesystem::temp_directory_path() / "islands_scene_file_test";
+
+    scene::SceneData make_scene(){
+        scene::SceneData scene{ .step = 4200, .time = 67.25 };
+        for (int i = 0; i < 5; i++) {
+            float f = (float)i;
+            scene.bodies.push_back(gravity::Gravdata {
+                .mass = 1.5f + f * 100.0f,
+                .pos = { f, -2.0f * f, 0.125f * f },
+                .vel = { 0.5f - f, f * f, -3.0f },
+                .radius = 0.25f + f,
+                .is_star = i % 2 == 0,
+            });
+            scene.colors.push_back({ 0.1f * f, 1.0f - 0.1f * f, 0.5f });
+        }
+        scene.names = { "sun", "", "earth", "", "moon" };
+        // two bodies share a path, one has none
+        scene.textures = { "textures/rock.png", "textures/rock.png", "", "textures/ice.png", "textures/rock.png" };
+        return scene;
+    }
+    bool same(const glm::vec3& a, const glm::vec3& b){
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+
+    void round_trip(){
+        auto saved = make_scene();
+        auto path = DIR / "round_trip.bin";
+        scene::save(path, saved);
+        CHECK(!std::filesystem::exists(DIR / "round_trip.bin.tmp"));
+
+        auto loaded = scene::load(path);
+        CHECK(loaded.step == saved.step);
+        CHECK(loaded.time == saved.time);
+        CHECK(loaded.bodies.size() == saved.bodies.size());
+        CHECK(loaded.colors.size() == saved.bodies.size());
+        CHECK(loaded.names.size() == saved.bodies.size());
+        CHECK(loaded.textures.size() == saved.bodies.size());
+        if (loaded.bodies.size() != saved.bodies.size() || loaded.colors.size() != saved.colors.size()
+            || loaded.names.size() != saved.names.size() || loaded.textures.size() != saved.textures.size())
+            return;
+        for (size_t i = 0; i < saved.bodies.size(); i++) {
+            auto& a = saved.bodies[i];
+            auto& b = loaded.bodies[i];
+            CHECK(a.mass == b.mass);
+            CHECK(same(a.pos, b.pos));
+            CHECK(same(a.vel, b.vel));
+            CHECK(a.radius == b.radius);
+            CHECK(a.is_star == b.is_star);
+            CHECK(same(saved.colors[i], loaded.colors[i]));
+            CHECK(saved.names[i] == loaded.names[i]);
+            CHECK(saved.textures[i] == loaded.textures[i]);
+        }
+
+        // the shared path is in the string table once
+        scene::MappedScene mapped(path);
+        CHECK(mapped.size() == saved.bodies.size());
+        CHECK(mapped.texture(0).data() == mapped.texture(1).data());
+        CHECK(mapped.texture(0).data() == mapped.texture(4).data());
+        CHECK(mapped.texture(0).data() != mapped.texture(3).data());
+        CHECK(mapped.name(1).empty() && mapped.texture(2).empty());
+        CHECK((mapped.flags()[0] & scene::FLAG_STAR) && !(mapped.flags()[1] & scene::FLAG_STAR));
+        CHECK(mapped.get_flags() == 0);
+    }
+    void header_flags(){
+        auto path = DIR / "checkpoint.bin";
+        scene::save(path, make_scene(), false, scene::SCENE_FLAG_CHECKPOINT);
+        CHECK(scene::MappedScene(path).get_flags() == scene::SCENE_FLAG_CHECKPOINT);
+
+        // a version 2 header ends before the flags, the file still loads and has none
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            uint32_t old[2] = { 2, (uint32_t)offsetof(scene::FileHeader, flags) };
+            file.seekp(offsetof(scene::FileHeader, version));
+            file.write(reinterpret_cast<const char*>(old), sizeof(old));
+        }
+        scene::MappedScene mapped(path);
+        CHECK(mapped.get_flags() == 0);
+        CHECK(mapped.get_step() == 4200);
+        CHECK(scene::load(path).names[2] == "earth");
+    }
+    void optional_columns(){
+        // no colors, names or textures: white and empty strings come back
+        auto saved = make_scene();
+        saved.colors.clear();
+        saved.names.clear();
+        saved.textures.clear();
+        auto path = DIR / "bare.bin";
+        scene::save(path, saved);
+        auto loaded = scene::load(path);
+        CHECK(loaded.bodies.size() == saved.bodies.size());
+        for (size_t i = 0; i < loaded.colors.size(); i++) {
+            CHECK(same(loaded.colors[i], glm::vec3(1.0f)));
+            CHECK(loaded.names[i].empty());
+            CHECK(loaded.textures[i].empty());
+        }
+
+        // an empty scene is still a scene
+        scene::save(DIR / "empty.bin", scene::SceneData{});
+        CHECK(scene::load(DIR / "empty.bin").bodies.empty());
+
+        saved.colors.resize(2);
+        CHECK_THROWS(scene::save(DIR / "partial.bin", saved));
+    }
+    void broken_files(){
+        auto path = DIR / "whole.bin";
+        scene::save(path, make_scene());
+        auto size = std::filesystem::file_size(path);
+
+        // cut inside the header, inside the columns and inside the string table
+        for (auto cut : { (uintmax_t)0, (uintmax_t)sizeof(scene::FileHeader) - 1, size / 2, size - 1 }) {
+            auto cut_path = DIR / ("cut_" + std::to_string(cut) + ".bin");
+            std::filesystem::copy_file(path, cut_path, std::filesystem::copy_options::overwrite_existing);
+            std::filesystem::resize_file(cut_path, cut);
+            CHECK_THROWS(scene::load(cut_path));
+        }
+
+        auto patched = [&](const char* name, size_t offset, const void* bytes, size_t count) {
+            auto out_path = DIR / name;
+            std::filesystem::copy_file(path, out_path, std::filesystem::copy_options::overwrite_existing);
+            std::fstream file(out_path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(offset);
+            file.write(static_cast<const char*>(bytes), count);
+            return out_path;
+        };
+        CHECK_THROWS(scene::load(patched("magic.bin", 0, "ISLSCENF", 8)));
+        uint32_t version = scene::FILE_VERSION + 1;
+        CHECK_THROWS(scene::load(patched("version.bin", offsetof(scene::FileHeader, version), &version, sizeof(version))));
+        uint64_t bodies = 1'000'000;
+        CHECK_THROWS(scene::load(patched("bodies.bin", offsetof(scene::FileHeader, bodies), &bodies, sizeof(bodies))));
+
+        CHECK_THROWS(scene::load(DIR / "missing.bin"));
+    }
+}
+
+int main(){
+    std::filesystem::remove_all(DIR);
+    std::filesystem::create_directories(DIR);
+    round_trip();
+    header_flags();
+    optional_columns();
+    broken_files();
+    std::filesystem::remove_all(DIR);
+    return check::result();
+}